@@ -1,9 +1,14 @@
 //-- includes -----
 #include "HSLClient.h"
-#include "CircularBuffer.h"
+#include "CompressedSampleHistory.h"
+#include "SampleBufferArena.h"
+#include "SamplePyramid.h"
+#include "SampleUnpacking.h"
+#include "SequencedRingBuffer.h"
 #include "Logger.h"
 #include "HSLServiceInterface.h"
 #include "ServiceRequestHandler.h"
+#include "SensorManager.h"
 #include "ServerSensorView.h"
 
 #include <algorithm>
@@ -25,61 +30,452 @@ typedef std::deque<HSLEventMessage> t_message_queue;
 #define IS_VALID_SENSOR_INDEX(x) ((x) >= 0 && (x) < HSLSERVICE_MAX_SENSOR_COUNT)
 
 template <typename t_buffer_type>
-void init_buffer_iterator(HSLSensorBufferType buffer_type, CircularBuffer<t_buffer_type>* circular_buffer, HSLBufferIterator* out_iterator);
+void init_buffer_iterator(
+	HSLSensorBufferType buffer_type, 
+	SequencedRingBuffer<t_buffer_type> *ring_buffer, 
+	t_hsl_stream_cursor cursor,
+	t_hsl_stream_cursor flushed_sequence,
+	HSLBufferIterator *out_iterator,
+	t_hsl_stream_cursor *out_next_cursor,
+	uint64_t *out_lost_count)
+{
+	t_hsl_stream_cursor next_cursor= cursor;
+	uint64_t lost_count= 0;
+
+	memset(out_iterator, 0, sizeof(HSLBufferIterator));
+	out_iterator->bufferType= buffer_type;
+	out_iterator->stride = sizeof(t_buffer_type);
+
+	if (ring_buffer != nullptr)
+	{
+		const uint64_t head_sequence= ring_buffer->getHeadSequence();
+		const uint64_t tail_sequence= ring_buffer->getTailSequence();
+
+		// Frames flushed by the client are skipped but not reported as lost.
+		// Frames older than the tail have been overwritten since the cursor was handed out.
+		const uint64_t read_sequence= std::max(cursor, flushed_sequence);
+		const uint64_t start_sequence= std::min(std::max(read_sequence, tail_sequence), head_sequence);
+		lost_count= (read_sequence < tail_sequence) ? tail_sequence - read_sequence : 0;
+		next_cursor= std::max(cursor, head_sequence);
+
+		out_iterator->buffer = ring_buffer->getBuffer();
+		out_iterator->bufferCapacity = ring_buffer->getCapacity();
+		out_iterator->remaining = (size_t)(head_sequence - start_sequence);
+		out_iterator->currentIndex = ring_buffer->getIndexOfSequence(start_sequence);
+		out_iterator->endIndex = ring_buffer->getIndexOfSequence(head_sequence);
+		out_iterator->currentSequence = start_sequence;
+		out_iterator->bufferState = static_cast<const SequencedRingBufferState *>(ring_buffer);
+		out_iterator->bufferGeneration = ring_buffer->getGeneration();
+	}
+
+	if (out_next_cursor != nullptr)
+	{
+		*out_next_cursor= next_cursor;
+	}
+
+	if (out_lost_count != nullptr)
+	{
+		*out_lost_count= lost_count;
+	}
+}
+
+template <typename t_buffer_type>
+size_t init_buffer_spans_in_time_range(
+	HSLSensorBufferType buffer_type, 
+	SequencedRingBuffer<t_buffer_type> *ring_buffer, 
+	t_hsl_stream_cursor flushed_sequence,
+	double start_time,
+	double end_time,
+	HSLBufferSpans *out_spans)
+{
+	memset(out_spans, 0, sizeof(HSLBufferSpans));
+	out_spans->bufferType= buffer_type;
+	out_spans->stride= sizeof(t_buffer_type);
+
+	if (ring_buffer == nullptr || end_time < start_time)
+		return 0;
+
+	// Frame timestamps never decrease within a stream so both ends of the range can be binary searched
+	const uint64_t head_sequence= ring_buffer->getHeadSequence();
+	const uint64_t first_sequence= 
+		std::min(
+			std::max(
+				ring_buffer->findFirstSequence([start_time](const t_buffer_type& frame) { return frame.timeInSeconds >= start_time; }),
+				flushed_sequence),
+			head_sequence);
+	const uint64_t end_sequence= 
+		std::max(
+			ring_buffer->findFirstSequence([end_time](const t_buffer_type& frame) { return frame.timeInSeconds > end_time; }),
+			first_sequence);
+	const size_t frame_count= (size_t)(end_sequence - first_sequence);
+
+	out_spans->firstSequence= first_sequence;
+	out_spans->bufferState= static_cast<const SequencedRingBufferState *>(ring_buffer);
+	out_spans->bufferGeneration= ring_buffer->getGeneration();
+
+	if (frame_count > 0)
+	{
+		// Split the range where it wraps around the end of the ring
+		const size_t first_index= ring_buffer->getIndexOfSequence(first_sequence);
+		const size_t upper_count= std::min(frame_count, ring_buffer->getCapacity() - first_index);
+
+		out_spans->spans[0].frames= &ring_buffer->getBuffer()[first_index];
+		out_spans->spans[0].frameCount= upper_count;
+		out_spans->spanCount= 1;
+
+		if (upper_count < frame_count)
+		{
+			out_spans->spans[1].frames= &ring_buffer->getBuffer()[0];
+			out_spans->spans[1].frameCount= frame_count - upper_count;
+			out_spans->spanCount= 2;
+		}
+	}
+
+	return frame_count;
+}
+
+// Number of sample channels exported by HSL_ReadCapabilitySamples for each capability
+static int get_capability_channel_count(HSLSensorCapabilityType cap_type)
+{
+	switch (cap_type)
+	{
+	case HSLCapability_HeartRate:
+		return 2; // BPM, RR Interval
+	case HSLCapability_Electrocardiography:
+		return 1; // microvolts
+	case HSLCapability_Photoplethysmography:
+		return 4; // PPG0, PPG1, PPG2, ambient
+	case HSLCapability_PulseInterval:
+		return 3; // pulse duration, BPM, pulse duration error estimate
+	case HSLCapability_Accelerometer:
+		return 3; // x, y, z
+	case HSLCapability_ElectrodermalActivity:
+		return 3; // conductance, resistance, raw adc value
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+// HSL_ReadCapabilitySamples only copies whole frames, so an array of HSL_MAX_SAMPLES_PER_FRAME has to fit any of them
+static_assert(sizeof(HSLHeartRateFrame::RRIntervals) / sizeof(HSLHeartRateFrame::RRIntervals[0]) <= HSL_MAX_SAMPLES_PER_FRAME, "HR frames exceed HSL_MAX_SAMPLES_PER_FRAME");
+static_assert(sizeof(HSLHeartECGFrame::ecgValues) / sizeof(HSLHeartECGFrame::ecgValues[0]) <= HSL_MAX_SAMPLES_PER_FRAME, "ECG frames exceed HSL_MAX_SAMPLES_PER_FRAME");
+static_assert(sizeof(HSLHeartPPGFrame::ppgSamples) / sizeof(HSLHeartPPGFrame::ppgSamples[0]) <= HSL_MAX_SAMPLES_PER_FRAME, "PPG frames exceed HSL_MAX_SAMPLES_PER_FRAME");
+static_assert(sizeof(HSLHeartPPIFrame::ppiSamples) / sizeof(HSLHeartPPIFrame::ppiSamples[0]) <= HSL_MAX_SAMPLES_PER_FRAME, "PPI frames exceed HSL_MAX_SAMPLES_PER_FRAME");
+static_assert(sizeof(HSLAccelerometerFrame::accSamples) / sizeof(HSLAccelerometerFrame::accSamples[0]) <= HSL_MAX_SAMPLES_PER_FRAME, "ACC frames exceed HSL_MAX_SAMPLES_PER_FRAME");
+
+static size_t get_frame_sample_count(HSLSensorCapabilityType cap_type, int channel, const void* frame)
+{
+	switch (cap_type)
+	{
+	case HSLCapability_HeartRate:
+		return (channel == 0) ? 1 : ((const HSLHeartRateFrame*)frame)->RRIntervalCount;
+	case HSLCapability_Electrocardiography:
+		return ((const HSLHeartECGFrame*)frame)->ecgValueCount;
+	case HSLCapability_Photoplethysmography:
+		return ((const HSLHeartPPGFrame*)frame)->ppgSampleCount;
+	case HSLCapability_PulseInterval:
+		return ((const HSLHeartPPIFrame*)frame)->ppiSampleCount;
+	case HSLCapability_Accelerometer:
+		return ((const HSLAccelerometerFrame*)frame)->accSampleCount;
+	case HSLCapability_ElectrodermalActivity:
+		return 1;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+// Flatten one channel of a frame into the caller's value and time arrays
+static void unpack_frame_samples(
+	HSLSensorCapabilityType cap_type, 
+	int channel, 
+	const void* frame, 
+	size_t sample_count,
+	float* out_values, 
+	double* out_times)
+{
+	switch (cap_type)
+	{
+	case HSLCapability_HeartRate:
+		{
+			const HSLHeartRateFrame* hrFrame= (const HSLHeartRateFrame*)frame;
+
+			if (channel == 0)
+			{
+				out_values[0]= (float)hrFrame->beatsPerMinute;
+			}
+			else
+			{
+				// RR intervals are reported in 1/1024 sec units
+				for (size_t index = 0; index < sample_count; ++index)
+				{
+					out_values[index]= (float)hrFrame->RRIntervals[index] / 1024.f;
+				}
+			}
+
+			if (out_times != nullptr)
+			{
+				fill_constant_times(hrFrame->timeInSeconds, out_times, sample_count);
+			}
+		} break;
+	case HSLCapability_Electrocardiography:
+		{
+			const HSLHeartECGFrame* ecgFrame= (const HSLHeartECGFrame*)frame;
+
+			unpack_int24_samples(ecgFrame->ecgValues, out_values, sample_count);
+
+			if (out_times != nullptr)
+			{
+				fill_linear_times(ecgFrame->timeInSeconds, ecgFrame->timeDeltaInSeconds, out_times, sample_count);
+			}
+		} break;
+	case HSLCapability_Photoplethysmography:
+		{
+			const HSLHeartPPGFrame* ppgFrame= (const HSLHeartPPGFrame*)frame;
+			const int32_t* channel_values= &ppgFrame->ppgSamples[0].ppgValue0 + channel;
+
+			gather_int32_samples(channel_values, sizeof(HSLHeartPPGSample) / sizeof(int32_t), out_values, sample_count);
+
+			if (out_times != nullptr)
+			{
+				fill_linear_times(ppgFrame->timeInSeconds, ppgFrame->timeDeltaInSeconds, out_times, sample_count);
+			}
+		} break;
+	case HSLCapability_PulseInterval:
+		{
+			const HSLHeartPPIFrame* ppiFrame= (const HSLHeartPPIFrame*)frame;
+			double sample_time= ppiFrame->timeInSeconds;
+
+			for (size_t index = 0; index < sample_count; ++index)
+			{
+				const HSLHeartPPISample& ppiSample= ppiFrame->ppiSamples[index];
+
+				switch (channel)
+				{
+				case 0:
+					out_values[index]= (float)ppiSample.pulseDuration;
+					break;
+				case 1:
+					out_values[index]= (float)ppiSample.beatsPerMinute;
+					break;
+				case 2:
+					out_values[index]= (float)ppiSample.pulseDurationErrorEst;
+					break;
+				}
+
+				// Each pulse starts where the previous one ended
+				if (out_times != nullptr)
+				{
+					out_times[index]= sample_time;
+					sample_time+= (double)ppiSample.pulseDuration / 1000.0;
+				}
+			}
+		} break;
+	case HSLCapability_Accelerometer:
+		{
+			const HSLAccelerometerFrame* accFrame= (const HSLAccelerometerFrame*)frame;
+			const float* channel_values= &accFrame->accSamples[0].x + channel;
+
+			gather_float_samples(channel_values, sizeof(HSLVector3f) / sizeof(float), out_values, sample_count);
+
+			if (out_times != nullptr)
+			{
+				fill_linear_times(accFrame->timeInSeconds, accFrame->timeDeltaInSeconds, out_times, sample_count);
+			}
+		} break;
+	case HSLCapability_ElectrodermalActivity:
+		{
+			const HSLElectrodermalActivityFrame* edaFrame= (const HSLElectrodermalActivityFrame*)frame;
+
+			switch (channel)
+			{
+			case 0:
+				out_values[0]= (float)edaFrame->conductanceMicroSiemens;
+				break;
+			case 1:
+				out_values[0]= (float)edaFrame->resistanceOhms;
+				break;
+			case 2:
+				out_values[0]= (float)edaFrame->adcValue;
+				break;
+			}
+
+			if (out_times != nullptr)
+			{
+				out_times[0]= edaFrame->timeInSeconds;
+			}
+		} break;
+	default:
+		break;
+	}
+}
 
 template <typename t_buffer_type>
 struct HSLClientBufferState
 {
 	HSLSensorBufferType bufferType;
-	CircularBuffer<t_buffer_type> *buffer;
-	double newestSampleTime;
-
-	void init(HSLSensorBufferType buffer_type, size_t initial_capacity)
+	// Service side ring (owned by the ServerSensorView)
+	SequencedRingBuffer<t_buffer_type> *sourceBuffer;
+	// Client side mirror of the service ring (null in zero-copy mode)
+	SequencedRingBuffer<t_buffer_type> *buffer;
+	// On-disk history behind the service ring (owned by the ServerSensorView, null if there isn't one)
+	SequencedRingBuffer<t_buffer_type> *historyBuffer;
+	const CompressedSampleHistory *compressedHistory;
+	// Frames before this sequence have been flushed by the client
+	t_hsl_stream_cursor flushedSequence;
+
+	void init(HSLSensorBufferType buffer_type, SequencedRingBuffer<t_buffer_type> *source_buffer, bool bZeroCopy)
 	{
 		bufferType= buffer_type;
-		buffer = new CircularBuffer<t_buffer_type>(initial_capacity);
-		newestSampleTime = -1.0;
+		sourceBuffer= source_buffer;
+		buffer= nullptr;
+		historyBuffer= nullptr;
+		compressedHistory= nullptr;
+		flushedSequence= 0;
+		setZeroCopy(bZeroCopy);
 	}
 
 	void dispose()
 	{
 		delete buffer;
 		buffer= nullptr;
-		newestSampleTime = -1.0;
+		sourceBuffer= nullptr;
+		historyBuffer= nullptr;
+		compressedHistory= nullptr;
+		flushedSequence= 0;
+	}
+
+	void setZeroCopy(bool bZeroCopy)
+	{
+		if (bZeroCopy && buffer != nullptr)
+		{
+			// Release the mirror, iterators will point straight at the service ring
+			delete buffer;
+			buffer= nullptr;
+		}
+		else if (!bZeroCopy && buffer == nullptr && sourceBuffer != nullptr)
+		{
+			buffer = new SequencedRingBuffer<t_buffer_type>(sourceBuffer->getCapacity());
+		}
+	}
+
+	// Give the mirror storage from the client's arena partition, sized to match the service ring
+	void assignMirrorStorage(SampleBufferArena *arena, int partition_index)
+	{
+		if (buffer == nullptr || sourceBuffer == nullptr)
+			return;
+
+		if (arena != nullptr)
+		{
+			arena->assignRingStorage(partition_index, *buffer, sourceBuffer->getCapacity());
+		}
+		else
+		{
+			buffer->setCapacity(sourceBuffer->getCapacity());
+		}
+	}
+
+	SequencedRingBuffer<t_buffer_type> *getReadBuffer() const
+	{
+		return (buffer != nullptr) ? buffer : sourceBuffer;
+	}
+
+	// Reach back into the on-disk history when the cursor is older than anything left in memory
+	SequencedRingBuffer<t_buffer_type> *getReadBufferSince(t_hsl_stream_cursor cursor) const
+	{
+		SequencedRingBuffer<t_buffer_type> *read_buffer= getReadBuffer();
+
+		if (historyBuffer != nullptr && read_buffer != nullptr &&
+			std::max(cursor, flushedSequence) < read_buffer->getTailSequence() &&
+			historyBuffer->getTailSequence() < read_buffer->getTailSequence())
+		{
+			return historyBuffer;
+		}
+
+		return read_buffer;
+	}
+
+	// The compressed history is only worth decoding for frames that have aged out of memory
+	const CompressedSampleHistory *getCompressedHistorySince(t_hsl_stream_cursor cursor) const
+	{
+		SequencedRingBuffer<t_buffer_type> *read_buffer= getReadBuffer();
+
+		if (compressedHistory != nullptr && read_buffer != nullptr &&
+			std::max(cursor, flushedSequence) < read_buffer->getTailSequence())
+		{
+			return compressedHistory;
+		}
+
+		return nullptr;
+	}
+
+	// Same as getReadBufferSince() but for a time range starting before the oldest frame left in memory
+	SequencedRingBuffer<t_buffer_type> *getReadBufferForTime(double start_time) const
+	{
+		SequencedRingBuffer<t_buffer_type> *read_buffer= getReadBuffer();
+
+		if (historyBuffer != nullptr && !historyBuffer->isEmpty() && 
+			(read_buffer == nullptr || read_buffer->isEmpty() ||
+			 start_time < read_buffer->getBuffer()[read_buffer->getReadIndex()].timeInSeconds))
+		{
+			return historyBuffer;
+		}
+
+		return read_buffer;
 	}
 
 	void clearSensorData()
 	{
+		SequencedRingBuffer<t_buffer_type> *read_buffer= getReadBuffer();
+
+		if (read_buffer != nullptr)
+		{
+			flushedSequence= read_buffer->getHeadSequence();
+		}
+
 		if (buffer != nullptr)
 		{
 			buffer->reset();
 		}
 	}
 
-	void copyLatestValues(CircularBuffer<t_buffer_type>& source_buffer)
+	void copyLatestValues()
 	{
+		// Nothing to copy in zero-copy mode
+		if (buffer == nullptr || sourceBuffer == nullptr)
+			return;
+
 		// Make sure target buffer has the same capacity
-		if (buffer->getCapacity() != source_buffer.getCapacity())
+		if (buffer->getCapacity() != sourceBuffer->getCapacity())
 		{
-			buffer->setCapacity(source_buffer.getCapacity());
+			buffer->setCapacity(sourceBuffer->getCapacity());
 		}
 
-		// Only copy over data the client hasn't seen before
-		HSLBufferIterator iter;
-		init_buffer_iterator(bufferType, &source_buffer, &iter);
+		// Only copy over data the client hasn't seen before.
+		// The client ring stays in sequence lock-step with the server ring,
+		// so its head sequence is the cursor of the first unseen frame.
+		uint64_t lost_count= 0;
+		buffer->copyItemsSince(*sourceBuffer, buffer->getHeadSequence(), lost_count);
+	}
 
-		while (HSL_IsBufferIteratorValid(&iter))
-		{
-			const t_buffer_type *data= (t_buffer_type *)HSL_BufferIteratorGetValueRaw(&iter);
+	void initIterator(
+		t_hsl_stream_cursor cursor,
+		HSLBufferIterator *out_iterator,
+		t_hsl_stream_cursor *out_next_cursor,
+		uint64_t *out_lost_count,
+		bool bIncludeHistory= false) const
+	{
+		SequencedRingBuffer<t_buffer_type> *read_buffer= bIncludeHistory ? getReadBufferSince(cursor) : getReadBuffer();
 
-			if (data->timeInSeconds > newestSampleTime)
-			{
-				buffer->writeItem(*data);
-				newestSampleTime= data->timeInSeconds;
-			}
+		init_buffer_iterator(bufferType, read_buffer, cursor, flushedSequence, out_iterator, out_next_cursor, out_lost_count);
+	}
 
-			HSL_BufferIteratorNext(&iter);
-		}
+	size_t initSpansInTimeRange(double start_time, double end_time, HSLBufferSpans *out_spans) const
+	{
+		return init_buffer_spans_in_time_range(bufferType, getReadBufferForTime(start_time), flushedSequence, start_time, end_time, out_spans);
 	}
 };
 using HSLClentFilterState= HSLClientBufferState<HSLHeartVariabilityFrame>;
@@ -94,9 +490,14 @@ struct HSLClentSensorState
 	HSLClientBufferState<HSLHeartPPIFrame> heartPPIBuffer;
 	HSLClientBufferState<HSLAccelerometerFrame> heartAccBuffer;
 	HSLClientBufferState<HSLElectrodermalActivityFrame> skinEDABuffer;
+	HSLClientBufferState<HSLFilteredECGFrame> heartFilteredECGBuffer;
+	HSLClientBufferState<HSLFilteredPPGFrame> heartFilteredPPGBuffer;
 
 	std::array<HSLClentFilterState, HRVFilter_COUNT> hrvFilters;
 
+	// Service sample buffer layout the mirrors were last sized against
+	uint32_t sampleBufferLayoutGeneration;
+
 	void clearSensorData()
 	{
 		HSLSensorID sensor_id= sensor.sensorID;
@@ -109,6 +510,8 @@ struct HSLClentSensorState
 		heartPPIBuffer.clearSensorData();
 		heartAccBuffer.clearSensorData();
 		skinEDABuffer.clearSensorData();
+		heartFilteredECGBuffer.clearSensorData();
+		heartFilteredPPGBuffer.clearSensorData();
 
 		for (int filter_index = 0; filter_index < HRVFilter_COUNT; ++filter_index)
 		{
@@ -121,6 +524,7 @@ struct HSLClentSensorState
 HSLClient::HSLClient()
 	: m_requestHandler(nullptr)
 	, m_bHasSensorListChanged(false)
+	, m_bUseZeroCopyBuffers(false)
 {
 	m_clientSensors = new HSLClentSensorState[HSLSERVICE_MAX_SENSOR_COUNT];
 	memset(m_clientSensors, 0, sizeof(HSLClentSensorState)*HSLSERVICE_MAX_SENSOR_COUNT);
@@ -241,20 +645,24 @@ bool HSLClient::initClientSensorState(HSLSensorID sensor_id)
 		memset(&clientSensorState, 0, sizeof(HSLClentSensorState));
 		sensor.sensorID = sensor_id;
 
-		clientSensorState.heartAccBuffer.init(HSLBufferType_AccData, sensor_view->getHeartAccBuffer()->getCapacity());
-		clientSensorState.heartECGBuffer.init(HSLBufferType_ECGData, sensor_view->getHeartECGBuffer()->getCapacity());
-		clientSensorState.heartPPGBuffer.init(HSLBufferType_PPGData, sensor_view->getHeartPPGBuffer()->getCapacity());
-		clientSensorState.heartPPIBuffer.init(HSLBufferType_PPIData, sensor_view->getHeartPPIBuffer()->getCapacity());
-		clientSensorState.heartRateBuffer.init(HSLBufferType_HRData, sensor_view->getHeartRateBuffer()->getCapacity());
-		clientSensorState.skinEDABuffer.init(HSLBufferType_EDAData, sensor_view->getSkinEDABuffer()->getCapacity());
+		clientSensorState.heartAccBuffer.init(HSLBufferType_AccData, sensor_view->getHeartAccBuffer(), m_bUseZeroCopyBuffers);
+		clientSensorState.heartECGBuffer.init(HSLBufferType_ECGData, sensor_view->getHeartECGBuffer(), m_bUseZeroCopyBuffers);
+		clientSensorState.heartPPGBuffer.init(HSLBufferType_PPGData, sensor_view->getHeartPPGBuffer(), m_bUseZeroCopyBuffers);
+		clientSensorState.heartPPIBuffer.init(HSLBufferType_PPIData, sensor_view->getHeartPPIBuffer(), m_bUseZeroCopyBuffers);
+		clientSensorState.heartRateBuffer.init(HSLBufferType_HRData, sensor_view->getHeartRateBuffer(), m_bUseZeroCopyBuffers);
+		clientSensorState.skinEDABuffer.init(HSLBufferType_EDAData, sensor_view->getSkinEDABuffer(), m_bUseZeroCopyBuffers);
+		clientSensorState.heartFilteredECGBuffer.init(HSLBufferType_FilteredECGData, sensor_view->getHeartFilteredECGBuffer(), m_bUseZeroCopyBuffers);
+		clientSensorState.heartFilteredPPGBuffer.init(HSLBufferType_FilteredPPGData, sensor_view->getHeartFilteredPPGBuffer(), m_bUseZeroCopyBuffers);
 
 		for (int filter_index = 0; filter_index < HRVFilter_COUNT; ++filter_index)
 		{
 			HSLHeartRateVariabityFilterType filter = HSLHeartRateVariabityFilterType(filter_index);
 
-			clientSensorState.hrvFilters[filter_index].init(HSLBufferType_HRVData, sensor_view->getHeartHrvBuffer(filter)->getCapacity());
+			clientSensorState.hrvFilters[filter_index].init(HSLBufferType_HRVData, sensor_view->getHeartHrvBuffer(filter), m_bUseZeroCopyBuffers);
 		}
 
+		relayoutClientSensorBuffers(sensor_id);
+
 		bSuccess = true;
 	}
 		
@@ -276,6 +684,8 @@ void HSLClient::disposeClientSensorState(HSLSensorID sensor_id)
 		clientSensorState.heartPPIBuffer.dispose();
 		clientSensorState.heartRateBuffer.dispose();
 		clientSensorState.skinEDABuffer.dispose();
+		clientSensorState.heartFilteredECGBuffer.dispose();
+		clientSensorState.heartFilteredPPGBuffer.dispose();
 
 		for (int filter_index = 0; filter_index < HRVFilter_COUNT; ++filter_index)
 		{
@@ -306,18 +716,24 @@ void HSLClient::updateClientSensorState(HSLSensorID sensor_id, bool updateDevice
 			// Copy BPM value from sensor
 			sensor_capi.beatsPerMinute = sensor_view->getHeartRateBPM();
 
+			// Follow the service rings if they were given new storage (i.e. the sensor was reopened)
+			if (clientSensorState.sampleBufferLayoutGeneration != sensor_view->getSampleBufferLayoutGeneration())
+			{
+				relayoutClientSensorBuffers(sensor_id);
+			}
+
 			// Copy latest sensor buffer values from the sensor view
-			clientSensorState.heartAccBuffer.copyLatestValues(*sensor_view->getHeartAccBuffer());
-			clientSensorState.heartECGBuffer.copyLatestValues(*sensor_view->getHeartECGBuffer());
-			clientSensorState.heartPPGBuffer.copyLatestValues(*sensor_view->getHeartPPGBuffer());
-			clientSensorState.heartPPIBuffer.copyLatestValues(*sensor_view->getHeartPPIBuffer());
-			clientSensorState.heartRateBuffer.copyLatestValues(*sensor_view->getHeartRateBuffer());
-			clientSensorState.skinEDABuffer.copyLatestValues(*sensor_view->getSkinEDABuffer());
+			clientSensorState.heartAccBuffer.copyLatestValues();
+			clientSensorState.heartECGBuffer.copyLatestValues();
+			clientSensorState.heartPPGBuffer.copyLatestValues();
+			clientSensorState.heartPPIBuffer.copyLatestValues();
+			clientSensorState.heartRateBuffer.copyLatestValues();
+			clientSensorState.skinEDABuffer.copyLatestValues();
+			clientSensorState.heartFilteredECGBuffer.copyLatestValues();
+			clientSensorState.heartFilteredPPGBuffer.copyLatestValues();
 			for (int filter_index = 0; filter_index < HRVFilter_COUNT; ++filter_index)
 			{
-				HSLHeartRateVariabityFilterType filter = HSLHeartRateVariabityFilterType(filter_index);
-
-				clientSensorState.hrvFilters[filter_index].copyLatestValues(*sensor_view->getHeartHrvBuffer(filter));
+				clientSensorState.hrvFilters[filter_index].copyLatestValues();
 			}
 
 			// fetch device information if this device just opened
@@ -333,6 +749,47 @@ void HSLClient::updateClientSensorState(HSLSensorID sensor_id, bool updateDevice
 	}
 }
 
+void HSLClient::relayoutClientSensorBuffers(HSLSensorID sensor_id)
+{
+	ServerSensorView* sensor_view = m_requestHandler->getServerSensorView(sensor_id);
+
+	if (sensor_view != nullptr)
+	{
+		HSLClentSensorState& clientSensorState = m_clientSensors[sensor_id];
+		SampleBufferArena* arena = m_requestHandler->getSampleBufferArena();
+		const int partition_index = SensorManager::getClientSampleBufferPartition(sensor_id);
+
+		// Mirrors only ever hold what has already been copied out of the service rings,
+		// so it's safe to drop their contents and lay them out again from the start of the partition.
+		if (arena != nullptr)
+		{
+			arena->resetPartition(partition_index);
+		}
+
+		clientSensorState.heartAccBuffer.assignMirrorStorage(arena, partition_index);
+		clientSensorState.heartECGBuffer.assignMirrorStorage(arena, partition_index);
+		clientSensorState.heartPPGBuffer.assignMirrorStorage(arena, partition_index);
+		clientSensorState.heartPPIBuffer.assignMirrorStorage(arena, partition_index);
+		clientSensorState.heartRateBuffer.assignMirrorStorage(arena, partition_index);
+		clientSensorState.skinEDABuffer.assignMirrorStorage(arena, partition_index);
+		clientSensorState.heartFilteredECGBuffer.assignMirrorStorage(arena, partition_index);
+		clientSensorState.heartFilteredPPGBuffer.assignMirrorStorage(arena, partition_index);
+
+		for (int filter_index = 0; filter_index < HRVFilter_COUNT; ++filter_index)
+		{
+			clientSensorState.hrvFilters[filter_index].assignMirrorStorage(arena, partition_index);
+		}
+
+		// The history files may have been opened, closed or resized along with the service rings
+		clientSensorState.heartECGBuffer.historyBuffer= sensor_view->getHeartECGHistoryBuffer();
+		clientSensorState.heartPPGBuffer.historyBuffer= sensor_view->getHeartPPGHistoryBuffer();
+		clientSensorState.heartECGBuffer.compressedHistory= sensor_view->getHeartECGCompressedHistory();
+		clientSensorState.heartPPGBuffer.compressedHistory= sensor_view->getHeartPPGCompressedHistory();
+
+		clientSensorState.sampleBufferLayoutGeneration= sensor_view->getSampleBufferLayoutGeneration();
+	}
+}
+
 void HSLClient::updateAllClientSensorStates(bool updateDeviceInformation)
 {
 	for (HSLSensorID sensor_id = 0; sensor_id < HSLSERVICE_MAX_SENSOR_COUNT; ++sensor_id)
@@ -341,57 +798,99 @@ void HSLClient::updateAllClientSensorStates(bool updateDeviceInformation)
 	}
 }
 
-HSLSensor* HSLClient::getClientSensorView(HSLSensorID sensor_id)
+void HSLClient::setBufferMode(HSLClientBufferMode buffer_mode)
 {
-	return IS_VALID_SENSOR_INDEX(sensor_id) ? &m_clientSensors[sensor_id].sensor : nullptr;
+	const bool bUseZeroCopyBuffers= (buffer_mode == HSLBufferMode_ZeroCopy);
+
+	if (bUseZeroCopyBuffers != m_bUseZeroCopyBuffers)
+	{
+		m_bUseZeroCopyBuffers= bUseZeroCopyBuffers;
+
+		for (HSLSensorID sensor_id = 0; sensor_id < HSLSERVICE_MAX_SENSOR_COUNT; ++sensor_id)
+		{
+			HSLClentSensorState& clientSensorState = m_clientSensors[sensor_id];
+
+			clientSensorState.heartAccBuffer.setZeroCopy(bUseZeroCopyBuffers);
+			clientSensorState.heartECGBuffer.setZeroCopy(bUseZeroCopyBuffers);
+			clientSensorState.heartPPGBuffer.setZeroCopy(bUseZeroCopyBuffers);
+			clientSensorState.heartPPIBuffer.setZeroCopy(bUseZeroCopyBuffers);
+			clientSensorState.heartRateBuffer.setZeroCopy(bUseZeroCopyBuffers);
+			clientSensorState.skinEDABuffer.setZeroCopy(bUseZeroCopyBuffers);
+			clientSensorState.heartFilteredECGBuffer.setZeroCopy(bUseZeroCopyBuffers);
+			clientSensorState.heartFilteredPPGBuffer.setZeroCopy(bUseZeroCopyBuffers);
+
+			for (int filter_index = 0; filter_index < HRVFilter_COUNT; ++filter_index)
+			{
+				clientSensorState.hrvFilters[filter_index].setZeroCopy(bUseZeroCopyBuffers);
+			}
+
+			relayoutClientSensorBuffers(sensor_id);
+		}
+	}
 }
 
-template <typename t_buffer_type>
-void init_buffer_iterator(
-	HSLSensorBufferType buffer_type, 
-	CircularBuffer<t_buffer_type> *circular_buffer, 
-	HSLBufferIterator *out_iterator)
+HSLClientBufferMode HSLClient::getBufferMode() const
 {
-	memset(out_iterator, 0, sizeof(HSLBufferIterator));
-	out_iterator->bufferType= buffer_type;
-	out_iterator->stride = sizeof(t_buffer_type);
+	return m_bUseZeroCopyBuffers ? HSLBufferMode_ZeroCopy : HSLBufferMode_ClientMirror;
+}
 
-	if (circular_buffer != nullptr)
-	{
-		out_iterator->buffer = circular_buffer->getBuffer();
-		out_iterator->bufferCapacity = circular_buffer->getCapacity();
-		out_iterator->remaining = circular_buffer->getSize();
-		out_iterator->currentIndex = circular_buffer->getReadIndex();
-		out_iterator->endIndex = circular_buffer->getWriteIndex();
-	}
+HSLSensor* HSLClient::getClientSensorView(HSLSensorID sensor_id)
+{
+	return IS_VALID_SENSOR_INDEX(sensor_id) ? &m_clientSensors[sensor_id].sensor : nullptr;
 }
 
 HSLBufferIterator HSLClient::getCapabilityBuffer(HSLSensorID sensor_id, HSLSensorCapabilityType cap_type)
+{
+	// A zero cursor covers everything still held in the in-memory buffer
+	return getCapabilityBufferSince(sensor_id, cap_type, 0, nullptr, nullptr, false);
+}
+
+HSLBufferIterator HSLClient::getCapabilityBufferSince(
+	HSLSensorID sensor_id, 
+	HSLSensorCapabilityType cap_type,
+	t_hsl_stream_cursor cursor,
+	t_hsl_stream_cursor *out_next_cursor,
+	uint64_t *out_lost_count,
+	bool bIncludeHistory)
 {
 	HSLBufferIterator iter;
 	HSL_BufferIteratorReset(&iter);
 
+	if (out_next_cursor != nullptr)
+	{
+		*out_next_cursor= cursor;
+	}
+
+	if (out_lost_count != nullptr)
+	{
+		*out_lost_count= 0;
+	}
+
 	if (IS_VALID_SENSOR_INDEX(sensor_id))
 	{
+		HSLClentSensorState &clientSensorState= m_clientSensors[sensor_id];
+
 		switch (cap_type)
 		{
 		case HSLCapability_HeartRate:
-			init_buffer_iterator(HSLBufferType_HRData, m_clientSensors[sensor_id].heartRateBuffer.buffer, &iter);
+			clientSensorState.heartRateBuffer.initIterator(cursor, &iter, out_next_cursor, out_lost_count, bIncludeHistory);
 			break;
 		case HSLCapability_Electrocardiography:
-			init_buffer_iterator(HSLBufferType_ECGData, m_clientSensors[sensor_id].heartECGBuffer.buffer, &iter);
+			clientSensorState.heartECGBuffer.initIterator(cursor, &iter, out_next_cursor, out_lost_count, bIncludeHistory);
 			break;
 		case HSLCapability_Photoplethysmography:
-			init_buffer_iterator(HSLBufferType_PPGData, m_clientSensors[sensor_id].heartPPGBuffer.buffer, &iter);
+			clientSensorState.heartPPGBuffer.initIterator(cursor, &iter, out_next_cursor, out_lost_count, bIncludeHistory);
 			break;
 		case HSLCapability_PulseInterval:
-			init_buffer_iterator(HSLBufferType_PPIData, m_clientSensors[sensor_id].heartPPIBuffer.buffer, &iter);
+			clientSensorState.heartPPIBuffer.initIterator(cursor, &iter, out_next_cursor, out_lost_count, bIncludeHistory);
 			break;
 		case HSLCapability_Accelerometer:
-			init_buffer_iterator(HSLBufferType_AccData, m_clientSensors[sensor_id].heartAccBuffer.buffer, &iter);
+			clientSensorState.heartAccBuffer.initIterator(cursor, &iter, out_next_cursor, out_lost_count, bIncludeHistory);
 			break;
 		case HSLCapability_ElectrodermalActivity:
-			init_buffer_iterator(HSLBufferType_EDAData, m_clientSensors[sensor_id].skinEDABuffer.buffer, &iter);
+			clientSensorState.skinEDABuffer.initIterator(cursor, &iter, out_next_cursor, out_lost_count, bIncludeHistory);
+			break;
+		default:
 			break;
 		}
 	}
@@ -399,6 +898,187 @@ HSLBufferIterator HSLClient::getCapabilityBuffer(HSLSensorID sensor_id, HSLSenso
 	return iter;
 }
 
+size_t HSLClient::readCapabilitySamples(
+	HSLSensorID sensor_id,
+	HSLSensorCapabilityType cap_type,
+	int channel,
+	t_hsl_stream_cursor cursor,
+	float *out_values,
+	double *out_times,
+	size_t max_samples,
+	t_hsl_stream_cursor *out_next_cursor,
+	uint64_t *out_lost_count)
+{
+	if (out_next_cursor != nullptr)
+	{
+		*out_next_cursor= cursor;
+	}
+
+	if (out_lost_count != nullptr)
+	{
+		*out_lost_count= 0;
+	}
+
+	if (out_values == nullptr || channel < 0 || channel >= get_capability_channel_count(cap_type))
+		return 0;
+
+	// A smaller array couldn't take the next frame and would look just like a drained stream
+	if (max_samples < HSL_MAX_SAMPLES_PER_FRAME)
+		return HSL_READ_SAMPLES_BUFFER_TOO_SMALL;
+
+	size_t total_sample_count= 0;
+	uint64_t history_lost_count= 0;
+
+	// Frames that have aged out of memory are decoded from the compressed history first
+	const CompressedSampleHistory *compressed_history= getCompressedHistorySince(sensor_id, cap_type, cursor);
+	if (compressed_history != nullptr)
+	{
+		t_hsl_stream_cursor history_cursor= cursor;
+
+		total_sample_count= 
+			compressed_history->readSamples(
+				channel, cursor, out_values, out_times, max_samples, history_cursor, history_lost_count);
+
+		// Stopped short of the newest compressed frame, so the caller's array is full
+		if (history_cursor < compressed_history->getHeadSequence())
+		{
+			if (out_next_cursor != nullptr)
+			{
+				*out_next_cursor= history_cursor;
+			}
+
+			if (out_lost_count != nullptr)
+			{
+				*out_lost_count= history_lost_count;
+			}
+
+			return total_sample_count;
+		}
+
+		cursor= history_cursor;
+	}
+
+	t_hsl_stream_cursor head_cursor;
+	HSLBufferIterator iter= getCapabilityBufferSince(sensor_id, cap_type, cursor, &head_cursor, out_lost_count);
+
+	// Only whole frames are copied, so the next cursor always lands on a frame boundary
+	while (HSL_IsBufferIteratorValid(&iter))
+	{
+		const void* frame= HSL_BufferIteratorGetValueRaw(&iter);
+		const size_t frame_sample_count= get_frame_sample_count(cap_type, channel, frame);
+
+		if (total_sample_count + frame_sample_count > max_samples)
+			break;
+
+		unpack_frame_samples(
+			cap_type, channel, frame, frame_sample_count, 
+			out_values + total_sample_count,
+			out_times != nullptr ? out_times + total_sample_count : nullptr);
+
+		// In zero-copy mode the writer may have lapped us mid-frame, throw out the torn frame
+		if (HSL_HasBufferIteratorBeenOverrun(&iter))
+			break;
+
+		total_sample_count+= frame_sample_count;
+		HSL_BufferIteratorNext(&iter);
+	}
+
+	if (out_next_cursor != nullptr)
+	{
+		*out_next_cursor= (iter.remaining > 0) ? iter.currentSequence : head_cursor;
+	}
+
+	if (out_lost_count != nullptr)
+	{
+		*out_lost_count+= history_lost_count;
+	}
+
+	return total_sample_count;
+}
+
+size_t HSLClient::getCapabilitySampleBuckets(
+	HSLSensorID sensor_id,
+	HSLSensorCapabilityType cap_type,
+	int channel,
+	double start_time,
+	double end_time,
+	HSLSampleBucket *out_buckets,
+	size_t max_buckets)
+{
+	// The pyramids are only ever touched on the main thread, so they can be read straight from the service
+	ServerSensorView *sensor_view= m_requestHandler->getServerSensorView(sensor_id);
+
+	if (sensor_view != nullptr && sensor_view->getIsOpen())
+	{
+		const SamplePyramid *pyramid= sensor_view->getCapabilitySamplePyramid(cap_type);
+
+		if (pyramid != nullptr)
+		{
+			return pyramid->getBuckets(channel, start_time, end_time, out_buckets, max_buckets);
+		}
+	}
+
+	return 0;
+}
+
+const CompressedSampleHistory *HSLClient::getCompressedHistorySince(
+	HSLSensorID sensor_id,
+	HSLSensorCapabilityType cap_type,
+	t_hsl_stream_cursor cursor) const
+{
+	if (IS_VALID_SENSOR_INDEX(sensor_id))
+	{
+		const HSLClentSensorState &clientSensorState= m_clientSensors[sensor_id];
+
+		switch (cap_type)
+		{
+		case HSLCapability_Electrocardiography:
+			return clientSensorState.heartECGBuffer.getCompressedHistorySince(cursor);
+		case HSLCapability_Photoplethysmography:
+			return clientSensorState.heartPPGBuffer.getCompressedHistorySince(cursor);
+		default:
+			break;
+		}
+	}
+
+	return nullptr;
+}
+
+size_t HSLClient::getCapabilitySamplesInTimeRange(
+	HSLSensorID sensor_id,
+	HSLSensorCapabilityType cap_type,
+	double start_time,
+	double end_time,
+	HSLBufferSpans *out_spans)
+{
+	memset(out_spans, 0, sizeof(HSLBufferSpans));
+
+	if (IS_VALID_SENSOR_INDEX(sensor_id))
+	{
+		HSLClentSensorState &clientSensorState= m_clientSensors[sensor_id];
+
+		switch (cap_type)
+		{
+		case HSLCapability_HeartRate:
+			return clientSensorState.heartRateBuffer.initSpansInTimeRange(start_time, end_time, out_spans);
+		case HSLCapability_Electrocardiography:
+			return clientSensorState.heartECGBuffer.initSpansInTimeRange(start_time, end_time, out_spans);
+		case HSLCapability_Photoplethysmography:
+			return clientSensorState.heartPPGBuffer.initSpansInTimeRange(start_time, end_time, out_spans);
+		case HSLCapability_PulseInterval:
+			return clientSensorState.heartPPIBuffer.initSpansInTimeRange(start_time, end_time, out_spans);
+		case HSLCapability_Accelerometer:
+			return clientSensorState.heartAccBuffer.initSpansInTimeRange(start_time, end_time, out_spans);
+		case HSLCapability_ElectrodermalActivity:
+			return clientSensorState.skinEDABuffer.initSpansInTimeRange(start_time, end_time, out_spans);
+		default:
+			break;
+		}
+	}
+
+	return 0;
+}
+
 HSLBufferIterator HSLClient::getHeartRateVariabilityBuffer(HSLSensorID sensor_id, HSLHeartRateVariabityFilterType filter)
 {
 	HSLBufferIterator iter;
@@ -406,9 +1086,7 @@ HSLBufferIterator HSLClient::getHeartRateVariabilityBuffer(HSLSensorID sensor_id
 
 	if (IS_VALID_SENSOR_INDEX(sensor_id))
 	{
-		CircularBuffer<HSLHeartVariabilityFrame> *hrvBuffer = m_clientSensors[sensor_id].hrvFilters[filter].buffer;
-
-		init_buffer_iterator(HSLBufferType_HRVData, hrvBuffer, &iter);
+		m_clientSensors[sensor_id].hrvFilters[filter].initIterator(0, &iter, nullptr, nullptr);
 	}
 
 	return iter;
@@ -438,6 +1116,8 @@ bool HSLClient::flushCapabilityBuffer(HSLSensorID sensor_id, HSLSensorCapability
 		case HSLCapability_ElectrodermalActivity:
 			m_clientSensors[sensor_id].skinEDABuffer.clearSensorData();
 			return true;
+		default:
+			break;
 		}
 	}
 
@@ -455,6 +1135,49 @@ bool HSLClient::flushHeartHrvBuffer(HSLSensorID sensor_id, HSLHeartRateVariabity
 	return false;
 }
 
+HSLBufferIterator HSLClient::getFilteredCapabilityBuffer(HSLSensorID sensor_id, HSLSensorCapabilityType cap_type)
+{
+	HSLBufferIterator iter;
+	HSL_BufferIteratorReset(&iter);
+
+	if (IS_VALID_SENSOR_INDEX(sensor_id))
+	{
+		switch (cap_type)
+		{
+		case HSLCapability_Electrocardiography:
+			m_clientSensors[sensor_id].heartFilteredECGBuffer.initIterator(0, &iter, nullptr, nullptr);
+			break;
+		case HSLCapability_Photoplethysmography:
+			m_clientSensors[sensor_id].heartFilteredPPGBuffer.initIterator(0, &iter, nullptr, nullptr);
+			break;
+		default:
+			break;
+		}
+	}
+
+	return iter;
+}
+
+bool HSLClient::flushFilteredCapabilityBuffer(HSLSensorID sensor_id, HSLSensorCapabilityType cap_type)
+{
+	if (IS_VALID_SENSOR_INDEX(sensor_id))
+	{
+		switch (cap_type)
+		{
+		case HSLCapability_Electrocardiography:
+			m_clientSensors[sensor_id].heartFilteredECGBuffer.clearSensorData();
+			return true;
+		case HSLCapability_Photoplethysmography:
+			m_clientSensors[sensor_id].heartFilteredPPGBuffer.clearSensorData();
+			return true;
+		default:
+			break;
+		}
+	}
+
+	return false;
+}
+
 // INotificationListener
 void HSLClient::handleNotification(const HSLEventMessage &event)
 {
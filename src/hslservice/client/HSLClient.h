@@ -29,19 +29,39 @@ public:
 	bool fetchNextServerMessage(HSLEventMessage *message);
 	void flushAllServerMessages();
 	void shutdown();
+	void setBufferMode(HSLClientBufferMode buffer_mode);
+	HSLClientBufferMode getBufferMode() const;
 
 	// -- Client HSL API Requests -----
 	HSLSensor* getClientSensorView(HSLSensorID sensor_id);
 	HSLBufferIterator getCapabilityBuffer(HSLSensorID sensor_id, HSLSensorCapabilityType cap_type);
+	HSLBufferIterator getCapabilityBufferSince(
+		HSLSensorID sensor_id, HSLSensorCapabilityType cap_type, t_hsl_stream_cursor cursor,
+		t_hsl_stream_cursor *out_next_cursor, uint64_t *out_lost_count, bool bIncludeHistory= true);
+	size_t readCapabilitySamples(
+		HSLSensorID sensor_id, HSLSensorCapabilityType cap_type, int channel, t_hsl_stream_cursor cursor,
+		float *out_values, double *out_times, size_t max_samples,
+		t_hsl_stream_cursor *out_next_cursor, uint64_t *out_lost_count);
+	size_t getCapabilitySamplesInTimeRange(
+		HSLSensorID sensor_id, HSLSensorCapabilityType cap_type, double start_time, double end_time,
+		HSLBufferSpans *out_spans);
+	size_t getCapabilitySampleBuckets(
+		HSLSensorID sensor_id, HSLSensorCapabilityType cap_type, int channel, double start_time, double end_time,
+		HSLSampleBucket *out_buckets, size_t max_buckets);
 	HSLBufferIterator getHeartRateVariabilityBuffer(HSLSensorID sensor_id, HSLHeartRateVariabityFilterType filter);
 	bool flushCapabilityBuffer(HSLSensorID sensor_id, HSLSensorCapabilityType cap_type);
 	bool flushHeartHrvBuffer(HSLSensorID sensor_id, HSLHeartRateVariabityFilterType filter);
+	HSLBufferIterator getFilteredCapabilityBuffer(HSLSensorID sensor_id, HSLSensorCapabilityType cap_type);
+	bool flushFilteredCapabilityBuffer(HSLSensorID sensor_id, HSLSensorCapabilityType cap_type);
 		
 protected:
 	bool initClientSensorState(HSLSensorID sensor_id);
 	void disposeClientSensorState(HSLSensorID sensor_id);
 	void updateClientSensorState(HSLSensorID sensor_id, bool updateDeviceInformation);
 	void updateAllClientSensorStates(bool updateDeviceInformation);
+	void relayoutClientSensorBuffers(HSLSensorID sensor_id);
+	const class CompressedSampleHistory *getCompressedHistorySince(
+		HSLSensorID sensor_id, HSLSensorCapabilityType cap_type, t_hsl_stream_cursor cursor) const;
 
 	// INotificationListener
 	virtual void handleNotification(const HSLEventMessage &response) override;
@@ -59,6 +79,9 @@ private:
 
 	bool m_bHasSensorListChanged;
 
+	// When set the client iterates the service sample buffers directly instead of keeping a mirror
+	bool m_bUseZeroCopyBuffers;
+
 	//-- Messages -----
 	// Queue of message received from the most recent call to update()
 	// This queue will be emptied automatically at the next call to update().
@@ -4,6 +4,7 @@
 #include "HSLService.h"
 #include "ServiceRequestHandler.h"
 #include "Logger.h"
+#include "SequencedRingBuffer.h"
 
 #include <assert.h>
 
@@ -166,6 +167,17 @@ bool HSL_PollNextMessage(HSLEventMessage *message)
 		return false;
 }
 
+bool HSL_SetClientBufferMode(HSLClientBufferMode buffer_mode)
+{
+	if (g_HSL_client != nullptr)
+	{
+		g_HSL_client->setBufferMode(buffer_mode);
+		return true;
+	}
+
+	return false;
+}
+
 /// Sensor Pool
 HSLSensor *HSL_GetSensor(HSLSensorID sensor_id)
 {
@@ -190,6 +202,94 @@ HSLBufferIterator HSL_GetCapabilityBuffer(HSLSensorID sensor_id, HSLSensorCapabi
 		return CreateInvalidIterator();
 }
 
+HSLBufferIterator HSL_GetCapabilityBufferSince(
+	HSLSensorID sensor_id,
+	HSLSensorCapabilityType cap_type,
+	t_hsl_stream_cursor cursor,
+	t_hsl_stream_cursor *out_next_cursor,
+	uint64_t *out_lost_count)
+{
+	if (g_HSL_client != nullptr)
+		return g_HSL_client->getCapabilityBufferSince(sensor_id, cap_type, cursor, out_next_cursor, out_lost_count);
+	else
+		return CreateInvalidIterator();
+}
+
+size_t HSL_ReadCapabilitySamples(
+	HSLSensorID sensor_id,
+	HSLSensorCapabilityType cap_type,
+	int channel,
+	t_hsl_stream_cursor cursor,
+	float *out_values,
+	double *out_times,
+	size_t max_samples,
+	t_hsl_stream_cursor *out_next_cursor,
+	uint64_t *out_lost_count)
+{
+	if (g_HSL_client != nullptr)
+		return g_HSL_client->readCapabilitySamples(
+			sensor_id, cap_type, channel, cursor, 
+			out_values, out_times, max_samples, 
+			out_next_cursor, out_lost_count);
+	else
+		return 0;
+}
+
+size_t HSL_GetCapabilitySamplesInTimeRange(
+	HSLSensorID sensor_id,
+	HSLSensorCapabilityType cap_type,
+	double start_time,
+	double end_time,
+	HSLBufferSpans *out_spans)
+{
+	if (out_spans == nullptr)
+		return 0;
+
+	if (g_HSL_client != nullptr)
+	{
+		return g_HSL_client->getCapabilitySamplesInTimeRange(sensor_id, cap_type, start_time, end_time, out_spans);
+	}
+	else
+	{
+		memset(out_spans, 0, sizeof(HSLBufferSpans));
+		return 0;
+	}
+}
+
+size_t HSL_GetCapabilitySampleBuckets(
+	HSLSensorID sensor_id,
+	HSLSensorCapabilityType cap_type,
+	int channel,
+	double start_time,
+	double end_time,
+	HSLSampleBucket *out_buckets,
+	size_t max_buckets)
+{
+	if (out_buckets == nullptr)
+		return 0;
+
+	if (g_HSL_client != nullptr)
+		return g_HSL_client->getCapabilitySampleBuckets(sensor_id, cap_type, channel, start_time, end_time, out_buckets, max_buckets);
+	else
+		return 0;
+}
+
+bool HSL_HaveBufferSpansBeenOverrun(const HSLBufferSpans *spans)
+{
+	if (spans == nullptr || spans->bufferState == nullptr)
+		return false;
+
+	const SequencedRingBufferState *buffer_state= 
+		reinterpret_cast<const SequencedRingBufferState *>(spans->bufferState);
+
+	// Storage was reallocated out from under the spans
+	if (buffer_state->getGeneration() != spans->bufferGeneration)
+		return true;
+
+	// The writer has lapped the first frame (or is in the middle of doing so)
+	return spans->spanCount > 0 && spans->firstSequence < buffer_state->getFirstStableSequence();
+}
+
 HSLBufferIterator HSL_GetHeartHrvBuffer(
 	HSLSensorID sensor_id,
 	HSLHeartRateVariabityFilterType filter)
@@ -200,6 +300,16 @@ HSLBufferIterator HSL_GetHeartHrvBuffer(
 		return CreateInvalidIterator();
 }
 
+HSLBufferIterator HSL_GetFilteredCapabilityBuffer(
+	HSLSensorID sensor_id,
+	HSLSensorCapabilityType cap_type)
+{
+	if (g_HSL_client != nullptr)
+		return g_HSL_client->getFilteredCapabilityBuffer(sensor_id, cap_type);
+	else
+		return CreateInvalidIterator();
+}
+
 bool HSL_FlushCapabilityBuffer(HSLSensorID sensor_id, HSLSensorCapabilityType cap_type)
 {
 	if (g_HSL_client != nullptr)
@@ -216,9 +326,33 @@ bool HSL_FlushHeartHrvBuffer(HSLSensorID sensor_id, HSLHeartRateVariabityFilterT
 		return false;
 }
 
+bool HSL_FlushFilteredCapabilityBuffer(HSLSensorID sensor_id, HSLSensorCapabilityType cap_type)
+{
+	if (g_HSL_client != nullptr)
+		return g_HSL_client->flushFilteredCapabilityBuffer(sensor_id, cap_type);
+	else
+		return false;
+}
+
 bool HSL_IsBufferIteratorValid(HSLBufferIterator *iterator)
 {
-	return iterator != nullptr && iterator->remaining > 0;
+	return iterator != nullptr && iterator->remaining > 0 && !HSL_HasBufferIteratorBeenOverrun(iterator);
+}
+
+bool HSL_HasBufferIteratorBeenOverrun(HSLBufferIterator *iterator)
+{
+	if (iterator == nullptr || iterator->bufferState == nullptr)
+		return false;
+
+	const SequencedRingBufferState *buffer_state= 
+		reinterpret_cast<const SequencedRingBufferState *>(iterator->bufferState);
+
+	// Storage was reallocated out from under the iterator
+	if (buffer_state->getGeneration() != iterator->bufferGeneration)
+		return true;
+
+	// The writer has lapped the iterator (or is in the middle of doing so)
+	return iterator->remaining > 0 && iterator->currentSequence < buffer_state->getFirstStableSequence();
 }
 
 void HSL_BufferIteratorReset(HSLBufferIterator* iterator)
@@ -234,12 +368,18 @@ bool HSL_BufferIteratorNext(HSLBufferIterator *iterator)
 		assert(iterator->remaining > 0);
 		assert(iterator->bufferCapacity > 0);
 		iterator->currentIndex = (iterator->currentIndex + 1) % iterator->bufferCapacity;
+		++iterator->currentSequence;
 		--iterator->remaining;
 	}
 
 	return false;
 }
 
+t_hsl_stream_cursor HSL_BufferIteratorGetSequence(HSLBufferIterator *iterator)
+{
+	return (iterator != nullptr) ? iterator->currentSequence : 0;
+}
+
 void* HSL_BufferIteratorGetValueRaw(HSLBufferIterator *iterator)
 {
 	if (HSL_IsBufferIteratorValid(iterator))
@@ -301,6 +441,22 @@ HSLHeartVariabilityFrame* HSL_BufferIteratorGetHRVData(HSLBufferIterator* iterat
         : nullptr;
 }
 
+HSLFilteredECGFrame* HSL_BufferIteratorGetFilteredECGData(HSLBufferIterator* iterator)
+{
+	return
+		(iterator->bufferType == HSLBufferType_FilteredECGData)
+		? (HSLFilteredECGFrame*)HSL_BufferIteratorGetValueRaw(iterator)
+		: nullptr;
+}
+
+HSLFilteredPPGFrame* HSL_BufferIteratorGetFilteredPPGData(HSLBufferIterator* iterator)
+{
+	return
+		(iterator->bufferType == HSLBufferType_FilteredPPGData)
+		? (HSLFilteredPPGFrame*)HSL_BufferIteratorGetValueRaw(iterator)
+		: nullptr;
+}
+
 HSLElectrodermalActivityFrame* HSL_BufferIteratorGetEDAData(HSLBufferIterator* iterator)
 {
 	return
@@ -333,6 +489,54 @@ bool HSL_GetCapabilityBitResolution(HSLSensorID sensor_id, HSLSensorCapabilityTy
 	return result;
 }
 
+bool HSL_GetCapabilityDroppedPacketCount(HSLSensorID sensor_id, HSLSensorCapabilityType cap_type, uint64_t* out_dropped_count)
+{
+	bool result = false;
+
+	if (g_HSL_service != nullptr && IS_VALID_SENSOR_INDEX(sensor_id) && out_dropped_count != nullptr)
+	{
+		result = g_HSL_service->getRequestHandler()->getCapabilityDroppedPacketCount(sensor_id, cap_type, *out_dropped_count);
+	}
+
+	return result;
+}
+
+bool HSL_GetSharedTimelineTime(double* out_timeline_time)
+{
+	bool result = false;
+
+	if (g_HSL_service != nullptr && out_timeline_time != nullptr)
+	{
+		result = g_HSL_service->getRequestHandler()->getSharedTimelineTime(*out_timeline_time);
+	}
+
+	return result;
+}
+
+bool HSL_GetCapabilityTimelineTime(HSLSensorID sensor_id, HSLSensorCapabilityType cap_type, double stream_time, double* out_timeline_time)
+{
+	bool result = false;
+
+	if (g_HSL_service != nullptr && IS_VALID_SENSOR_INDEX(sensor_id) && out_timeline_time != nullptr)
+	{
+		result = g_HSL_service->getRequestHandler()->getCapabilityTimelineTime(sensor_id, cap_type, stream_time, *out_timeline_time);
+	}
+
+	return result;
+}
+
+bool HSL_GetCapabilityStreamTime(HSLSensorID sensor_id, HSLSensorCapabilityType cap_type, double timeline_time, double* out_stream_time)
+{
+	bool result = false;
+
+	if (g_HSL_service != nullptr && IS_VALID_SENSOR_INDEX(sensor_id) && out_stream_time != nullptr)
+	{
+		result = g_HSL_service->getRequestHandler()->getCapabilityStreamTime(sensor_id, cap_type, timeline_time, *out_stream_time);
+	}
+
+	return result;
+}
+
 /// Sensor Requests
 bool HSL_GetSensorList(HSLSensorList *out_sensor_list)
 {
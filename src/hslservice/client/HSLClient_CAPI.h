@@ -59,6 +59,8 @@ typedef enum
 	HSLBufferType_EDAData = 5,		///< Electrodermal Activity (in microSiemens) 
 	// Filtered Data Buffer Types
 	HSLBufferType_HRVData = 6,		///< Heart Rate Variability data 
+	HSLBufferType_FilteredECGData = 7,	///< Electrocardiography after the service side filter bank
+	HSLBufferType_FilteredPPGData = 8,	///< Photoplethysmography after ambient subtraction and the service side filter bank
 
     HSLBufferType_COUNT
 } HSLSensorBufferType;
@@ -87,12 +89,33 @@ typedef enum
 	HRVFilter_pNN50		= 4,	///< The proportion of NN50 divided by total number of NNs.
 	HRVFilter_NN20		= 5,	///< The number of pairs of successive NNs that differ by more than 20 ms.
 	HRVFilter_pNN20		= 6,	///< The proportion of NN20 divided by total number of NNs.
+	HRVFilter_LFPower	= 7,	///< Power of the NN interval series in the low frequency band (0.04-0.15Hz).
+	HRVFilter_HFPower	= 8,	///< Power of the NN interval series in the high frequency band (0.15-0.4Hz).
+	HRVFilter_LFHFRatio	= 9,	///< Ratio of LF to HF power.
 
 	HRVFilter_COUNT
 } HSLHeartRateVariabityFilterType;
 
 typedef unsigned int t_hrv_filter_bitmask;
 
+/// How the client exposes sensor sample buffers
+typedef enum
+{
+	HSLBufferMode_ClientMirror = 0,	///< The client keeps its own copy of every service buffer (default)
+	HSLBufferMode_ZeroCopy = 1,		///< Buffer iterators point straight at the service sample buffers
+} HSLClientBufferMode;
+
+/// Position in a sensor data stream.
+/// Every frame written to a stream is assigned the next 64-bit sequence number in that stream.
+typedef uint64_t t_hsl_stream_cursor;
+
+/// Most samples a single frame of any capability holds on one channel.
+/// HSL_ReadCapabilitySamples only copies whole frames, so its arrays must hold at least this many samples.
+#define HSL_MAX_SAMPLES_PER_FRAME 10
+
+/// Returned by HSL_ReadCapabilitySamples when max_samples is less than HSL_MAX_SAMPLES_PER_FRAME
+#define HSL_READ_SAMPLES_BUFFER_TOO_SMALL ((size_t)-1)
+
 /// Tracking Debug flags
 typedef enum
 {
@@ -168,10 +191,35 @@ typedef struct
 /// Derived Heart Rate
 typedef struct
 {
-	float					hrvValue;
-	double					timeInSeconds;
+	float					hrvValue; // ms for SDANN/RMSSD/SDSD, a count for NN50/NN20, a percentage for pNN50/pNN20, ms^2 for LF/HF power, unitless for the LF/HF ratio
+	double					timeInSeconds; // Stream time of the newest beat in the window
 } HSLHeartVariabilityFrame;
 
+/// ECG after the service side filter bank (baseline wander removal, mains notch, low-pass)
+typedef struct
+{
+	float					ecgValues[10];		// microvolts
+	uint16_t				ecgValueCount;
+	double					timeInSeconds;
+	double					timeDeltaInSeconds;
+} HSLFilteredECGFrame;
+
+/// PPG channels with the ambient light level subtracted, after the service side filter bank
+typedef struct
+{
+	float					ppgValue0;
+	float					ppgValue1;
+	float					ppgValue2;
+} HSLFilteredPPGSample;
+
+typedef struct
+{
+	HSLFilteredPPGSample	ppgSamples[10];
+	uint16_t				ppgSampleCount;
+	double					timeInSeconds;
+	double					timeDeltaInSeconds;
+} HSLFilteredPPGFrame;
+
 /// Skin Electrodermal Activity conductance/resistance measurement
 typedef struct
 {
@@ -228,8 +276,41 @@ typedef struct
 	size_t currentIndex;
 	size_t endIndex;
 	size_t remaining;
+	t_hsl_stream_cursor currentSequence;
+	const void *bufferState;	// Opaque writer state used to detect when the writer lapped the iterator
+	unsigned int bufferGeneration;
 } HSLBufferIterator;
 
+/// A contiguous run of frames inside a sample buffer
+typedef struct
+{
+	const void *frames;
+	size_t frameCount;
+} HSLBufferSpan;
+
+/// Summary of a run of consecutive samples of one channel, see \ref HSL_GetCapabilitySampleBuckets
+typedef struct
+{
+	double startTime;
+	double endTime;
+	float minValue;
+	float maxValue;
+	float meanValue;
+	uint32_t sampleCount;
+} HSLSampleBucket;
+
+/// Up to two contiguous runs of frames (the second is used when the range wraps around the end of the buffer)
+typedef struct
+{
+	HSLSensorBufferType bufferType;
+	size_t stride;
+	HSLBufferSpan spans[2];
+	int spanCount;
+	t_hsl_stream_cursor firstSequence;	// Sequence number of the first frame in spans[0]
+	const void *bufferState;	// Opaque writer state used to detect when the writer lapped the spans
+	unsigned int bufferGeneration;
+} HSLBufferSpans;
+
 // Service Events
 //------------------
 
@@ -347,6 +428,16 @@ HSL_PUBLIC_FUNCTION(bool) HSL_GetVersionString(char *out_version_string, size_t
  */
 HSL_PUBLIC_FUNCTION(bool) HSL_PollNextMessage(HSLEventMessage *out_message);
 
+/** \brief Select how sensor sample buffers are exposed to the client
+	By default the client keeps a mirror of every service sample buffer which is refreshed in \ref HSL_Update.
+	In \ref HSLBufferMode_ZeroCopy the mirrors are freed and buffer iterators point straight at the 
+	service sample buffers. Zero-copy iterators are only good until the service writes over the frame 
+	they point at, so check \ref HSL_HasBufferIteratorBeenOverrun after reading a frame you want to keep.
+	\param buffer_mode The buffer mode to switch to
+	\return true if the mode was applied or false if the client isn't initialized
+ */
+HSL_PUBLIC_FUNCTION(bool) HSL_SetClientBufferMode(HSLClientBufferMode buffer_mode);
+
 // Sensor Pool
 /** \brief Fetches the \ref HSLSensor data for the given Sensor
 	The client API maintains a pool of Sensor structs. 
@@ -359,15 +450,157 @@ HSL_PUBLIC_FUNCTION(bool) HSL_PollNextMessage(HSLEventMessage *out_message);
 HSL_PUBLIC_FUNCTION(HSLSensor *) HSL_GetSensor(HSLSensorID sensor_id);
 
 HSL_PUBLIC_FUNCTION(HSLBufferIterator) HSL_GetCapabilityBuffer(HSLSensorID sensor_id, HSLSensorCapabilityType cap_type);
+
+/** \brief Get an iterator over only the capability frames written after the given cursor
+	Frames are identified by their per-stream sequence number, so no frames are skipped or repeated
+	even when frame timestamps repeat. Pass 0 as the cursor on the first call and the returned 
+	next cursor on every call after that.
+	If the service keeps an on-disk ECG/PPG history (sample_history_file_hours in the SensorManagerConfig),
+	a cursor older than the in-memory buffer is served from the history instead.
+	\param sensor_id The id of the sensor to read frames from
+	\param cap_type The capability stream to read
+	\param cursor The sequence number of the first frame the caller has not seen yet
+	\param[out] out_next_cursor The cursor to pass in on the next call (optional)
+	\param[out] out_lost_count Number of frames after the cursor no longer in the buffer, 
+	i.e. overwritten or flushed before they were read (optional)
+	\return An iterator over the new frames (invalid if there are none)
+ */
+HSL_PUBLIC_FUNCTION(HSLBufferIterator) HSL_GetCapabilityBufferSince(
+	HSLSensorID sensor_id, 
+	HSLSensorCapabilityType cap_type, 
+	t_hsl_stream_cursor cursor,
+	t_hsl_stream_cursor *out_next_cursor,
+	uint64_t *out_lost_count);
+
+/** \brief Copy one channel of a capability stream into flat caller owned sample arrays
+	Unlike the buffer iterators this produces one entry per sample rather than per frame,
+	with the per-sample time already worked out, ready to hand to DSP or plotting code.
+	Channels per capability:
+	- HeartRate: 0 = beats per minute, 1 = RR interval (seconds)
+	- Electrocardiography: 0 = microvolts
+	- Photoplethysmography: 0-2 = PPG0-PPG2, 3 = ambient
+	- PulseInterval: 0 = pulse duration (ms), 1 = beats per minute, 2 = pulse duration error estimate (ms)
+	- Accelerometer: 0 = x, 1 = y, 2 = z (g-units)
+	- ElectrodermalActivity: 0 = conductance (microSiemens), 1 = resistance (ohms), 2 = raw ADC value
+	Only whole frames are copied, so max_samples must be at least \ref HSL_MAX_SAMPLES_PER_FRAME.
+	Keep calling with the returned cursor until it returns 0 to drain the stream.
+	ECG and PPG frames older than the in-memory buffer are decoded from the compressed on-disk history
+	when the service keeps one (sample_history_compressed in the SensorManagerConfig).
+	Times read back from the compressed history are rounded to the microsecond.
+	\param sensor_id The id of the sensor to read samples from
+	\param cap_type The capability stream to read
+	\param channel Which value of each sample to read (see above)
+	\param cursor The cursor returned by the previous read (0 on the first call)
+	\param[out] out_values Array of at least max_samples sample values
+	\param[out] out_times Array of at least max_samples sample times in seconds (optional)
+	\param max_samples The capacity of the output arrays (at least \ref HSL_MAX_SAMPLES_PER_FRAME)
+	\param[out] out_next_cursor The cursor to pass in on the next call (optional)
+	\param[out] out_lost_count Number of frames after the cursor no longer in the buffer (optional)
+	\return The number of samples written to the output arrays, or \ref HSL_READ_SAMPLES_BUFFER_TOO_SMALL
+	        (with the cursor left where it was) if max_samples can't fit a whole frame
+ */
+HSL_PUBLIC_FUNCTION(size_t) HSL_ReadCapabilitySamples(
+	HSLSensorID sensor_id,
+	HSLSensorCapabilityType cap_type,
+	int channel,
+	t_hsl_stream_cursor cursor,
+	float *out_values,
+	double *out_times,
+	size_t max_samples,
+	t_hsl_stream_cursor *out_next_cursor,
+	uint64_t *out_lost_count);
+/** \brief Find the capability frames with timestamps in the given time range
+	The sample buffer is binary searched by frame timestamp (which only ever increases within a stream),
+	so this is O(log N) in the size of the sample history. The matching frames are returned as
+	one or two contiguous spans pointing straight into the client's sample buffer.
+	The spans are only good until the next call to \ref HSL_Update 
+	(or until the writer laps them in zero-copy mode, see \ref HSL_HaveBufferSpansBeenOverrun).
+	Ranges starting before the in-memory buffer are served from the on-disk ECG/PPG history when there is one.
+	\param sensor_id The id of the sensor to read frames from
+	\param cap_type The capability stream to read
+	\param start_time Frames with a timeInSeconds before this are skipped
+	\param end_time Frames with a timeInSeconds after this are skipped
+	\param[out] out_spans The spans of matching frames
+	\return The number of frames in the time range
+ */
+HSL_PUBLIC_FUNCTION(size_t) HSL_GetCapabilitySamplesInTimeRange(
+	HSLSensorID sensor_id,
+	HSLSensorCapabilityType cap_type,
+	double start_time,
+	double end_time,
+	HSLBufferSpans *out_spans);
+
+/** \brief Summarize one channel of a capability stream over a time range with at most max_buckets buckets
+	Meant for plotting long histories: the service keeps a min/max/mean pyramid of the ECG, PPG 
+	and accelerometer streams (covering sample_pyramid_minutes in the SensorManagerConfig)
+	so the cost of this call scales with max_buckets rather than with the number of samples in the range.
+	Buckets at either end of the range may extend a little past it.
+	\param sensor_id The id of the sensor to read from
+	\param cap_type The capability stream to read (Electrocardiography, Photoplethysmography or Accelerometer)
+	\param channel Which value of each sample to summarize (same channels as \ref HSL_ReadCapabilitySamples)
+	\param start_time Start of the time range in seconds
+	\param end_time End of the time range in seconds
+	\param[out] out_buckets Array of at least max_buckets buckets, oldest first
+	\param max_buckets The capacity of the output array (i.e. the plot width in pixels)
+	\return The number of buckets written
+ */
+HSL_PUBLIC_FUNCTION(size_t) HSL_GetCapabilitySampleBuckets(
+	HSLSensorID sensor_id,
+	HSLSensorCapabilityType cap_type,
+	int channel,
+	double start_time,
+	double end_time,
+	HSLSampleBucket *out_buckets,
+	size_t max_buckets);
+
+/** \brief Check if the buffer writer has overwritten any of the frames in the given spans
+	\param spans The spans returned by \ref HSL_GetCapabilitySamplesInTimeRange
+	\return true if any of the frames in the spans can no longer be trusted
+ */
+HSL_PUBLIC_FUNCTION(bool) HSL_HaveBufferSpansBeenOverrun(const HSLBufferSpans *spans);
 HSL_PUBLIC_FUNCTION(HSLBufferIterator) HSL_GetHeartHrvBuffer(HSLSensorID sensor_id, HSLHeartRateVariabityFilterType filter);
 
+/** \brief Get an iterator over the filtered version of a waveform stream
+	ECG and PPG streams are run through a filter bank in the service (configured per sensor with the
+	ecg_filter_* and ppg_filter_* settings in the sensor config) and published next to the raw stream.
+	Frames line up one to one with the raw stream's frames and carry the same timestamps.
+	\param sensor_id The id of the sensor
+	\param cap_type HSLCapability_Electrocardiography or HSLCapability_Photoplethysmography
+	\return An iterator over \ref HSLFilteredECGFrame or \ref HSLFilteredPPGFrame frames
+	        (invalid for other capabilities, empty if the stream's filter is disabled)
+ */
+HSL_PUBLIC_FUNCTION(HSLBufferIterator) HSL_GetFilteredCapabilityBuffer(HSLSensorID sensor_id, HSLSensorCapabilityType cap_type);
+
 HSL_PUBLIC_FUNCTION(bool) HSL_FlushCapabilityBuffer(HSLSensorID sensor_id, HSLSensorCapabilityType cap_type);
 HSL_PUBLIC_FUNCTION(bool) HSL_FlushHeartHrvBuffer(HSLSensorID sensor_id, HSLHeartRateVariabityFilterType filter);
 
+/** \brief Drop all frames from the client's copy of a filtered waveform stream
+	Only the filtered buffer is cleared, the raw stream (see \ref HSL_FlushCapabilityBuffer) is left alone.
+	\param sensor_id The id of the sensor
+	\param cap_type HSLCapability_Electrocardiography or HSLCapability_Photoplethysmography
+	\return true if the buffer was flushed, false for an invalid sensor or other capabilities
+ */
+HSL_PUBLIC_FUNCTION(bool) HSL_FlushFilteredCapabilityBuffer(HSLSensorID sensor_id, HSLSensorCapabilityType cap_type);
+
 HSL_PUBLIC_FUNCTION(bool) HSL_IsBufferIteratorValid(HSLBufferIterator *iterator);
+
+/** \brief Check if the buffer writer has overwritten the frame an iterator points at
+	Happens when a zero-copy iterator is held across calls to \ref HSL_Update or the buffer was resized.
+	\param iterator The iterator to test
+	\return true if the current frame can no longer be trusted
+ */
+HSL_PUBLIC_FUNCTION(bool) HSL_HasBufferIteratorBeenOverrun(HSLBufferIterator *iterator);
 HSL_PUBLIC_FUNCTION(void) HSL_BufferIteratorReset(HSLBufferIterator* iterator);
 HSL_PUBLIC_FUNCTION(bool) HSL_BufferIteratorNext(HSLBufferIterator *iterator);
 
+/** \brief Get the stream sequence number of the frame an iterator points at
+	Sequence numbers count every frame ever written to the stream, so one plus the sequence of the
+	last frame read is the cursor to pass to \ref HSL_GetCapabilityBufferSince to resume after it.
+	\param iterator The iterator to query
+	\return The sequence number of the current frame (0 for a null iterator)
+ */
+HSL_PUBLIC_FUNCTION(t_hsl_stream_cursor) HSL_BufferIteratorGetSequence(HSLBufferIterator *iterator);
+
 HSL_PUBLIC_FUNCTION(void *) HSL_BufferIteratorGetValueRaw(HSLBufferIterator *iterator);
 HSL_PUBLIC_FUNCTION(HSLHeartRateFrame *) HSL_BufferIteratorGetHRData(HSLBufferIterator *iterator);
 HSL_PUBLIC_FUNCTION(HSLHeartECGFrame *) HSL_BufferIteratorGetECGData(HSLBufferIterator *iterator);
@@ -376,10 +609,54 @@ HSL_PUBLIC_FUNCTION(HSLHeartPPIFrame *) HSL_BufferIteratorGetPPIData(HSLBufferIt
 HSL_PUBLIC_FUNCTION(HSLAccelerometerFrame *) HSL_BufferIteratorGetAccData(HSLBufferIterator *iterator);
 HSL_PUBLIC_FUNCTION(HSLElectrodermalActivityFrame*) HSL_BufferIteratorGetEDAData(HSLBufferIterator* iterator);
 HSL_PUBLIC_FUNCTION(HSLHeartVariabilityFrame *) HSL_BufferIteratorGetHRVData(HSLBufferIterator *iterator);
+HSL_PUBLIC_FUNCTION(HSLFilteredECGFrame *) HSL_BufferIteratorGetFilteredECGData(HSLBufferIterator *iterator);
+HSL_PUBLIC_FUNCTION(HSLFilteredPPGFrame *) HSL_BufferIteratorGetFilteredPPGData(HSLBufferIterator *iterator);
 
 HSL_PUBLIC_FUNCTION(bool) HSL_GetCapabilitySamplingRate(HSLSensorID sensor_id, HSLSensorCapabilityType cap_type, int* out_sampling_rate);
 HSL_PUBLIC_FUNCTION(bool) HSL_GetCapabilityBitResolution(HSLSensorID sensor_id, HSLSensorCapabilityType cap_type, int* out_resolution);
 
+/** \brief Get the number of sensor packets of the given capability dropped by the service
+	Sensor packets are handed from the bluetooth threads to \ref HSL_Update through fixed size queues.
+	If \ref HSL_Update isn't called often enough those queues fill up and packets are dropped 
+	according to the overflow policy of each stream in SensorManagerConfig.json.
+	\param sensor_id The id of the sensor
+	\param cap_type The sensor capability stream to query
+	\param[out] out_dropped_count Total number of packets dropped since the sensor was opened
+	\return true if the count was fetched or false if the sensor or capability is invalid
+ */
+HSL_PUBLIC_FUNCTION(bool) HSL_GetCapabilityDroppedPacketCount(HSLSensorID sensor_id, HSLSensorCapabilityType cap_type, uint64_t* out_dropped_count);
+
+/** \brief Get the current time on the shared timeline
+	Frame timestamps (timeInSeconds) count from the start of their own stream in the sensor's own clock.
+	The service continuously fits every stream against the host monotonic clock so that any stream time 
+	can be mapped onto one shared timeline: seconds on the host monotonic clock since the service started.
+	\param[out] out_timeline_time The current shared timeline time in seconds
+	\return true if the time was fetched or false if the service isn't running
+ */
+HSL_PUBLIC_FUNCTION(bool) HSL_GetSharedTimelineTime(double* out_timeline_time);
+
+/** \brief Map a capability stream timestamp onto the shared timeline
+	Use this to line up samples from different sensors (or different streams of one sensor).
+	The mapping is refined with every packet, so convert timestamps close to when they are used.
+	\param sensor_id The id of the sensor
+	\param cap_type The capability stream the timestamp came from
+	\param stream_time A timeInSeconds value from the stream
+	\param[out] out_timeline_time The same instant on the shared timeline
+	\return true if the time was mapped or false if the stream hasn't delivered any data yet
+ */
+HSL_PUBLIC_FUNCTION(bool) HSL_GetCapabilityTimelineTime(HSLSensorID sensor_id, HSLSensorCapabilityType cap_type, double stream_time, double* out_timeline_time);
+
+/** \brief Map a shared timeline time back onto a capability stream's own timestamps
+	The inverse of \ref HSL_GetCapabilityTimelineTime, i.e. for picking the same time window 
+	out of several streams with \ref HSL_GetCapabilitySamplesInTimeRange.
+	\param sensor_id The id of the sensor
+	\param cap_type The capability stream to map onto
+	\param timeline_time A time on the shared timeline
+	\param[out] out_stream_time The same instant in the stream's timeInSeconds
+	\return true if the time was mapped or false if the stream hasn't delivered any data yet
+ */
+HSL_PUBLIC_FUNCTION(bool) HSL_GetCapabilityStreamTime(HSLSensorID sensor_id, HSLSensorCapabilityType cap_type, double timeline_time, double* out_stream_time);
+
 // Sensor Requests
 /** \brief Requests a list of the streamable Sensors currently connected to HSLService.
 	Sends a request to HSLService to get the list of currently streamable Sensors.
@@ -10,6 +10,17 @@
 
 // -- definitions -----
 
+/// Service side preprocessing applied to a waveform stream before it's published as its filtered buffer.
+/// Each stage is skipped when its frequency is 0.
+struct SensorFilterSettings
+{
+	bool enabled;
+	float highPassHz;	// Baseline wander removal
+	float notchHz;		// Mains interference (50 or 60)
+	float notchQ;
+	float lowPassHz;	// Muscle and high frequency noise
+};
+
 /// Interface base class for any device interface. Further defined in specific device abstractions.
 class IDeviceInterface
 {
@@ -47,21 +58,29 @@ public:
 		EDAFrame
 	};
 
-	struct SensorPacket
+	// Max number of frames per batch (a full MTU of ECG data is 8 frames).
+	// Notifications that decode into more frames than this are sent as several batches.
+	static const int k_max_frames_per_batch = 8;
+
+	// All of the frames decoded from a single sensor notification.
+	// Handed off to the main thread as one queue entry and appended to the sample buffer in one copy.
+	struct SensorPacketBatch
 	{
 		union {
-			HSLHeartRateFrame hrFrame;
-			HSLHeartECGFrame ecgFrame;
-			HSLHeartPPGFrame ppgFrame;
-			HSLHeartPPIFrame ppiFrame;
-			HSLAccelerometerFrame accFrame;
-			HSLElectrodermalActivityFrame edaFrame;
+			HSLHeartRateFrame hrFrames[k_max_frames_per_batch];
+			HSLHeartECGFrame ecgFrames[k_max_frames_per_batch];
+			HSLHeartPPGFrame ppgFrames[k_max_frames_per_batch];
+			HSLHeartPPIFrame ppiFrames[k_max_frames_per_batch];
+			HSLAccelerometerFrame accFrames[k_max_frames_per_batch];
+			HSLElectrodermalActivityFrame edaFrames[k_max_frames_per_batch];
 		} payload;
 		SensorPacketPayloadType payloadType;
+		int frameCount;
 	};
 
-	// Called when new sensor state has been read from the sensor
-	virtual void notifySensorDataReceived(const SensorPacket *sensor_state) = 0;
+	// Called when new sensor state has been read from the sensor.
+	// Calls for any one payload type must not overlap (i.e. only come from that stream's characteristic callback).
+	virtual void notifySensorDataReceived(const SensorPacketBatch *sensor_batch) = 0;
 };
 
 /// Abstract class for sensor interface. 
@@ -114,6 +133,9 @@ public:
 
 	// Sets the HRV recording history time (in samples)
 	virtual void setHeartRateVariabliyHistorySize(int sample_count) = 0;
+
+	// Get the filter bank settings for a waveform capability (false if the capability isn't filtered)
+	virtual bool getCapabilityFilterSettings(HSLSensorCapabilityType cap_type, SensorFilterSettings& out_settings) const = 0;
 };
 
 #endif // DEVICE_INTERFACE_H
@@ -0,0 +1,142 @@
+//-- includes -----
+#include "ClockDomainManager.h"
+
+#include <algorithm>
+#include <chrono>
+
+//-- constants -----
+// Roughly the last thousand packets of a stream contribute to its fit
+static const double k_arrival_fit_forgetting_factor = 0.999;
+
+// How fast (seconds per second) the latency floor is allowed to rise when no packet gets through quicker.
+// Lets the alignment follow a link whose minimum latency went up (i.e. a new connection interval).
+static const double k_arrival_floor_relax_rate = 0.001;
+
+// A stream time this far behind the last one means the stream was restarted
+static const double k_stream_restart_threshold = 1.0;
+
+//-- ClockDomain -----
+void ClockDomainManager::ClockDomain::reset()
+{
+	arrivalFit = WeightedLinearFit(k_arrival_fit_forgetting_factor);
+	arrivalFloor = 0.0;
+	lastStreamTime = 0.0;
+	lastHostTime = 0.0;
+	bHasObservations = false;
+}
+
+//-- ClockDomainManager -----
+ClockDomainManager::ClockDomainManager()
+	: m_timelineEpoch(getHostTime())
+{
+	for (int sensor_id = 0; sensor_id < HSLSERVICE_MAX_SENSOR_COUNT; ++sensor_id)
+	{
+		resetSensor(sensor_id);
+	}
+}
+
+double ClockDomainManager::getHostTime()
+{
+	return std::chrono::duration_cast<std::chrono::duration<double>>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+double ClockDomainManager::getTimelineTime() const
+{
+	return getHostTime() - m_timelineEpoch;
+}
+
+void ClockDomainManager::resetSensor(int sensor_id)
+{
+	if (sensor_id < 0 || sensor_id >= HSLSERVICE_MAX_SENSOR_COUNT)
+		return;
+
+	for (int cap_index = 0; cap_index < HSLCapability_COUNT; ++cap_index)
+	{
+		m_clockDomains[sensor_id][cap_index].reset();
+	}
+}
+
+void ClockDomainManager::addObservation(
+	int sensor_id, 
+	HSLSensorCapabilityType cap_type, 
+	double stream_time, 
+	double host_time)
+{
+	if (getClockDomain(sensor_id, cap_type) == nullptr)
+		return;
+
+	ClockDomain &domain = m_clockDomains[sensor_id][cap_type];
+
+	if (domain.bHasObservations && stream_time < domain.lastStreamTime - k_stream_restart_threshold)
+	{
+		domain.reset();
+	}
+
+	domain.arrivalFit.addPoint(stream_time, host_time);
+
+	// Arrivals are only ever late, so the quickest ones are the best estimate of when the sample was taken
+	const double residual = host_time - domain.arrivalFit.evaluate(stream_time, 1.0);
+
+	if (domain.bHasObservations)
+	{
+		const double relaxed_floor =
+			domain.arrivalFloor + k_arrival_floor_relax_rate * std::max(host_time - domain.lastHostTime, 0.0);
+
+		domain.arrivalFloor = std::min(residual, relaxed_floor);
+	}
+	else
+	{
+		domain.arrivalFloor = residual;
+	}
+
+	domain.lastStreamTime = stream_time;
+	domain.lastHostTime = host_time;
+	domain.bHasObservations = true;
+}
+
+bool ClockDomainManager::streamTimeToTimeline(
+	int sensor_id, 
+	HSLSensorCapabilityType cap_type, 
+	double stream_time, 
+	double &out_timeline_time) const
+{
+	const ClockDomain *domain = getClockDomain(sensor_id, cap_type);
+
+	if (domain == nullptr || !domain->bHasObservations)
+		return false;
+
+	// Until drift is measurable assume the device and host clocks run at the same rate
+	out_timeline_time = 
+		domain->arrivalFit.evaluate(stream_time, 1.0) + domain->arrivalFloor - m_timelineEpoch;
+
+	return true;
+}
+
+bool ClockDomainManager::timelineToStreamTime(
+	int sensor_id, 
+	HSLSensorCapabilityType cap_type, 
+	double timeline_time, 
+	double &out_stream_time) const
+{
+	const ClockDomain *domain = getClockDomain(sensor_id, cap_type);
+
+	if (domain == nullptr || !domain->bHasObservations)
+		return false;
+
+	out_stream_time = 
+		domain->arrivalFit.evaluateInverse(timeline_time + m_timelineEpoch - domain->arrivalFloor, 1.0);
+
+	return true;
+}
+
+const ClockDomainManager::ClockDomain *ClockDomainManager::getClockDomain(
+	int sensor_id, 
+	HSLSensorCapabilityType cap_type) const
+{
+	if (sensor_id < 0 || sensor_id >= HSLSERVICE_MAX_SENSOR_COUNT ||
+		cap_type < 0 || cap_type >= HSLCapability_COUNT)
+		return nullptr;
+
+	return &m_clockDomains[sensor_id][cap_type];
+}
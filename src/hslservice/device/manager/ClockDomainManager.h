@@ -0,0 +1,59 @@
+#ifndef CLOCK_DOMAIN_MANAGER_H
+#define CLOCK_DOMAIN_MANAGER_H
+
+//-- includes -----
+#include "HSLClient_CAPI.h"
+#include "StreamClockModel.h"
+
+//-- definitions -----
+// Puts every sensor stream on one shared timeline.
+// Each stream's timeInSeconds counts from its own stream start in its own device clock,
+// so streams from different sensors (or even different streams of one sensor) can't be compared directly.
+// For every stream the manager keeps a drifting fit of packet arrival time on the host monotonic clock
+// against the stream time of the newest sample in the packet:
+// - the slope follows the rate difference between the device and host clocks
+// - the offset tracks the lower envelope of the arrivals (the least delayed packets), so the
+//   radio latency of each link isn't baked into its alignment
+// The shared timeline is seconds on the host monotonic clock since the service started.
+// Only touched from the main thread (fed from ServerSensorView::processDevicePacketQueues).
+class ClockDomainManager
+{
+public:
+	ClockDomainManager();
+
+	// Seconds on the host monotonic clock, the time packet arrivals are stamped with
+	static double getHostTime();
+
+	// Current time on the shared timeline
+	double getTimelineTime() const;
+
+	// Forget every stream of a sensor (i.e. when it is closed)
+	void resetSensor(int sensor_id);
+
+	// A packet whose newest sample was at stream_time arrived at host_time
+	void addObservation(int sensor_id, HSLSensorCapabilityType cap_type, double stream_time, double host_time);
+
+	// Map between a stream's own time and the shared timeline.
+	// Return false until the stream has seen a packet.
+	bool streamTimeToTimeline(int sensor_id, HSLSensorCapabilityType cap_type, double stream_time, double &out_timeline_time) const;
+	bool timelineToStreamTime(int sensor_id, HSLSensorCapabilityType cap_type, double timeline_time, double &out_stream_time) const;
+
+private:
+	struct ClockDomain
+	{
+		WeightedLinearFit arrivalFit; // Host arrival time against stream time
+		double arrivalFloor; // Offset from the fit down to the least delayed arrivals
+		double lastStreamTime;
+		double lastHostTime;
+		bool bHasObservations;
+
+		void reset();
+	};
+
+	const ClockDomain *getClockDomain(int sensor_id, HSLSensorCapabilityType cap_type) const;
+
+	double m_timelineEpoch; // Host time of timeline zero
+	ClockDomain m_clockDomains[HSLSERVICE_MAX_SENSOR_COUNT][HSLCapability_COUNT];
+};
+
+#endif // CLOCK_DOMAIN_MANAGER_H
@@ -1,12 +1,33 @@
 //-- includes -----
 #include "BluetoothQueries.h"
+#include "ClockDomainManager.h"
 #include "SensorManager.h"
 #include "SensorDeviceEnumerator.h"
 #include "SensorBluetoothLEDeviceEnumerator.h"
 #include "Logger.h"
 #include "HSLClient_CAPI.h"
+#include "SampleBufferArena.h"
 #include "ServerSensorView.h"
 #include "ServerDeviceView.h"
+#include "Utility.h"
+
+#include <algorithm>
+
+//-- private methods -----
+static const char* overflow_policy_to_string(SensorPacketOverflowPolicy policy)
+{
+	return (policy == SensorPacketOverflowPolicy::DropOldest) ? "drop_oldest" : "drop_newest";
+}
+
+static SensorPacketOverflowPolicy string_to_overflow_policy(const std::string& policy_string, SensorPacketOverflowPolicy default_policy)
+{
+	if (policy_string == "drop_oldest")
+		return SensorPacketOverflowPolicy::DropOldest;
+	else if (policy_string == "drop_newest")
+		return SensorPacketOverflowPolicy::DropNewest;
+	else
+		return default_policy;
+}
 
 //-- methods -----
 //-- Tracker Manager Config -----
@@ -16,6 +37,22 @@ SensorManagerConfig::SensorManagerConfig(const std::string &fnamebase)
 	: HSLConfig(fnamebase)
 	, version(SensorManagerConfig::CONFIG_VERSION)
 	, heartRateTimeoutMilliSeconds(3000)
+	, sampleBufferArenaKilobytesPerSensor(256)
+	, samplePyramidMinutes(30.f)
+	, sampleHistoryFileHours(0.f)
+	, sampleHistoryCompressed(true)
+	, sampleHistoryFileDirectory("")
+	, hrvWindowSeconds(60.f)
+	, sdannSegmentMinutes(5.f)
+	, hrvSpectrumWindowSeconds(300.f)
+	, ppgBeatDetection(true)
+	// Low rate streams keep the freshest value, waveform streams keep a gap free history
+	, hrOverflowPolicy(SensorPacketOverflowPolicy::DropOldest)
+	, ecgOverflowPolicy(SensorPacketOverflowPolicy::DropNewest)
+	, ppgOverflowPolicy(SensorPacketOverflowPolicy::DropNewest)
+	, ppiOverflowPolicy(SensorPacketOverflowPolicy::DropOldest)
+	, accOverflowPolicy(SensorPacketOverflowPolicy::DropNewest)
+	, edaOverflowPolicy(SensorPacketOverflowPolicy::DropOldest)
 {
 
 };
@@ -24,7 +61,22 @@ const configuru::Config SensorManagerConfig::writeToJSON()
 {
 	configuru::Config pt{
 		{"version", SensorManagerConfig::CONFIG_VERSION},
-		{"heart_rate_timeout_milliseconds", heartRateTimeoutMilliSeconds}
+		{"heart_rate_timeout_milliseconds", heartRateTimeoutMilliSeconds},
+		{"sample_buffer_arena_kilobytes_per_sensor", sampleBufferArenaKilobytesPerSensor},
+		{"sample_pyramid_minutes", samplePyramidMinutes},
+		{"sample_history_file_hours", sampleHistoryFileHours},
+		{"sample_history_compressed", sampleHistoryCompressed},
+		{"sample_history_file_directory", sampleHistoryFileDirectory},
+		{"hrv_window_seconds", hrvWindowSeconds},
+		{"sdann_segment_minutes", sdannSegmentMinutes},
+		{"hrv_spectrum_window_seconds", hrvSpectrumWindowSeconds},
+		{"ppg_beat_detection", ppgBeatDetection},
+		{"hr_overflow_policy", overflow_policy_to_string(hrOverflowPolicy)},
+		{"ecg_overflow_policy", overflow_policy_to_string(ecgOverflowPolicy)},
+		{"ppg_overflow_policy", overflow_policy_to_string(ppgOverflowPolicy)},
+		{"ppi_overflow_policy", overflow_policy_to_string(ppiOverflowPolicy)},
+		{"acc_overflow_policy", overflow_policy_to_string(accOverflowPolicy)},
+		{"eda_overflow_policy", overflow_policy_to_string(edaOverflowPolicy)}
 	};
 
 	return pt;
@@ -37,6 +89,21 @@ void SensorManagerConfig::readFromJSON(const configuru::Config &pt)
 	if (version == SensorManagerConfig::CONFIG_VERSION)
 	{
 		heartRateTimeoutMilliSeconds= pt.get_or<int>("heart_rate_timeout_milliseconds", heartRateTimeoutMilliSeconds);
+		sampleBufferArenaKilobytesPerSensor= pt.get_or<int>("sample_buffer_arena_kilobytes_per_sensor", sampleBufferArenaKilobytesPerSensor);
+		samplePyramidMinutes= pt.get_or<float>("sample_pyramid_minutes", samplePyramidMinutes);
+		sampleHistoryFileHours= pt.get_or<float>("sample_history_file_hours", sampleHistoryFileHours);
+		sampleHistoryCompressed= pt.get_or<bool>("sample_history_compressed", sampleHistoryCompressed);
+		sampleHistoryFileDirectory= pt.get_or<std::string>("sample_history_file_directory", sampleHistoryFileDirectory);
+		hrvWindowSeconds= pt.get_or<float>("hrv_window_seconds", hrvWindowSeconds);
+		sdannSegmentMinutes= pt.get_or<float>("sdann_segment_minutes", sdannSegmentMinutes);
+		hrvSpectrumWindowSeconds= pt.get_or<float>("hrv_spectrum_window_seconds", hrvSpectrumWindowSeconds);
+		ppgBeatDetection= pt.get_or<bool>("ppg_beat_detection", ppgBeatDetection);
+		hrOverflowPolicy= string_to_overflow_policy(pt.get_or<std::string>("hr_overflow_policy", ""), hrOverflowPolicy);
+		ecgOverflowPolicy= string_to_overflow_policy(pt.get_or<std::string>("ecg_overflow_policy", ""), ecgOverflowPolicy);
+		ppgOverflowPolicy= string_to_overflow_policy(pt.get_or<std::string>("ppg_overflow_policy", ""), ppgOverflowPolicy);
+		ppiOverflowPolicy= string_to_overflow_policy(pt.get_or<std::string>("ppi_overflow_policy", ""), ppiOverflowPolicy);
+		accOverflowPolicy= string_to_overflow_policy(pt.get_or<std::string>("acc_overflow_policy", ""), accOverflowPolicy);
+		edaOverflowPolicy= string_to_overflow_policy(pt.get_or<std::string>("eda_overflow_policy", ""), edaOverflowPolicy);
 	}
 	else
 	{
@@ -49,6 +116,8 @@ void SensorManagerConfig::readFromJSON(const configuru::Config &pt)
 //-- Sensor Manager -----
 SensorManager::SensorManager()
 	: DeviceTypeManager(1000, 2)
+	, m_sampleBufferArena(nullptr)
+	, m_clockDomainManager(nullptr)
 {
 }
 
@@ -64,6 +133,14 @@ bool SensorManager::startup()
 		// Save back out the config in case there were updated defaults
 		m_config.save();
 
+		// Reserve all of the sample buffer storage up front.
+		// Sensor views lay their rings out in this when they are opened.
+		const size_t partition_size= (size_t)std::max(m_config.sampleBufferArenaKilobytesPerSensor, 0) * 1024;
+		m_sampleBufferArena= new SampleBufferArena(2*k_max_devices, partition_size);
+
+		// Starts the shared timeline every sensor stream is aligned onto
+		m_clockDomainManager= new ClockDomainManager();
+
 		success = true;
 	}
 
@@ -81,6 +158,35 @@ bool SensorManager::startup()
 void SensorManager::shutdown()
 {
 	DeviceTypeManager::shutdown();
+
+	if (m_sampleBufferArena != nullptr)
+	{
+		delete m_sampleBufferArena;
+		m_sampleBufferArena= nullptr;
+	}
+
+	if (m_clockDomainManager != nullptr)
+	{
+		delete m_clockDomainManager;
+		m_clockDomainManager= nullptr;
+	}
+}
+
+std::string SensorManager::getSampleHistoryFilePath(int device_id, const std::string &stream_name) const
+{
+	std::string directory= m_config.sampleHistoryFileDirectory;
+
+	if (directory.empty())
+	{
+		directory= Utility::get_home_directory() + "/HSLSERVICE/history";
+	}
+
+	if (!Utility::create_directory(directory))
+	{
+		HSL_LOG_ERROR("SensorManager::getSampleHistoryFilePath") << "Failed to create history directory: " << directory;
+	}
+
+	return directory + "/sensor" + std::to_string(device_id) + "_" + stream_name + ".hslhistory";
 }
 
 void SensorManager::processDevicePacketQueues()
@@ -14,6 +14,13 @@ class ServerSensorView;
 typedef std::shared_ptr<ServerSensorView> ServerSensorViewPtr;
 
 //-- definitions -----
+// What a sensor stream does when its packet queue to the main thread is full
+enum class SensorPacketOverflowPolicy : int
+{
+	DropNewest,	// Keep what's already queued and throw away the incoming packet
+	DropOldest	// Throw away the oldest queued packets to make room for the incoming one
+};
+
 class SensorManagerConfig : public HSLConfig
 {
 public:
@@ -26,6 +33,38 @@ public:
 
 	int version;
 	int heartRateTimeoutMilliSeconds;
+
+	// Size of the sample buffer arena partition reserved for each sensor slot (one each for service and client)
+	int sampleBufferArenaKilobytesPerSensor;
+
+	// Minutes of ECG, PPG and accelerometer data summarized in the min/max/mean plotting pyramids (0 disables them)
+	float samplePyramidMinutes;
+
+	// Hours of ECG and PPG history to spill into memory mapped files per sensor (0 disables the disk history)
+	float sampleHistoryFileHours;
+	// Keep the history as compressed blocks (4-8x smaller, only readable through HSL_ReadCapabilitySamples)
+	// instead of raw frames (readable through the buffer iterators and time range spans as well)
+	bool sampleHistoryCompressed;
+	// Where the history files are kept (empty uses a "history" folder next to the config files)
+	std::string sampleHistoryFileDirectory;
+
+	// Seconds of beat to beat intervals the sliding window HRV filters (RMSSD, SDSD, NN50, ...) are computed over
+	float hrvWindowSeconds;
+	// Length of the segments whose mean NN intervals the SDANN filter takes the deviation of
+	float sdannSegmentMinutes;
+	// Seconds of beat to beat intervals the frequency domain HRV filters (LF/HF power) are computed over
+	float hrvSpectrumWindowSeconds;
+
+	// Find beats in raw PPG and publish them as pulse intervals when the sensor isn't streaming its own PPI
+	bool ppgBeatDetection;
+
+	// Per stream overflow behavior of the BLE thread -> main thread packet queues
+	SensorPacketOverflowPolicy hrOverflowPolicy;
+	SensorPacketOverflowPolicy ecgOverflowPolicy;
+	SensorPacketOverflowPolicy ppgOverflowPolicy;
+	SensorPacketOverflowPolicy ppiOverflowPolicy;
+	SensorPacketOverflowPolicy accOverflowPolicy;
+	SensorPacketOverflowPolicy edaOverflowPolicy;
 };
 
 class SensorManager : public DeviceTypeManager
@@ -45,6 +84,14 @@ public:
 	ServerSensorViewPtr getSensorViewPtr(int device_id);
 
 	inline const SensorManagerConfig& getConfig() const { return m_config; }
+	inline class SampleBufferArena* getSampleBufferArena() const { return m_sampleBufferArena; }
+	inline class ClockDomainManager* getClockDomainManager() const { return m_clockDomainManager; }
+	std::string getSampleHistoryFilePath(int device_id, const std::string &stream_name) const;
+
+	// Each sensor slot gets one partition of the sample buffer arena for the service rings and one for the client mirrors
+	static inline int getServiceSampleBufferPartition(int device_id) { return device_id; }
+	static inline int getClientSampleBufferPartition(int device_id) { return k_max_devices + device_id; }
+
 	inline const std::string& getBluetoothHostAddress() const { return m_bluetooth_host_address; }
 
 	// Process the update packets from the IMU threads
@@ -61,6 +108,8 @@ private:
     class SensorCapabilitiesSet *m_supportedSensors;
 	std::string m_bluetooth_host_address;
 	SensorManagerConfig m_config;
+	class SampleBufferArena *m_sampleBufferArena;
+	class ClockDomainManager *m_clockDomainManager;
 };
 
 #endif // SENSOR_MANAGER_H
@@ -3,9 +3,9 @@
 
 #include "BluetoothLEDeviceManager.h"
 #include "BluetoothLEServiceIDs.h"
+#include "ByteSpanReader.h"
 #include "SensorDeviceEnumerator.h"
 #include "SensorBluetoothLEDeviceEnumerator.h"
-#include "StackBuffer.h"
 #include "Logger.h"
 #include "Utility.h"
 #include "WorkerThread.h"
@@ -21,6 +21,10 @@
 #include <vector>
 #include <thread>
 
+//-- constants -----
+// Most 16-bit ADC readings a single notification (at most 512 bytes) can carry
+static const size_t k_max_eda_values_per_packet = 512 / sizeof(uint16_t);
+
 // -- AdafruitPacketProcessor
 AdafruitPacketProcessor::AdafruitPacketProcessor(const AdafruitSensorConfig& config)
 	: m_GATT_Profile(nullptr)
@@ -247,20 +251,24 @@ void AdafruitPacketProcessor::stopElectrodermalActivityStream()
 
 void AdafruitPacketProcessor::OnReceivedEDADataPacket(BluetoothGattHandle attributeHandle, uint8_t* data, size_t data_size)
 {
-	StackBuffer<64> packet_data(data, data_size);
+	// Parse the notification in place rather than copying it first
+	ByteSpanReader packet_data(data, data_size);
+
+	uint16_t raw_adc_values[k_max_eda_values_per_packet];
+	const size_t raw_adc_value_count = packet_data.readShorts(raw_adc_values, k_max_eda_values_per_packet);
 
-	ISensorListener::SensorPacket packet;
-	memset(&packet, 0, sizeof(ISensorListener::SensorPacket));
+	// Every reading in the notification goes out in a single batch
+	ISensorListener::SensorPacketBatch batch;
+	memset(&batch, 0, sizeof(ISensorListener::SensorPacketBatch));
 
-	packet.payloadType = ISensorListener::SensorPacketPayloadType::EDAFrame;
+	batch.payloadType = ISensorListener::SensorPacketPayloadType::EDAFrame;
 
 	auto packet_time = std::chrono::high_resolution_clock::now();
 	std::chrono::duration<double> time_in_stream = packet_time - m_edaStreamStartTimestamp;
-	packet.payload.edaFrame.timeInSeconds = time_in_stream.count();
 
-	while (packet_data.canRead())
+	for (size_t value_index = 0; value_index < raw_adc_value_count; ++value_index)
 	{
-		const uint16_t raw_adc_value= packet_data.readShort();
+		const uint16_t raw_adc_value= raw_adc_values[value_index];
 
 		// Formula provided by Grove-GSR_Sensor docs to convert raw ADC measurement [0,1023]
 		// to resistence measurement in ohms
@@ -275,10 +283,22 @@ void AdafruitPacketProcessor::OnReceivedEDADataPacket(BluetoothGattHandle attrib
 		// a standard Electrodermal Activity measurement (a.k.a. Galvanic Skin Response) 
 		const double conductance= 1000000.0 / resistence;
 
-		packet.payload.edaFrame.adcValue= raw_adc_value;
-		packet.payload.edaFrame.resistanceOhms= resistence;
-		packet.payload.edaFrame.conductanceMicroSiemens= conductance;
+		HSLElectrodermalActivityFrame& frame= batch.payload.edaFrames[batch.frameCount];
+		frame.timeInSeconds = time_in_stream.count();
+		frame.adcValue= raw_adc_value;
+		frame.resistanceOhms= resistence;
+		frame.conductanceMicroSiemens= conductance;
+		batch.frameCount++;
 
-		m_sensorListener->notifySensorDataReceived(&packet);
+		if (batch.frameCount >= ISensorListener::k_max_frames_per_batch)
+		{
+			m_sensorListener->notifySensorDataReceived(&batch);
+			batch.frameCount = 0;
+		}
+	}
+
+	if (batch.frameCount > 0)
+	{
+		m_sensorListener->notifySensorDataReceived(&batch);
 	}
 }
\ No newline at end of file
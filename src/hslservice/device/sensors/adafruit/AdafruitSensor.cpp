@@ -317,6 +317,12 @@ bool AdafruitSensor::getCapabilitySamplingRate(HSLSensorCapabilityType cap_type,
 	return false;
 }
 
+bool AdafruitSensor::getCapabilityFilterSettings(HSLSensorCapabilityType /*cap_type*/, SensorFilterSettings& /*out_settings*/) const
+{
+	// EDA is slow enough that clients smooth it themselves
+	return false;
+}
+
 bool AdafruitSensor::getCapabilityBitResolution(HSLSensorCapabilityType cap_type, int& out_resolution) const
 {
 	if (cap_type == HSLCapability_ElectrodermalActivity)
@@ -0,0 +1,255 @@
+#ifndef POLAR_PMD_FRAME_DECODING_H
+#define POLAR_PMD_FRAME_DECODING_H
+
+//-- includes -----
+#include "ByteSpanReader.h"
+#include "DeviceInterface.h"
+#include "PackedSampleDecoding.h"
+#include "StreamClockModel.h"
+
+#include <chrono>
+#include <cstring>
+
+//-- constants -----
+// Most values decoded from a single PMD notification.
+// A raw frame fits at most 1024 / 3 24-bit values, delta compressed frames can pack several times that.
+static const size_t k_max_pmd_frame_values = 2048;
+
+//-- definitions -----
+// Every fixed width PMD measurement stream is described by a descriptor struct with:
+//   k_measurement_type - measurement type byte at the start of a PMD data notification
+//   k_raw_frame_type   - frame type byte of an uncompressed frame
+//   k_sample_bytes     - bytes per channel value in a raw frame (also the delta frame reference value size)
+//   k_channel_count    - values per sample
+//   k_scale            - multiplier from the raw value to the frame's units (float outputs only)
+//   k_payload_type     - batch payload type the samples are sent as
+//   t_frame            - HSL frame type the samples are written into
+//   getFrames()        - the batch's frame array for that type
+//   getFrameCapacity() - samples per frame
+//   writeSamples()     - writes a run of decoded samples into a frame
+// decode_pmd_measurement<t_descriptor>() is specialized for each one at compile time,
+// so adding a new stream (i.e. gyro or magnetometer) is just a new descriptor.
+
+struct PMDECGDescriptor
+{
+	static constexpr uint8_t k_measurement_type = 0x00;
+	static constexpr uint8_t k_raw_frame_type = 0x00;
+	static constexpr int k_sample_bytes = 3;
+	static constexpr int k_channel_count = 1;
+	static constexpr float k_scale = 1.f; // raw microvolts
+	static constexpr ISensorListener::SensorPacketPayloadType k_payload_type = ISensorListener::SensorPacketPayloadType::ECGFrame;
+	typedef HSLHeartECGFrame t_frame;
+
+	static t_frame* getFrames(ISensorListener::SensorPacketBatch& batch) { return batch.payload.ecgFrames; }
+	static size_t getFrameCapacity() { return sizeof(t_frame::ecgValues) / sizeof(t_frame::ecgValues[0]); }
+
+	static void writeSamples(t_frame& frame, const int32_t* values, size_t sample_count)
+	{
+		// ECG frames carry the raw 24-bit microvolt value, sign extension happens on the client
+		for (size_t index = 0; index < sample_count; ++index)
+		{
+			frame.ecgValues[index] = (uint32_t)values[index] & 0x00FFFFFF;
+		}
+		frame.ecgValueCount = (int)sample_count;
+	}
+};
+
+struct PMDPPGDescriptor
+{
+	static constexpr uint8_t k_measurement_type = 0x01;
+	static constexpr uint8_t k_raw_frame_type = 0x00;
+	static constexpr int k_sample_bytes = 3;
+	static constexpr int k_channel_count = 4; // ppg0, ppg1, ppg2, ambient
+	static constexpr float k_scale = 1.f; // raw ADC counts
+	static constexpr ISensorListener::SensorPacketPayloadType k_payload_type = ISensorListener::SensorPacketPayloadType::PPGFrame;
+	typedef HSLHeartPPGFrame t_frame;
+
+	static t_frame* getFrames(ISensorListener::SensorPacketBatch& batch) { return batch.payload.ppgFrames; }
+	static size_t getFrameCapacity() { return sizeof(t_frame::ppgSamples) / sizeof(t_frame::ppgSamples[0]); }
+
+	static void writeSamples(t_frame& frame, const int32_t* values, size_t sample_count)
+	{
+		static_assert(sizeof(HSLHeartPPGSample) == k_channel_count * sizeof(int32_t), "PPG sample must be 4 packed int32s");
+
+		memcpy(frame.ppgSamples, values, sample_count * sizeof(HSLHeartPPGSample));
+		frame.ppgSampleCount = (int)sample_count;
+	}
+};
+
+struct PMDAccDescriptor
+{
+	static constexpr uint8_t k_measurement_type = 0x02;
+	static constexpr uint8_t k_raw_frame_type = 0x01;
+	static constexpr int k_sample_bytes = 2;
+	static constexpr int k_channel_count = 3; // x, y, z
+	static constexpr float k_scale = 0.001f; // milli-g to g
+	static constexpr ISensorListener::SensorPacketPayloadType k_payload_type = ISensorListener::SensorPacketPayloadType::ACCFrame;
+	typedef HSLAccelerometerFrame t_frame;
+
+	static t_frame* getFrames(ISensorListener::SensorPacketBatch& batch) { return batch.payload.accFrames; }
+	static size_t getFrameCapacity() { return sizeof(t_frame::accSamples) / sizeof(t_frame::accSamples[0]); }
+
+	static void writeSamples(t_frame& frame, const int32_t* values, size_t sample_count)
+	{
+		for (size_t index = 0; index < sample_count; ++index)
+		{
+			HSLVector3f& sample = frame.accSamples[index];
+			sample.x = (float)values[index*3] * k_scale;
+			sample.y = (float)values[index*3 + 1] * k_scale;
+			sample.z = (float)values[index*3 + 2] * k_scale;
+		}
+		frame.accSampleCount = (int)sample_count;
+	}
+};
+
+//-- functions -----
+// Hand a filled batch off to the listener and reset it for the next set of frames
+inline void flush_sensor_packet_batch(ISensorListener* listener, ISensorListener::SensorPacketBatch& batch)
+{
+	if (listener != nullptr && batch.frameCount > 0)
+	{
+		listener->notifySensorDataReceived(&batch);
+	}
+
+	const ISensorListener::SensorPacketPayloadType payloadType = batch.payloadType;
+	memset(&batch, 0, sizeof(ISensorListener::SensorPacketBatch));
+	batch.payloadType = payloadType;
+}
+
+// Seconds since the first timestamp seen on the stream (which becomes the stream start)
+inline double get_pmd_stream_time(uint64_t timestamp, uint64_t& stream_start_timestamp)
+{
+	if (stream_start_timestamp == 0)
+	{
+		stream_start_timestamp = timestamp;
+	}
+
+	const std::chrono::nanoseconds nanoseconds(timestamp - stream_start_timestamp);
+
+	return std::chrono::duration_cast<std::chrono::duration<double>>(nanoseconds).count();
+}
+
+// Frame types with bit 7 set hold a reference sample followed by bit-packed delta blocks
+inline bool is_pmd_delta_frame_type(uint8_t pmd_frame_type)
+{
+	return (pmd_frame_type & 0x80) != 0;
+}
+
+// Read every whole raw sample left in the packet as sign extended int32s.
+// Returns the number of values written (samples * channel_count).
+template <int t_sample_bytes, int t_channel_count>
+size_t read_pmd_raw_values(ByteSpanReader& packet_data, int32_t* out_values, size_t max_values)
+{
+	const size_t sample_size = (size_t)t_sample_bytes * t_channel_count;
+	const size_t sample_count = std::min(packet_data.getBytesRemaining() / sample_size, max_values / t_channel_count);
+	const size_t value_count = sample_count * t_channel_count;
+	const uint8_t* src = packet_data.getData() + packet_data.getReadPos();
+
+	if (t_sample_bytes == 3)
+	{
+		unpack_packed_int24_samples(src, out_values, value_count);
+	}
+	else
+	{
+		// Fixed width loop the compiler can unroll and vectorize
+		const int shift = 32 - 8 * t_sample_bytes;
+
+		for (size_t index = 0; index < value_count; ++index)
+		{
+			uint32_t raw = 0;
+			memcpy(&raw, src + index * t_sample_bytes, t_sample_bytes);
+
+			out_values[index] = (int32_t)(raw << shift) >> shift;
+		}
+	}
+
+	packet_data.skip(sample_count * sample_size);
+
+	return value_count;
+}
+
+// Decode the rest of the packet as a delta compressed frame.
+// Returns the number of values written (samples * channel_count).
+template <int t_sample_bytes, int t_channel_count>
+size_t read_pmd_delta_values(ByteSpanReader& packet_data, int32_t* out_values, size_t max_values)
+{
+	const size_t sample_count =
+		decode_pmd_delta_frame(
+			packet_data.getData() + packet_data.getReadPos(), packet_data.getBytesRemaining(),
+			t_channel_count, t_sample_bytes,
+			out_values, max_values / t_channel_count);
+
+	packet_data.skip(packet_data.getBytesRemaining());
+
+	return sample_count * t_channel_count;
+}
+
+// Decode the rest of a PMD data notification (after the measurement type byte) for the described stream,
+// writing full frames into the batch and flushing it to the listener as it fills.
+// The packet timestamp (of its last sample) is fed to the stream's clock model,
+// which supplies the start time of each frame and the measured sample period.
+template <typename t_descriptor>
+void decode_pmd_measurement(
+	ByteSpanReader& packet_data,
+	StreamClockModel& stream_clock,
+	bool bDecodeDeltaFrames,
+	ISensorListener* listener,
+	ISensorListener::SensorPacketBatch& batch)
+{
+	const uint64_t device_timestamp = packet_data.readLong();
+	const uint8_t pmd_frame_type = packet_data.readByte();
+
+	int32_t values[k_max_pmd_frame_values];
+	size_t value_count = 0;
+
+	if (pmd_frame_type == t_descriptor::k_raw_frame_type)
+	{
+		value_count =
+			read_pmd_raw_values<t_descriptor::k_sample_bytes, t_descriptor::k_channel_count>(
+				packet_data, values, k_max_pmd_frame_values);
+	}
+	else if (bDecodeDeltaFrames && is_pmd_delta_frame_type(pmd_frame_type))
+	{
+		value_count =
+			read_pmd_delta_values<t_descriptor::k_sample_bytes, t_descriptor::k_channel_count>(
+				packet_data, values, k_max_pmd_frame_values);
+	}
+
+	const size_t sample_count = value_count / t_descriptor::k_channel_count;
+	if (sample_count == 0)
+		return;
+
+	stream_clock.addPacket(device_timestamp, sample_count);
+
+	const double first_sample_time = stream_clock.getPacketFirstSampleTime();
+	const double sample_period = stream_clock.getSamplePeriod();
+
+	const size_t frame_capacity = t_descriptor::getFrameCapacity();
+	typename t_descriptor::t_frame* frames = t_descriptor::getFrames(batch);
+	size_t sample_index = 0;
+
+	batch.payloadType = t_descriptor::k_payload_type;
+
+	// Fill whole frames at a time
+	while (sample_index < sample_count)
+	{
+		if (batch.frameCount >= ISensorListener::k_max_frames_per_batch)
+		{
+			flush_sensor_packet_batch(listener, batch);
+		}
+
+		typename t_descriptor::t_frame& frame = frames[batch.frameCount];
+		const size_t frame_sample_count = std::min(frame_capacity, sample_count - sample_index);
+
+		frame.timeInSeconds = first_sample_time + (double)sample_index * sample_period;
+		frame.timeDeltaInSeconds = sample_period;
+		t_descriptor::writeSamples(frame, values + sample_index * t_descriptor::k_channel_count, frame_sample_count);
+		batch.frameCount++;
+
+		sample_index += frame_sample_count;
+	}
+
+	flush_sensor_packet_batch(listener, batch);
+}
+
+#endif // POLAR_PMD_FRAME_DECODING_H
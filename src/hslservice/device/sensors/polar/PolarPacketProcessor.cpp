@@ -3,6 +3,8 @@
 
 #include "BluetoothLEDeviceManager.h"
 #include "BluetoothLEServiceIDs.h"
+#include "ByteSpanReader.h"
+#include "PolarPMDFrameDecoding.h"
 #include "PolarSensor.h"
 #include "SensorDeviceEnumerator.h"
 #include "SensorBluetoothLEDeviceEnumerator.h"
@@ -49,9 +51,6 @@ PolarPacketProcessor::PolarPacketProcessor(const PolarSensorConfig& config)
 	, m_streamListenerBitmask(0)
 	, m_bIsRunning(false)
 	, m_streamActiveBitmask(0)
-	, m_accStreamStartTimestamp(0)
-	, m_ecgStreamStartTimestamp(0)
-	, m_ppgStreamStartTimestamp(0)
 	, m_ppiStreamStartTimestamp(0)
 	, m_bIsPMDControlPointIndicationEnabled(false)
 	, m_bIsPMDDataMTUNotificationEnabled(false)
@@ -411,8 +410,8 @@ bool PolarPacketProcessor::startAccStream(const PolarSensorConfig& config)
 	if (memcmp(response_buffer, expected_response_prefix, 4) != 0)
 		return false;
 
-	// Reset the stream start timestamp
-	m_accStreamStartTimestamp = 0;
+	// Restart the stream clock model at the configured rate
+	m_accStreamClock.reset((double)config.accSampleRate);
 
 	return true;
 }
@@ -482,8 +481,8 @@ bool PolarPacketProcessor::startECGStream(const PolarSensorConfig& config)
 	if (memcmp(response_buffer, expected_response_prefix, 4) != 0)
 		return false;
 
-	// Reset the stream start timestamp
-	m_ecgStreamStartTimestamp = 0;
+	// Restart the stream clock model at the configured rate
+	m_ecgStreamClock.reset((double)config.ecgSampleRate);
 
 	return true;
 }
@@ -553,8 +552,8 @@ bool PolarPacketProcessor::startPPGStream(const PolarSensorConfig& config)
 	if (memcmp(response_buffer, expected_response_prefix, 4) != 0)
 		return false;
 
-	// Reset the stream start timestamp
-	m_ppgStreamStartTimestamp = 0;
+	// Restart the stream clock model at the configured rate
+	m_ppgStreamClock.reset((double)config.ppgSampleRate);
 
 	return true;
 }
@@ -725,146 +724,27 @@ void PolarPacketProcessor::OnReceivedPMDDataMTUPacket(BluetoothGattHandle attrib
 	// Send the sensor data for processing by filter
 	if (m_sensorListener != nullptr)
 	{
-		StackBuffer<1024> packet_data(data, data_size);
+		// Parse the notification in place rather than copying it first
+		ByteSpanReader packet_data(data, data_size);
 
-		ISensorListener::SensorPacket packet;
-		memset(&packet, 0, sizeof(ISensorListener::SensorPacket));
+		// All frames decoded from this notification go out in a single batch
+		ISensorListener::SensorPacketBatch batch;
+		memset(&batch, 0, sizeof(ISensorListener::SensorPacketBatch));
 
 		uint8_t frame_type = packet_data.readByte();
 		switch (frame_type)
 		{
-			case 0x00: // ECG
-				{
-					uint64_t timestamp = packet_data.readLong();
-					if (m_ecgStreamStartTimestamp == 0)
-					{
-						m_ecgStreamStartTimestamp = timestamp;
-					}
-
-					const std::chrono::nanoseconds nanoseconds(timestamp - m_ecgStreamStartTimestamp);
-					const auto seconds = std::chrono::duration_cast<std::chrono::duration<double>>(nanoseconds);
-
-					if (packet_data.readByte() == 0x00) // ECG frame type
-					{
-						int ecg_value_capacity = ARRAY_SIZE(packet.payload.ecgFrame.ecgValues);
-
-						packet.payloadType = ISensorListener::SensorPacketPayloadType::ECGFrame;
-						packet.payload.ecgFrame.timeInSeconds = seconds.count();
-						packet.payload.ecgFrame.timeDeltaInSeconds= 1.0 / (double)m_config.ecgSampleRate;
-
-						while (packet_data.canRead())
-						{
-							uint8_t raw_microvolt_value[4] = {0x00, 0x00, 0x00, 0x00};
-							packet_data.readBytes(raw_microvolt_value, 3);
-							uint32_t* microvolt_value = (uint32_t*)raw_microvolt_value;
-
-							packet.payload.ecgFrame.ecgValues[packet.payload.ecgFrame.ecgValueCount] = (*microvolt_value);
-							packet.payload.ecgFrame.ecgValueCount++;
-
-							if (packet.payload.ecgFrame.ecgValueCount >= ecg_value_capacity)
-							{
-								m_sensorListener->notifySensorDataReceived(&packet);
-								packet.payload.ecgFrame.ecgValueCount = 0;
-							}
-						}
-
-						if (packet.payload.ecgFrame.ecgValueCount > 0)
-						{
-							m_sensorListener->notifySensorDataReceived(&packet);
-						}
-					}
-				}
+			case PMDECGDescriptor::k_measurement_type:
+				decode_pmd_measurement<PMDECGDescriptor>(
+					packet_data, m_ecgStreamClock, m_config.useDeltaCompressedFrames, m_sensorListener, batch);
 				break;
-			case 0x01: // PPG
-				{
-					uint64_t timestamp = packet_data.readLong();
-					if (m_ppgStreamStartTimestamp == 0)
-					{
-						m_ppgStreamStartTimestamp = timestamp;
-					}
-
-					const std::chrono::nanoseconds nanoseconds(timestamp - m_ppgStreamStartTimestamp);
-					const auto seconds = std::chrono::duration_cast<std::chrono::duration<double>>(nanoseconds);
-
-					if (packet_data.readByte() == 0x00) // 24-bit PPG frame type
-					{
-						int ppg_value_capacity = ARRAY_SIZE(packet.payload.ppgFrame.ppgSamples);
-
-						packet.payloadType = ISensorListener::SensorPacketPayloadType::PPGFrame;
-						packet.payload.ppgFrame.timeInSeconds = seconds.count();
-						packet.payload.ppgFrame.timeDeltaInSeconds = 1.0 / (double)m_config.ppgSampleRate;
-
-						while (packet_data.canRead())
-						{
-							HSLHeartPPGSample ppgSample;
-							memset(&ppgSample, 0, sizeof(HSLHeartPPGSample));
-
-							ppgSample.ppgValue0 = packet_data.read24BitInt();
-							ppgSample.ppgValue1 = packet_data.read24BitInt();
-							ppgSample.ppgValue2 = packet_data.read24BitInt();
-							ppgSample.ambient = packet_data.read24BitInt();
-
-							packet.payload.ppgFrame.ppgSamples[packet.payload.ppgFrame.ppgSampleCount] = ppgSample;
-							packet.payload.ppgFrame.ppgSampleCount++;
-
-							if (packet.payload.ppgFrame.ppgSampleCount >= ppg_value_capacity)
-							{
-								m_sensorListener->notifySensorDataReceived(&packet);
-								packet.payload.ppgFrame.ppgSampleCount = 0;
-							}
-						}
-
-						if (packet.payload.ppgFrame.ppgSampleCount > 0)
-						{
-							m_sensorListener->notifySensorDataReceived(&packet);
-						}
-					}
-				}
+			case PMDPPGDescriptor::k_measurement_type:
+				decode_pmd_measurement<PMDPPGDescriptor>(
+					packet_data, m_ppgStreamClock, m_config.useDeltaCompressedFrames, m_sensorListener, batch);
 				break;
-			case 0x02: // Acc
-				{
-					uint64_t timestamp = packet_data.readLong();
-					if (m_accStreamStartTimestamp == 0)
-					{
-						m_accStreamStartTimestamp = timestamp;
-					}
-
-					const std::chrono::nanoseconds nanoseconds(timestamp - m_accStreamStartTimestamp);
-					const auto seconds = std::chrono::duration_cast<std::chrono::duration<double>>(nanoseconds);
-
-					if (packet_data.readByte() == 0x01) // 16-bit ACC frame type
-					{
-						int acc_value_capacity = ARRAY_SIZE(packet.payload.accFrame.accSamples);
-
-						packet.payloadType = ISensorListener::SensorPacketPayloadType::ACCFrame;
-						packet.payload.accFrame.timeInSeconds = seconds.count();
-						packet.payload.accFrame.timeDeltaInSeconds = 1.0 / (double)m_config.accSampleRate;
-
-						while (packet_data.canRead())
-						{
-							uint16_t x_milli_g = packet_data.readShort();
-							uint16_t y_milli_g = packet_data.readShort();
-							uint16_t z_milli_g = packet_data.readShort();
-
-							HSLVector3f& sample = packet.payload.accFrame.accSamples[packet.payload.accFrame.accSampleCount];
-							sample.x = (float)x_milli_g / 1000.f;
-							sample.y = (float)y_milli_g / 1000.f;
-							sample.z = (float)z_milli_g / 1000.f;
-							packet.payload.accFrame.accSampleCount++;
-
-							if (packet.payload.accFrame.accSampleCount >= acc_value_capacity)
-							{
-								m_sensorListener->notifySensorDataReceived(&packet);
-								packet.payload.accFrame.accSampleCount = 0;
-							}
-						}
-
-						if (packet.payload.accFrame.accSampleCount >= 0)
-						{
-							m_sensorListener->notifySensorDataReceived(&packet);
-						}
-					}
-				}
+			case PMDAccDescriptor::k_measurement_type:
+				decode_pmd_measurement<PMDAccDescriptor>(
+					packet_data, m_accStreamClock, m_config.useDeltaCompressedFrames, m_sensorListener, batch);
 				break;
 			case 0x03: // PPI
 				{
@@ -876,26 +756,25 @@ void PolarPacketProcessor::OnReceivedPMDDataMTUPacket(BluetoothGattHandle attrib
 						timestamp= std::chrono::high_resolution_clock::now().time_since_epoch().count();   
 					}
 
-					if (m_ppiStreamStartTimestamp == 0)
-					{
-						m_ppiStreamStartTimestamp = timestamp;
-					}
-
-					const std::chrono::nanoseconds nanoseconds(timestamp - m_ppiStreamStartTimestamp);
-					const auto seconds = std::chrono::duration_cast<std::chrono::duration<double>>(nanoseconds);
+					const double time_in_seconds = get_pmd_stream_time(timestamp, m_ppiStreamStartTimestamp);
 
 					if (packet_data.readByte() == 0x00) // PPI frame type
 					{
-						int ppi_value_capacity = ARRAY_SIZE(packet.payload.ppiFrame.ppiSamples);
+						int ppi_value_capacity = ARRAY_SIZE(batch.payload.ppiFrames[0].ppiSamples);
+						HSLHeartPPIFrame* frame = nullptr;
 
-						packet.payloadType = ISensorListener::SensorPacketPayloadType::PPIFrame;
-						packet.payload.ppiFrame.timeInSeconds = seconds.count();
+						batch.payloadType = ISensorListener::SensorPacketPayloadType::PPIFrame;
 
-						while (packet_data.canRead())
+						while (packet_data.canRead(6)) // bpm, duration, error estimate, flags
 						{
-							HSLHeartPPISample ppiSample;
-							memset(&ppiSample, 0, sizeof(HSLHeartPPISample));
+							if (frame == nullptr)
+							{
+								frame = &batch.payload.ppiFrames[batch.frameCount];
+								frame->timeInSeconds = time_in_seconds;
+								batch.frameCount++;
+							}
 
+							HSLHeartPPISample& ppiSample = frame->ppiSamples[frame->ppiSampleCount];
 							ppiSample.beatsPerMinute = packet_data.readByte();
 							ppiSample.pulseDuration = packet_data.readShort();
 							ppiSample.pulseDurationErrorEst = packet_data.readShort();
@@ -904,21 +783,20 @@ void PolarPacketProcessor::OnReceivedPMDDataMTUPacket(BluetoothGattHandle attrib
 							ppiSample.blockerBit = HSL_BITMASK_GET_FLAG(flags_field, 0);
 							ppiSample.skinContactBit = HSL_BITMASK_GET_FLAG(flags_field, 1);
 							ppiSample.supportsSkinContactBit = HSL_BITMASK_GET_FLAG(flags_field, 2);
+							frame->ppiSampleCount++;
 
-							packet.payload.ppiFrame.ppiSamples[packet.payload.ppiFrame.ppiSampleCount] = ppiSample;
-							packet.payload.ppiFrame.ppiSampleCount++;
-
-							if (packet.payload.ppiFrame.ppiSampleCount >= ppi_value_capacity)
+							if (frame->ppiSampleCount >= ppi_value_capacity)
 							{
-								m_sensorListener->notifySensorDataReceived(&packet);
-								packet.payload.ppiFrame.ppiSampleCount = 0;
+								frame = nullptr;
+
+								if (batch.frameCount >= ISensorListener::k_max_frames_per_batch)
+								{
+									flush_sensor_packet_batch(m_sensorListener, batch);
+								}
 							}
 						}
 
-						if (packet.payload.ppiFrame.ppiSampleCount > 0)
-						{
-							m_sensorListener->notifySensorDataReceived(&packet);
-						}
+						flush_sensor_packet_batch(m_sensorListener, batch);
 					}
 				}
 				break;
@@ -930,16 +808,19 @@ void PolarPacketProcessor::OnReceivedPMDDataMTUPacket(BluetoothGattHandle attrib
 
 void PolarPacketProcessor::OnReceivedHRDataPacket(BluetoothGattHandle attributeHandle, uint8_t* data, size_t data_size)
 {
-	StackBuffer<64> packet_data(data, data_size);
+	ByteSpanReader packet_data(data, data_size);
+
+	ISensorListener::SensorPacketBatch batch;
+	memset(&batch, 0, sizeof(ISensorListener::SensorPacketBatch));
 
-	ISensorListener::SensorPacket packet;
-	memset(&packet, 0, sizeof(ISensorListener::SensorPacket));
+	batch.payloadType = ISensorListener::SensorPacketPayloadType::HRFrame;
 
-	packet.payloadType = ISensorListener::SensorPacketPayloadType::HRFrame;
+	HSLHeartRateFrame* frame = &batch.payload.hrFrames[0];
+	batch.frameCount = 1;
 
 	auto packet_time = std::chrono::high_resolution_clock::now();
 	std::chrono::duration<double> time_in_stream = packet_time - m_hrStreamStartTimestamp;
-	packet.payload.hrFrame.timeInSeconds = time_in_stream.count();
+	frame->timeInSeconds = time_in_stream.count();
 
 	// See Heart Rate Service spec: https://www.bluetooth.org/docman/handlers/downloaddoc.ashx?doc_id=239866
 	uint8_t flags_field = packet_data.readByte();
@@ -951,49 +832,54 @@ void PolarPacketProcessor::OnReceivedHRDataPacket(BluetoothGattHandle attributeH
 
 	if (heart_rate_format_flag)
 	{
-		packet.payload.hrFrame.beatsPerMinute = packet_data.readShort();
+		frame->beatsPerMinute = packet_data.readShort();
 	}
 	else
 	{
-		packet.payload.hrFrame.beatsPerMinute = (uint16_t)packet_data.readByte();
+		frame->beatsPerMinute = (uint16_t)packet_data.readByte();
 	}
 
 	if (contact_status_supported_flag)
 	{
-		packet.payload.hrFrame.contactStatus =
+		frame->contactStatus =
 			contact_status_flag ? HSLContactStatus_Contact : HSLContactStatus_NoContact;
 	}
 	else
 	{
-		packet.payload.hrFrame.contactStatus = HSLContactStatus_Invalid;
+		frame->contactStatus = HSLContactStatus_Invalid;
 	}
 
 	if (energy_expended_supported_flag)
 	{
-		packet.payload.hrFrame.energyExpended = packet_data.readShort();
+		frame->energyExpended = packet_data.readShort();
 	}
 
 	if (RR_interval_supported_flag)
 	{
-		int rr_value_capacity = ARRAY_SIZE(packet.payload.hrFrame.RRIntervals);
+		int rr_value_capacity = ARRAY_SIZE(frame->RRIntervals);
 
-		while (packet_data.canRead())
+		while (packet_data.canRead(sizeof(uint16_t)))
 		{
-			packet.payload.hrFrame.RRIntervals[packet.payload.hrFrame.RRIntervalCount] = packet_data.readShort();
-			packet.payload.hrFrame.RRIntervalCount++;
-
-			if (packet.payload.hrFrame.RRIntervalCount >= rr_value_capacity)
+			// Spill any RR intervals that don't fit into another copy of the frame
+			if (frame->RRIntervalCount >= rr_value_capacity)
 			{
-				m_sensorListener->notifySensorDataReceived(&packet);
-				packet.payload.hrFrame.RRIntervalCount = 0;
+				const HSLHeartRateFrame full_frame = *frame;
+
+				if (batch.frameCount >= ISensorListener::k_max_frames_per_batch)
+				{
+					flush_sensor_packet_batch(m_sensorListener, batch);
+				}
+
+				frame = &batch.payload.hrFrames[batch.frameCount];
+				*frame = full_frame;
+				frame->RRIntervalCount = 0;
+				batch.frameCount++;
 			}
-		}
 
-		if (packet.payload.hrFrame.RRIntervalCount >= 0)
-		{
-			m_sensorListener->notifySensorDataReceived(&packet);
+			frame->RRIntervals[frame->RRIntervalCount] = packet_data.readShort();
+			frame->RRIntervalCount++;
 		}
 	}
 
-	m_sensorListener->notifySensorDataReceived(&packet);
+	flush_sensor_packet_batch(m_sensorListener, batch);
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 //-- includes -----
 #include "BluetoothLEApiInterface.h"
 #include "PolarSensorConfig.h"
+#include "StreamClockModel.h"
 
 #include <chrono>
 
@@ -64,9 +65,9 @@ protected:
 	t_hsl_caps_bitmask m_streamListenerBitmask;
 	bool m_bIsRunning;
 	t_hsl_caps_bitmask m_streamActiveBitmask;
-	uint64_t m_accStreamStartTimestamp;
-	uint64_t m_ecgStreamStartTimestamp;
-	uint64_t m_ppgStreamStartTimestamp;
+	StreamClockModel m_accStreamClock;
+	StreamClockModel m_ecgStreamClock;
+	StreamClockModel m_ppgStreamClock;
 	uint64_t m_ppiStreamStartTimestamp;
 	std::chrono::time_point<std::chrono::high_resolution_clock> m_hrStreamStartTimestamp;
 	bool m_bIsPMDControlPointIndicationEnabled;
@@ -390,6 +390,23 @@ bool PolarSensor::getCapabilitySamplingRate(HSLSensorCapabilityType cap_type, in
 	return false;
 }
 
+bool PolarSensor::getCapabilityFilterSettings(HSLSensorCapabilityType cap_type, SensorFilterSettings& out_settings) const
+{
+	switch (cap_type)
+	{
+	case HSLCapability_Electrocardiography:
+		out_settings = m_config.ecgFilter;
+		return true;
+	case HSLCapability_Photoplethysmography:
+		out_settings = m_config.ppgFilter;
+		return true;
+	default:
+		break;
+	}
+
+	return false;
+}
+
 bool PolarSensor::getCapabilityBitResolution(HSLSensorCapabilityType cap_type, int& out_resolution) const
 {
 	switch (cap_type)
@@ -56,6 +56,7 @@ public:
 	virtual void setSampleHistoryDuration(float duration) override;
 	virtual int getHeartRateVariabliyHistorySize() const override;
 	virtual void setHeartRateVariabliyHistorySize(int sample_count) override;
+	virtual bool getCapabilityFilterSettings(HSLSensorCapabilityType cap_type, SensorFilterSettings& out_settings) const override;
 
     // -- Getters
     inline const PolarSensorConfig *getConfig() const
@@ -17,10 +17,25 @@ PolarSensorConfig::PolarSensorConfig(const std::string& fnamebase)
 	, version(CONFIG_VERSION)
 	, sampleHistoryDuration(1.f)
 	, hrvHistorySize(100)
+	, useDeltaCompressedFrames(false)
 {
 	accSampleRate = k_available_acc_sample_rates[0];
 	ecgSampleRate = k_available_ecg_sample_rates[0];
 	ppgSampleRate = k_available_ppg_sample_rates[0];
+
+	// ECG diagnostic-ish band with the 50Hz mains notch
+	ecgFilter.enabled = true;
+	ecgFilter.highPassHz = 0.5f;
+	ecgFilter.notchHz = 50.f;
+	ecgFilter.notchQ = 30.f;
+	ecgFilter.lowPassHz = 40.f;
+
+	// PPG pulse band, the optical path doesn't pick up mains
+	ppgFilter.enabled = true;
+	ppgFilter.highPassHz = 0.5f;
+	ppgFilter.notchHz = 0.f;
+	ppgFilter.notchQ = 30.f;
+	ppgFilter.lowPassHz = 5.f;
 };
 
 int PolarSensorConfig::sanitizeSampleRate(int test_sample_rate, const int* sample_rate_array)
@@ -100,6 +115,17 @@ const configuru::Config PolarSensorConfig::writeToJSON()
 		{"ecg_sample_rate", ecgSampleRate},
 		{"ppg_sample_rate", ppgSampleRate},
 		{"acc_sample_rate", accSampleRate},
+		{"use_delta_compressed_frames", useDeltaCompressedFrames},
+		{"ecg_filter_enabled", ecgFilter.enabled},
+		{"ecg_filter_high_pass_hz", ecgFilter.highPassHz},
+		{"ecg_filter_notch_hz", ecgFilter.notchHz},
+		{"ecg_filter_notch_q", ecgFilter.notchQ},
+		{"ecg_filter_low_pass_hz", ecgFilter.lowPassHz},
+		{"ppg_filter_enabled", ppgFilter.enabled},
+		{"ppg_filter_high_pass_hz", ppgFilter.highPassHz},
+		{"ppg_filter_notch_hz", ppgFilter.notchHz},
+		{"ppg_filter_notch_q", ppgFilter.notchQ},
+		{"ppg_filter_low_pass_hz", ppgFilter.lowPassHz},
 	};
 
 	return pt;
@@ -130,6 +156,18 @@ PolarSensorConfig::readFromJSON(const configuru::Config& pt)
 			sanitizeSampleRate(
 				pt.get_or<int>("acc_sample_rate", accSampleRate),
 				k_available_acc_sample_rates);
+		useDeltaCompressedFrames = pt.get_or<bool>("use_delta_compressed_frames", useDeltaCompressedFrames);
+
+		ecgFilter.enabled = pt.get_or<bool>("ecg_filter_enabled", ecgFilter.enabled);
+		ecgFilter.highPassHz = pt.get_or<float>("ecg_filter_high_pass_hz", ecgFilter.highPassHz);
+		ecgFilter.notchHz = pt.get_or<float>("ecg_filter_notch_hz", ecgFilter.notchHz);
+		ecgFilter.notchQ = pt.get_or<float>("ecg_filter_notch_q", ecgFilter.notchQ);
+		ecgFilter.lowPassHz = pt.get_or<float>("ecg_filter_low_pass_hz", ecgFilter.lowPassHz);
+		ppgFilter.enabled = pt.get_or<bool>("ppg_filter_enabled", ppgFilter.enabled);
+		ppgFilter.highPassHz = pt.get_or<float>("ppg_filter_high_pass_hz", ppgFilter.highPassHz);
+		ppgFilter.notchHz = pt.get_or<float>("ppg_filter_notch_hz", ppgFilter.notchHz);
+		ppgFilter.notchQ = pt.get_or<float>("ppg_filter_notch_q", ppgFilter.notchQ);
+		ppgFilter.lowPassHz = pt.get_or<float>("ppg_filter_low_pass_hz", ppgFilter.lowPassHz);
 	}
 	else
 	{
@@ -2,6 +2,7 @@
 #define POLAR_SENSOR_CONFIG_H
 
 #include "HSLConfig.h"
+#include "DeviceInterface.h"
 #include <string>
 
 class PolarSensorConfig : public HSLConfig
@@ -28,6 +29,15 @@ public:
 	int accSampleRate;
 	int ecgSampleRate;
 	int ppgSampleRate;
+
+	// Decode PMD delta compressed frames (frame type bit 7) instead of dropping them.
+	// Compressed frames carry several times more samples per notification,
+	// which leaves room for 200Hz ACC alongside ECG on a single link.
+	bool useDeltaCompressedFrames;
+
+	// Filter banks the ECG and PPG streams are run through before being published as the filtered buffers
+	SensorFilterSettings ecgFilter;
+	SensorFilterSettings ppgFilter;
 };
 
 #endif // POLAR_SENSOR_CONFIG_H
\ No newline at end of file
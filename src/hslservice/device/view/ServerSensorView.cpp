@@ -2,13 +2,18 @@
 #include "ServerSensorView.h"
 
 #include "AtomicPrimitives.h"
+#include "ClockDomainManager.h"
 #include "SensorManager.h"
 #include "DeviceManager.h"
 #include "Logger.h"
 #include "ServiceRequestHandler.h"
 #include "MathUtility.h"
+#include "SampleBufferArena.h"
+#include "SampleUnpacking.h"
 #include "Utility.h"
 
+#include <cstring>
+
 //-- typedefs ----
 using t_high_resolution_timepoint= std::chrono::time_point<std::chrono::high_resolution_clock>;
 using t_high_resolution_duration= t_high_resolution_timepoint::duration;
@@ -17,25 +22,196 @@ using t_high_resolution_duration= t_high_resolution_timepoint::duration;
 static const float k_min_time_delta_seconds = 1 / 2500.f;
 static const float k_max_time_delta_seconds = 1 / 30.f;
 
+// Record slots for sensor packets handed from the BLE threads to the main thread, per payload type.
+// HR and EDA notifications are usually a single frame but can fill a whole batch (i.e. a long RR interval list
+// or a backlog of EDA readings), the PMD streams send up to a full batch per notification.
+static const size_t k_full_hr_batch_record_size =
+	sizeof(PacketRecordHeader) + ISensorListener::k_max_frames_per_batch * sizeof(HSLHeartRateFrame);
+static const size_t k_full_eda_batch_record_size =
+	sizeof(PacketRecordHeader) + ISensorListener::k_max_frames_per_batch * sizeof(HSLElectrodermalActivityFrame);
+
+static const PacketArena::SizeClass k_hr_packet_size_classes[] = {{64, 128}, {k_full_hr_batch_record_size, 16}};
+static const PacketArena::SizeClass k_ecg_packet_size_classes[] = {{256, 32}, {1024, 32}};
+static const PacketArena::SizeClass k_ppg_packet_size_classes[] = {{512, 32}, {2048, 16}};
+static const PacketArena::SizeClass k_ppi_packet_size_classes[] = {{256, 32}, {1024, 16}};
+static const PacketArena::SizeClass k_acc_packet_size_classes[] = {{256, 32}, {1024, 32}};
+static const PacketArena::SizeClass k_eda_packet_size_classes[] = {{64, 128}, {k_full_eda_batch_record_size, 16}};
+
+// Layout of the waveform frames as seen by the sample histories
+static const size_t k_ecg_samples_per_frame = sizeof(HSLHeartECGFrame::ecgValues) / sizeof(HSLHeartECGFrame::ecgValues[0]);
+static const size_t k_ppg_samples_per_frame = sizeof(HSLHeartPPGFrame::ppgSamples) / sizeof(HSLHeartPPGFrame::ppgSamples[0]);
+static const size_t k_ppg_channel_count = sizeof(HSLHeartPPGSample) / sizeof(int32_t);
+
+// Pulse interval frames synthesized from raw PPG hold one beat each, this covers up to 240 BPM
+static const int k_synthesized_ppi_frame_rate = 4;
+
+// Budget for the compressed history. 16 bits per sample per channel leaves headroom
+// over what waveforms usually pack down to, so the history normally covers more than asked for.
+static const double k_compressed_history_bytes_per_sample = 2.0;
+
+//-- private methods -----
+static size_t get_payload_frame_size(ISensorListener::SensorPacketPayloadType payload_type)
+{
+	switch (payload_type)
+	{
+	case ISensorListener::SensorPacketPayloadType::HRFrame:
+		return sizeof(HSLHeartRateFrame);
+	case ISensorListener::SensorPacketPayloadType::ECGFrame:
+		return sizeof(HSLHeartECGFrame);
+	case ISensorListener::SensorPacketPayloadType::PPGFrame:
+		return sizeof(HSLHeartPPGFrame);
+	case ISensorListener::SensorPacketPayloadType::PPIFrame:
+		return sizeof(HSLHeartPPIFrame);
+	case ISensorListener::SensorPacketPayloadType::ACCFrame:
+		return sizeof(HSLAccelerometerFrame);
+	case ISensorListener::SensorPacketPayloadType::EDAFrame:
+		return sizeof(HSLElectrodermalActivityFrame);
+	}
+
+	return 0;
+}
+
+// Find which capability stream a batch of frames belongs to and the stream time of its newest sample
+static bool get_newest_sample_time(
+	ISensorListener::SensorPacketPayloadType payload_type, const void* payload, int frame_count,
+	HSLSensorCapabilityType& out_cap_type, double& out_time)
+{
+	if (frame_count <= 0)
+		return false;
+
+	switch (payload_type)
+	{
+	case ISensorListener::SensorPacketPayloadType::HRFrame:
+		{
+			const HSLHeartRateFrame& frame= ((const HSLHeartRateFrame*)payload)[frame_count - 1];
+			out_cap_type= HSLCapability_HeartRate;
+			out_time= frame.timeInSeconds;
+		} return true;
+	case ISensorListener::SensorPacketPayloadType::ECGFrame:
+		{
+			const HSLHeartECGFrame& frame= ((const HSLHeartECGFrame*)payload)[frame_count - 1];
+			out_cap_type= HSLCapability_Electrocardiography;
+			out_time= frame.timeInSeconds + (double)std::max(frame.ecgValueCount - 1, 0) * frame.timeDeltaInSeconds;
+		} return true;
+	case ISensorListener::SensorPacketPayloadType::PPGFrame:
+		{
+			const HSLHeartPPGFrame& frame= ((const HSLHeartPPGFrame*)payload)[frame_count - 1];
+			out_cap_type= HSLCapability_Photoplethysmography;
+			out_time= frame.timeInSeconds + (double)std::max(frame.ppgSampleCount - 1, 0) * frame.timeDeltaInSeconds;
+		} return true;
+	case ISensorListener::SensorPacketPayloadType::PPIFrame:
+		{
+			const HSLHeartPPIFrame& frame= ((const HSLHeartPPIFrame*)payload)[frame_count - 1];
+			out_cap_type= HSLCapability_PulseInterval;
+			out_time= frame.timeInSeconds;
+		} return true;
+	case ISensorListener::SensorPacketPayloadType::ACCFrame:
+		{
+			const HSLAccelerometerFrame& frame= ((const HSLAccelerometerFrame*)payload)[frame_count - 1];
+			out_cap_type= HSLCapability_Accelerometer;
+			out_time= frame.timeInSeconds + (double)std::max(frame.accSampleCount - 1, 0) * frame.timeDeltaInSeconds;
+		} return true;
+	case ISensorListener::SensorPacketPayloadType::EDAFrame:
+		{
+			const HSLElectrodermalActivityFrame& frame= ((const HSLElectrodermalActivityFrame*)payload)[frame_count - 1];
+			out_cap_type= HSLCapability_ElectrodermalActivity;
+			out_time= frame.timeInSeconds;
+		} return true;
+	}
+
+	return false;
+}
+
+template <typename t_item>
+static void assign_sample_buffer_storage(
+	SampleBufferArena* arena, int partition_index, SequencedRingBuffer<t_item>* ring, size_t capacity)
+{
+	if (arena != nullptr)
+	{
+		if (!arena->assignRingStorage(partition_index, *ring, capacity))
+		{
+			HSL_LOG_WARNING("ServerSensorView::adjustSampleBufferCapacities") << "Sample buffer arena partition " << partition_index
+				<< " is full, falling back to heap storage. Consider raising sample_buffer_arena_kilobytes_per_sensor.";
+		}
+	}
+	else
+	{
+		ring->setCapacity(capacity);
+	}
+}
+
 //-- public implementation -----
 ServerSensorView::ServerSensorView(const int device_id)
 	: ServerDeviceView(device_id)
 	, m_device(nullptr)
-	, m_sensorPacketQueue(1000)
+	, heartRateBuffer(new SequencedRingBuffer<HSLHeartRateFrame>(10))
+	, heartECGBuffer(new SequencedRingBuffer<HSLHeartECGFrame>(10))
+	, heartPPGBuffer(new SequencedRingBuffer<HSLHeartPPGFrame>(10))
+	, heartFilteredECGBuffer(new SequencedRingBuffer<HSLFilteredECGFrame>(10))
+	, heartFilteredPPGBuffer(new SequencedRingBuffer<HSLFilteredPPGFrame>(10))
+	, heartPPIBuffer(new SequencedRingBuffer<HSLHeartPPIFrame>(10))
+	, heartAccBuffer(new SequencedRingBuffer<HSLAccelerometerFrame>(10))
+	, skinEDABuffer(new SequencedRingBuffer<HSLElectrodermalActivityFrame>(10))
+	, heartECGHistory(new SampleHistoryFile<HSLHeartECGFrame>())
+	, heartPPGHistory(new SampleHistoryFile<HSLHeartPPGFrame>())
+	, heartECGCompressedHistory(new CompressedSampleHistory(1, k_ecg_samples_per_frame))
+	, heartPPGCompressedHistory(new CompressedSampleHistory(k_ppg_channel_count, k_ppg_samples_per_frame))
+	, heartECGPyramid(new SamplePyramid(1))
+	, heartPPGPyramid(new SamplePyramid(k_ppg_channel_count))
+	, heartAccPyramid(new SamplePyramid(3))
+	, heartHRVFilter(new HeartRateVariabilityFilter())
+	, heartNNSegments(new NNSegmentAggregator())
+	, heartHRVSpectrum(new HRVSpectrumFilter())
+	, heartPPGBeatDetector(new PPGBeatDetector())
+	, heartQRSDetector(new QRSDetector())
+	, heartECGFilterBank(new BiquadFilterBank())
+	, heartPPGFilterBank(new BiquadFilterBank())
+	, m_bFilterECG(false)
+	, m_bFilterPPG(false)
+	, m_newestHRVIntervalTime(0.0)
+	, m_bHasNewHRVIntervals(false)
+	, m_bHasNewNNSegment(false)
+	, m_bHasNewHRVSpectrum(false)
 	, m_activeFilterBitmask(0)
-	, m_bIsLastSensorDataTimestampValid(false)
-	, heartRateBuffer(new CircularBuffer<HSLHeartRateFrame>(10))
-	, heartECGBuffer(new CircularBuffer<HSLHeartECGFrame>(10))
-	, heartPPGBuffer(new CircularBuffer<HSLHeartPPGFrame>(10))
-	, heartPPIBuffer(new CircularBuffer<HSLHeartPPIFrame>(10))
-	, heartAccBuffer(new CircularBuffer<HSLAccelerometerFrame>(10))
-	, skinEDABuffer(new CircularBuffer<HSLElectrodermalActivityFrame>(10))
+	, m_sampleBufferLayoutGeneration(0)
 	, m_lastValidHRTimestamp(std::chrono::high_resolution_clock::now())
 	, m_lastValidHR(0)
 {
 	for (int filter_index = 0; filter_index < HRVFilter_COUNT; ++filter_index)
 	{
-		hrvFilters[filter_index].hrvBuffer = new CircularBuffer<HSLHeartVariabilityFrame>(10);
+		hrvFilters[filter_index].hrvBuffer = new SequencedRingBuffer<HSLHeartVariabilityFrame>(10);
+	}
+
+	for (int payload_index = 0; payload_index < k_sensor_packet_payload_type_count; ++payload_index)
+	{
+		SensorPacketChannel& channel= m_sensorPacketChannels[payload_index];
+
+		switch ((ISensorListener::SensorPacketPayloadType)payload_index)
+		{
+		case ISensorListener::SensorPacketPayloadType::HRFrame:
+			channel.packetArena= new PacketArena(k_hr_packet_size_classes, ARRAY_SIZE(k_hr_packet_size_classes));
+			break;
+		case ISensorListener::SensorPacketPayloadType::ECGFrame:
+			channel.packetArena= new PacketArena(k_ecg_packet_size_classes, ARRAY_SIZE(k_ecg_packet_size_classes));
+			break;
+		case ISensorListener::SensorPacketPayloadType::PPGFrame:
+			channel.packetArena= new PacketArena(k_ppg_packet_size_classes, ARRAY_SIZE(k_ppg_packet_size_classes));
+			break;
+		case ISensorListener::SensorPacketPayloadType::PPIFrame:
+			channel.packetArena= new PacketArena(k_ppi_packet_size_classes, ARRAY_SIZE(k_ppi_packet_size_classes));
+			break;
+		case ISensorListener::SensorPacketPayloadType::ACCFrame:
+			channel.packetArena= new PacketArena(k_acc_packet_size_classes, ARRAY_SIZE(k_acc_packet_size_classes));
+			break;
+		case ISensorListener::SensorPacketPayloadType::EDAFrame:
+			channel.packetArena= new PacketArena(k_eda_packet_size_classes, ARRAY_SIZE(k_eda_packet_size_classes));
+			break;
+		}
+
+		// Every record can be in flight at once, so the handle queue can never be the thing that fills up
+		channel.packetQueue= new PacketHandleQueue(channel.packetArena->getTotalRecordCount());
+		channel.overflowPolicy= (int)SensorPacketOverflowPolicy::DropNewest;
+		channel.droppedPacketCount= 0;
 	}
 }
 
@@ -44,14 +220,36 @@ ServerSensorView::~ServerSensorView()
 	delete heartRateBuffer;
 	delete heartECGBuffer;
 	delete heartPPGBuffer;
+	delete heartFilteredECGBuffer;
+	delete heartFilteredPPGBuffer;
 	delete heartPPIBuffer;
 	delete heartAccBuffer;
 	delete skinEDABuffer;
+	delete heartECGHistory;
+	delete heartPPGHistory;
+	delete heartECGCompressedHistory;
+	delete heartPPGCompressedHistory;
+	delete heartECGPyramid;
+	delete heartPPGPyramid;
+	delete heartAccPyramid;
+	delete heartHRVFilter;
+	delete heartNNSegments;
+	delete heartHRVSpectrum;
+	delete heartPPGBeatDetector;
+	delete heartQRSDetector;
+	delete heartECGFilterBank;
+	delete heartPPGFilterBank;
 
 	for (int filter_index = 0; filter_index < HRVFilter_COUNT; ++filter_index)
 	{
 		delete hrvFilters[filter_index].hrvBuffer;
 	}
+
+	for (int payload_index = 0; payload_index < k_sensor_packet_payload_type_count; ++payload_index)
+	{
+		delete m_sensorPacketChannels[payload_index].packetQueue;
+		delete m_sensorPacketChannels[payload_index].packetArena;
+	}
 }
 
 bool ServerSensorView::allocateDeviceInterface(
@@ -86,6 +284,276 @@ inline int compute_samples_needed(int sample_rate, float sample_history_duration
 	return std::max((int)ceilf((float)sample_rate*sample_history_duration), 1);
 }
 
+// Waveform frames pack several samples each, so long histories are sized in frames rather than samples.
+// Frames split off the end of a notification are only partly full, so assume they are 80% full on average.
+inline size_t compute_history_frames_needed(int sample_rate, float history_duration, size_t max_samples_per_frame)
+{
+	const double frames= ((double)sample_rate * (double)history_duration) / (0.8 * (double)max_samples_per_frame);
+
+	return std::max((size_t)ceil(frames), (size_t)1);
+}
+
+inline size_t compute_compressed_history_size(int sample_rate, float history_duration, size_t channel_count)
+{
+	return (size_t)ceil((double)sample_rate * (double)history_duration * (double)channel_count * k_compressed_history_bytes_per_sample);
+}
+
+static void append_ecg_frames_to_history(
+	CompressedSampleHistory* history, uint64_t first_sequence, const HSLHeartECGFrame* frames, size_t frame_count)
+{
+	if (!history->getIsOpen())
+		return;
+
+	for (size_t frame_index = 0; frame_index < frame_count; ++frame_index)
+	{
+		const HSLHeartECGFrame& frame= frames[frame_index];
+		const size_t sample_count= std::min((size_t)frame.ecgValueCount, k_ecg_samples_per_frame);
+		int32_t samples[k_ecg_samples_per_frame];
+
+		// Sign extend the raw 24-bit samples so neighboring deltas stay small
+		for (size_t sample_index = 0; sample_index < sample_count; ++sample_index)
+		{
+			samples[sample_index]= (int32_t)(frame.ecgValues[sample_index] << 8) >> 8;
+		}
+
+		history->appendFrame(first_sequence + frame_index, frame.timeInSeconds, frame.timeDeltaInSeconds, samples, sample_count);
+	}
+}
+
+static void append_ecg_frames_to_pyramid(SamplePyramid* pyramid, const HSLHeartECGFrame* frames, size_t frame_count)
+{
+	for (size_t frame_index = 0; frame_index < frame_count; ++frame_index)
+	{
+		const HSLHeartECGFrame& frame= frames[frame_index];
+		const size_t sample_count= std::min((size_t)frame.ecgValueCount, k_ecg_samples_per_frame);
+		float values[k_ecg_samples_per_frame];
+
+		unpack_int24_samples(frame.ecgValues, values, sample_count);
+
+		for (size_t sample_index = 0; sample_index < sample_count; ++sample_index)
+		{
+			pyramid->appendSample(frame.timeInSeconds + (double)sample_index * frame.timeDeltaInSeconds, &values[sample_index]);
+		}
+	}
+}
+
+static void append_ppg_frames_to_pyramid(SamplePyramid* pyramid, const HSLHeartPPGFrame* frames, size_t frame_count)
+{
+	for (size_t frame_index = 0; frame_index < frame_count; ++frame_index)
+	{
+		const HSLHeartPPGFrame& frame= frames[frame_index];
+		const size_t sample_count= std::min((size_t)frame.ppgSampleCount, k_ppg_samples_per_frame);
+
+		for (size_t sample_index = 0; sample_index < sample_count; ++sample_index)
+		{
+			const HSLHeartPPGSample& sample= frame.ppgSamples[sample_index];
+			const float values[k_ppg_channel_count]= {
+				(float)sample.ppgValue0, (float)sample.ppgValue1, (float)sample.ppgValue2, (float)sample.ambient};
+
+			pyramid->appendSample(frame.timeInSeconds + (double)sample_index * frame.timeDeltaInSeconds, values);
+		}
+	}
+}
+
+static void append_acc_frames_to_pyramid(SamplePyramid* pyramid, const HSLAccelerometerFrame* frames, size_t frame_count)
+{
+	const size_t max_samples_per_frame= sizeof(HSLAccelerometerFrame::accSamples) / sizeof(HSLAccelerometerFrame::accSamples[0]);
+
+	for (size_t frame_index = 0; frame_index < frame_count; ++frame_index)
+	{
+		const HSLAccelerometerFrame& frame= frames[frame_index];
+		const size_t sample_count= std::min((size_t)frame.accSampleCount, max_samples_per_frame);
+
+		for (size_t sample_index = 0; sample_index < sample_count; ++sample_index)
+		{
+			pyramid->appendSample(
+				frame.timeInSeconds + (double)sample_index * frame.timeDeltaInSeconds, 
+				&frame.accSamples[sample_index].x);
+		}
+	}
+}
+
+// Build a filter bank cascade from the sensor's settings, skipping disabled stages and any
+// corner at or above Nyquist. Returns false if the stream shouldn't be filtered at all.
+static bool configure_filter_bank(BiquadFilterBank* bank, const SensorFilterSettings& settings, int sample_rate)
+{
+	// Butterworth Q for the single second order high and low pass stages
+	const double butterworth_q= 0.70710678118654752;
+	const double nyquist_hz= 0.5 * (double)sample_rate;
+
+	BiquadCoefficients sections[BiquadFilterBank::k_max_sections];
+	int section_count= 0;
+
+	if (settings.enabled && sample_rate > 0)
+	{
+		if (settings.highPassHz > 0.f && settings.highPassHz < nyquist_hz)
+		{
+			sections[section_count++]= make_biquad_high_pass(settings.highPassHz, sample_rate, butterworth_q);
+		}
+
+		if (settings.notchHz > 0.f && settings.notchHz < nyquist_hz && settings.notchQ > 0.f)
+		{
+			sections[section_count++]= make_biquad_notch(settings.notchHz, sample_rate, settings.notchQ);
+		}
+
+		if (settings.lowPassHz > 0.f && settings.lowPassHz < nyquist_hz)
+		{
+			sections[section_count++]= make_biquad_low_pass(settings.lowPassHz, sample_rate, butterworth_q);
+		}
+	}
+
+	bank->setSections(sections, section_count);
+
+	return settings.enabled && sample_rate > 0;
+}
+
+// Run a batch of ECG frames through the filter bank in one block and publish the filtered frames
+static void write_filtered_ecg_frames(
+	BiquadFilterBank* bank, const HSLHeartECGFrame* frames, size_t frame_count,
+	SequencedRingBuffer<HSLFilteredECGFrame>* filtered_buffer)
+{
+	const size_t lane_count= BiquadFilterBank::k_lane_count;
+	double samples[ISensorListener::k_max_frames_per_batch * k_ecg_samples_per_frame * lane_count];
+
+	for (size_t first_frame = 0; first_frame < frame_count; first_frame += ISensorListener::k_max_frames_per_batch)
+	{
+		const size_t block_frame_count= std::min(frame_count - first_frame, (size_t)ISensorListener::k_max_frames_per_batch);
+		size_t block_sample_count= 0;
+
+		// Gather the block into lane 0, leaving the other lanes at zero
+		memset(samples, 0, sizeof(samples));
+		for (size_t frame_index = 0; frame_index < block_frame_count; ++frame_index)
+		{
+			const HSLHeartECGFrame& frame= frames[first_frame + frame_index];
+			const size_t sample_count= std::min((size_t)frame.ecgValueCount, k_ecg_samples_per_frame);
+			float values[k_ecg_samples_per_frame];
+
+			unpack_int24_samples(frame.ecgValues, values, sample_count);
+
+			for (size_t sample_index = 0; sample_index < sample_count; ++sample_index)
+			{
+				samples[(block_sample_count + sample_index) * lane_count]= values[sample_index];
+			}
+			block_sample_count+= sample_count;
+		}
+
+		bank->process(samples, block_sample_count);
+
+		// Scatter back out into frames matching the raw ones
+		HSLFilteredECGFrame filtered_frames[ISensorListener::k_max_frames_per_batch];
+		size_t sample_offset= 0;
+
+		for (size_t frame_index = 0; frame_index < block_frame_count; ++frame_index)
+		{
+			const HSLHeartECGFrame& frame= frames[first_frame + frame_index];
+			HSLFilteredECGFrame& filtered_frame= filtered_frames[frame_index];
+			const size_t sample_count= std::min((size_t)frame.ecgValueCount, k_ecg_samples_per_frame);
+
+			memset(&filtered_frame, 0, sizeof(HSLFilteredECGFrame));
+			for (size_t sample_index = 0; sample_index < sample_count; ++sample_index)
+			{
+				filtered_frame.ecgValues[sample_index]= (float)samples[(sample_offset + sample_index) * lane_count];
+			}
+			filtered_frame.ecgValueCount= (uint16_t)sample_count;
+			filtered_frame.timeInSeconds= frame.timeInSeconds;
+			filtered_frame.timeDeltaInSeconds= frame.timeDeltaInSeconds;
+			sample_offset+= sample_count;
+		}
+
+		filtered_buffer->writeItems(filtered_frames, block_frame_count);
+	}
+}
+
+// Write a PPG frame's channels with the ambient level subtracted into filter bank lanes.
+// Returns the number of samples written.
+static size_t gather_ambient_subtracted_ppg_samples(const HSLHeartPPGFrame& frame, double* out_samples)
+{
+	const size_t lane_count= BiquadFilterBank::k_lane_count;
+	const size_t sample_count= std::min((size_t)frame.ppgSampleCount, k_ppg_samples_per_frame);
+
+	for (size_t sample_index = 0; sample_index < sample_count; ++sample_index)
+	{
+		const HSLHeartPPGSample& sample= frame.ppgSamples[sample_index];
+		double* lanes= &out_samples[sample_index * lane_count];
+
+		lanes[0]= (double)sample.ppgValue0 - (double)sample.ambient;
+		lanes[1]= (double)sample.ppgValue1 - (double)sample.ambient;
+		lanes[2]= (double)sample.ppgValue2 - (double)sample.ambient;
+		lanes[3]= 0.0;
+	}
+
+	return sample_count;
+}
+
+// Subtract the ambient level from each PPG channel, run the three channels through the filter bank
+// side by side in one block and publish the filtered frames
+static void write_filtered_ppg_frames(
+	BiquadFilterBank* bank, const HSLHeartPPGFrame* frames, size_t frame_count,
+	SequencedRingBuffer<HSLFilteredPPGFrame>* filtered_buffer)
+{
+	const size_t lane_count= BiquadFilterBank::k_lane_count;
+	double samples[ISensorListener::k_max_frames_per_batch * k_ppg_samples_per_frame * lane_count];
+
+	for (size_t first_frame = 0; first_frame < frame_count; first_frame += ISensorListener::k_max_frames_per_batch)
+	{
+		const size_t block_frame_count= std::min(frame_count - first_frame, (size_t)ISensorListener::k_max_frames_per_batch);
+		size_t block_sample_count= 0;
+
+		for (size_t frame_index = 0; frame_index < block_frame_count; ++frame_index)
+		{
+			block_sample_count+=
+				gather_ambient_subtracted_ppg_samples(frames[first_frame + frame_index], &samples[block_sample_count * lane_count]);
+		}
+
+		bank->process(samples, block_sample_count);
+
+		HSLFilteredPPGFrame filtered_frames[ISensorListener::k_max_frames_per_batch];
+		size_t sample_offset= 0;
+
+		for (size_t frame_index = 0; frame_index < block_frame_count; ++frame_index)
+		{
+			const HSLHeartPPGFrame& frame= frames[first_frame + frame_index];
+			HSLFilteredPPGFrame& filtered_frame= filtered_frames[frame_index];
+			const size_t sample_count= std::min((size_t)frame.ppgSampleCount, k_ppg_samples_per_frame);
+
+			memset(&filtered_frame, 0, sizeof(HSLFilteredPPGFrame));
+			for (size_t sample_index = 0; sample_index < sample_count; ++sample_index)
+			{
+				const double* lanes= &samples[(sample_offset + sample_index) * lane_count];
+				HSLFilteredPPGSample& filtered_sample= filtered_frame.ppgSamples[sample_index];
+
+				filtered_sample.ppgValue0= (float)lanes[0];
+				filtered_sample.ppgValue1= (float)lanes[1];
+				filtered_sample.ppgValue2= (float)lanes[2];
+			}
+			filtered_frame.ppgSampleCount= (uint16_t)sample_count;
+			filtered_frame.timeInSeconds= frame.timeInSeconds;
+			filtered_frame.timeDeltaInSeconds= frame.timeDeltaInSeconds;
+			sample_offset+= sample_count;
+		}
+
+		filtered_buffer->writeItems(filtered_frames, block_frame_count);
+	}
+}
+
+static void append_ppg_frames_to_history(
+	CompressedSampleHistory* history, uint64_t first_sequence, const HSLHeartPPGFrame* frames, size_t frame_count)
+{
+	if (!history->getIsOpen())
+		return;
+
+	for (size_t frame_index = 0; frame_index < frame_count; ++frame_index)
+	{
+		const HSLHeartPPGFrame& frame= frames[frame_index];
+		const size_t sample_count= std::min((size_t)frame.ppgSampleCount, k_ppg_samples_per_frame);
+
+		// The PPG samples are already interleaved int32 channels
+		history->appendFrame(
+			first_sequence + frame_index, frame.timeInSeconds, frame.timeDeltaInSeconds, 
+			reinterpret_cast<const int32_t*>(frame.ppgSamples), sample_count);
+	}
+}
+
 bool ServerSensorView::open(const class DeviceEnumerator *enumerator)
 {
 	// Attempt to open the sensor
@@ -97,6 +565,48 @@ bool ServerSensorView::open(const class DeviceEnumerator *enumerator)
 
 		// Resize buffers to match requested sample frequency and history duration
 		adjustSampleBufferCapacities();
+
+		// Pick up how each stream should behave when the main thread falls behind
+		applyPacketOverflowPolicies();
+
+		// Start the HRV window and segments over for the new device
+		const SensorManagerConfig& config= DeviceManager::getInstance()->getSensorManager()->getConfig();
+		heartHRVFilter->setWindowDuration(config.hrvWindowSeconds);
+		heartNNSegments->setSegmentDuration(config.sdannSegmentMinutes * 60.0);
+		heartHRVSpectrum->setWindowDuration(config.hrvSpectrumWindowSeconds);
+		m_bHasNewHRVIntervals= false;
+		m_bHasNewNNSegment= false;
+		m_bHasNewHRVSpectrum= false;
+
+		int ecg_sample_rate= 0;
+		if (m_device->getCapabilitySamplingRate(HSLCapability_Electrocardiography, ecg_sample_rate))
+		{
+			heartQRSDetector->setSampleRate(ecg_sample_rate);
+		}
+		else
+		{
+			heartQRSDetector->reset();
+		}
+
+		// Set up the waveform filter banks from the sensor's settings
+		SensorFilterSettings filter_settings;
+		m_bFilterECG=
+			m_device->getCapabilityFilterSettings(HSLCapability_Electrocardiography, filter_settings) &&
+			configure_filter_bank(heartECGFilterBank, filter_settings, ecg_sample_rate);
+
+		int ppg_sample_rate;
+		if (m_device->getCapabilitySamplingRate(HSLCapability_Photoplethysmography, ppg_sample_rate))
+		{
+			heartPPGBeatDetector->setSampleRate(ppg_sample_rate);
+			m_bFilterPPG=
+				m_device->getCapabilityFilterSettings(HSLCapability_Photoplethysmography, filter_settings) &&
+				configure_filter_bank(heartPPGFilterBank, filter_settings, ppg_sample_rate);
+		}
+		else
+		{
+			heartPPGBeatDetector->reset();
+			m_bFilterPPG= false;
+		}
 	}
 
 	return bSuccess;
@@ -111,13 +621,23 @@ void ServerSensorView::adjustSampleBufferCapacities()
 	float sample_history_duration = m_device->getSampleHistoryDuration();
 	t_hsl_caps_bitmask caps_bitmask = m_device->getSensorCapabilities();
 
+	// Lay the rings out again from the start of this sensor's arena partition.
+	// This drops any buffered history, which is fine since it only happens when the sensor is (re)opened.
+	SampleBufferArena* arena = DeviceManager::getInstance()->getSensorManager()->getSampleBufferArena();
+	const int partition_index = SensorManager::getServiceSampleBufferPartition(getDeviceID());
+
+	if (arena != nullptr)
+	{
+		arena->resetPartition(partition_index);
+	}
+
 	if (HSL_BITMASK_GET_FLAG(caps_bitmask, HSLCapability_HeartRate))
 	{
 		int sample_rate;
 		if (m_device->getCapabilitySamplingRate(HSLCapability_HeartRate, sample_rate))
 		{
 			int samples_needed = compute_samples_needed(sample_rate, sample_history_duration);
-			heartRateBuffer->setCapacity(samples_needed);
+			assign_sample_buffer_storage(arena, partition_index, heartRateBuffer, samples_needed);
 		}
 	}
 
@@ -128,7 +648,8 @@ void ServerSensorView::adjustSampleBufferCapacities()
 		{
 			int samples_needed = compute_samples_needed(sample_rate, sample_history_duration);
 
-			heartECGBuffer->setCapacity(samples_needed);
+			assign_sample_buffer_storage(arena, partition_index, heartECGBuffer, samples_needed);
+			assign_sample_buffer_storage(arena, partition_index, heartFilteredECGBuffer, samples_needed);
 		}
 	}
 
@@ -139,7 +660,8 @@ void ServerSensorView::adjustSampleBufferCapacities()
 		{
 			int samples_needed = compute_samples_needed(sample_rate, sample_history_duration);
 
-			heartPPGBuffer->setCapacity(samples_needed);
+			assign_sample_buffer_storage(arena, partition_index, heartPPGBuffer, samples_needed);
+			assign_sample_buffer_storage(arena, partition_index, heartFilteredPPGBuffer, samples_needed);
 		}
 	}
 
@@ -150,9 +672,16 @@ void ServerSensorView::adjustSampleBufferCapacities()
 		{
 			int samples_needed = compute_samples_needed(sample_rate, sample_history_duration);
 
-			heartPPIBuffer->setCapacity(samples_needed);
+			assign_sample_buffer_storage(arena, partition_index, heartPPIBuffer, samples_needed);
 		}
 	}
+	else if (HSL_BITMASK_GET_FLAG(caps_bitmask, HSLCapability_Photoplethysmography))
+	{
+		// Pulse intervals are synthesized from the raw PPG instead
+		int samples_needed = compute_samples_needed(k_synthesized_ppi_frame_rate, sample_history_duration);
+
+		assign_sample_buffer_storage(arena, partition_index, heartPPIBuffer, samples_needed);
+	}
 
 	if (HSL_BITMASK_GET_FLAG(caps_bitmask, HSLCapability_Accelerometer))
 	{
@@ -161,7 +690,7 @@ void ServerSensorView::adjustSampleBufferCapacities()
 		{
 			int samples_needed = compute_samples_needed(sample_rate, sample_history_duration);
 
-			heartAccBuffer->setCapacity(samples_needed);
+			assign_sample_buffer_storage(arena, partition_index, heartAccBuffer, samples_needed);
 		}
 	}
 
@@ -172,26 +701,183 @@ void ServerSensorView::adjustSampleBufferCapacities()
 		{
 			int samples_needed = compute_samples_needed(sample_rate, sample_history_duration);
 
-			skinEDABuffer->setCapacity(samples_needed);
+			assign_sample_buffer_storage(arena, partition_index, skinEDABuffer, samples_needed);
 		}
 	}
 
-	// We can compute HRV statistics if we either have ECG data or PPI data
+	// We can compute HRV statistics if we either have ECG data or PPI data (from the device or the raw PPG)
 	if (HSL_BITMASK_GET_FLAG(caps_bitmask, HSLCapability_Electrocardiography) ||
-		HSL_BITMASK_GET_FLAG(caps_bitmask, HSLCapability_PulseInterval))
+		HSL_BITMASK_GET_FLAG(caps_bitmask, HSLCapability_PulseInterval) ||
+		HSL_BITMASK_GET_FLAG(caps_bitmask, HSLCapability_Photoplethysmography))
 	{
 		int hrv_samples_needed = m_device->getHeartRateVariabliyHistorySize();
 
 		for (int filter_index = 0; filter_index < HRVFilter_COUNT; ++filter_index)
 		{
-			hrvFilters[filter_index].hrvBuffer->setCapacity(hrv_samples_needed);
+			assign_sample_buffer_storage(arena, partition_index, hrvFilters[filter_index].hrvBuffer, hrv_samples_needed);
+		}
+	}
+
+	adjustSampleHistoryFiles();
+	adjustSamplePyramids();
+
+	// Let clients know any storage they were mirroring from has moved
+	++m_sampleBufferLayoutGeneration;
+}
+
+void ServerSensorView::adjustSampleHistoryFiles()
+{
+	const SensorManager* sensor_manager= DeviceManager::getInstance()->getSensorManager();
+	const SensorManagerConfig& config= sensor_manager->getConfig();
+	const float history_duration= config.sampleHistoryFileHours * 3600.f;
+	t_hsl_caps_bitmask caps_bitmask = m_device->getSensorCapabilities();
+	int sample_rate;
+
+	// Only one kind of history is kept per stream
+	if (history_duration > 0.f &&
+		HSL_BITMASK_GET_FLAG(caps_bitmask, HSLCapability_Electrocardiography) &&
+		m_device->getCapabilitySamplingRate(HSLCapability_Electrocardiography, sample_rate))
+	{
+		bool bOpened;
+
+		if (config.sampleHistoryCompressed)
+		{
+			heartECGHistory->close();
+			bOpened= heartECGCompressedHistory->open(
+				sensor_manager->getSampleHistoryFilePath(getDeviceID(), "ecg_compressed"),
+				compute_compressed_history_size(sample_rate, history_duration, 1));
+		}
+		else
+		{
+			heartECGCompressedHistory->close();
+			bOpened= heartECGHistory->open(
+				sensor_manager->getSampleHistoryFilePath(getDeviceID(), "ecg"),
+				compute_history_frames_needed(sample_rate, history_duration, k_ecg_samples_per_frame));
+		}
+
+		if (!bOpened)
+		{
+			HSL_LOG_WARNING("ServerSensorView::adjustSampleHistoryFiles") << "ECG history will only be kept in memory";
 		}
 	}
+	else
+	{
+		heartECGHistory->close();
+		heartECGCompressedHistory->close();
+	}
+
+	if (history_duration > 0.f &&
+		HSL_BITMASK_GET_FLAG(caps_bitmask, HSLCapability_Photoplethysmography) &&
+		m_device->getCapabilitySamplingRate(HSLCapability_Photoplethysmography, sample_rate))
+	{
+		bool bOpened;
+
+		if (config.sampleHistoryCompressed)
+		{
+			heartPPGHistory->close();
+			bOpened= heartPPGCompressedHistory->open(
+				sensor_manager->getSampleHistoryFilePath(getDeviceID(), "ppg_compressed"),
+				compute_compressed_history_size(sample_rate, history_duration, k_ppg_channel_count));
+		}
+		else
+		{
+			heartPPGCompressedHistory->close();
+			bOpened= heartPPGHistory->open(
+				sensor_manager->getSampleHistoryFilePath(getDeviceID(), "ppg"),
+				compute_history_frames_needed(sample_rate, history_duration, k_ppg_samples_per_frame));
+		}
+
+		if (!bOpened)
+		{
+			HSL_LOG_WARNING("ServerSensorView::adjustSampleHistoryFiles") << "PPG history will only be kept in memory";
+		}
+	}
+	else
+	{
+		heartPPGHistory->close();
+		heartPPGCompressedHistory->close();
+	}
+}
+
+void ServerSensorView::adjustSamplePyramids()
+{
+	const float pyramid_duration= DeviceManager::getInstance()->getSensorManager()->getConfig().samplePyramidMinutes * 60.f;
+	t_hsl_caps_bitmask caps_bitmask = m_device->getSensorCapabilities();
+	int sample_rate;
+
+	// A zero capacity disables the pyramid for that stream
+	size_t ecg_samples_needed= 0;
+	if (pyramid_duration > 0.f &&
+		HSL_BITMASK_GET_FLAG(caps_bitmask, HSLCapability_Electrocardiography) &&
+		m_device->getCapabilitySamplingRate(HSLCapability_Electrocardiography, sample_rate))
+	{
+		ecg_samples_needed= compute_samples_needed(sample_rate, pyramid_duration);
+	}
+	heartECGPyramid->setCapacity(ecg_samples_needed);
+
+	size_t ppg_samples_needed= 0;
+	if (pyramid_duration > 0.f &&
+		HSL_BITMASK_GET_FLAG(caps_bitmask, HSLCapability_Photoplethysmography) &&
+		m_device->getCapabilitySamplingRate(HSLCapability_Photoplethysmography, sample_rate))
+	{
+		ppg_samples_needed= compute_samples_needed(sample_rate, pyramid_duration);
+	}
+	heartPPGPyramid->setCapacity(ppg_samples_needed);
+
+	size_t acc_samples_needed= 0;
+	if (pyramid_duration > 0.f &&
+		HSL_BITMASK_GET_FLAG(caps_bitmask, HSLCapability_Accelerometer) &&
+		m_device->getCapabilitySamplingRate(HSLCapability_Accelerometer, sample_rate))
+	{
+		acc_samples_needed= compute_samples_needed(sample_rate, pyramid_duration);
+	}
+	heartAccPyramid->setCapacity(acc_samples_needed);
+}
+
+void ServerSensorView::applyPacketOverflowPolicies()
+{
+	const SensorManagerConfig& config= DeviceManager::getInstance()->getSensorManager()->getConfig();
+
+	for (int payload_index = 0; payload_index < k_sensor_packet_payload_type_count; ++payload_index)
+	{
+		SensorPacketOverflowPolicy policy= SensorPacketOverflowPolicy::DropNewest;
+
+		switch ((ISensorListener::SensorPacketPayloadType)payload_index)
+		{
+		case ISensorListener::SensorPacketPayloadType::HRFrame:
+			policy= config.hrOverflowPolicy;
+			break;
+		case ISensorListener::SensorPacketPayloadType::ECGFrame:
+			policy= config.ecgOverflowPolicy;
+			break;
+		case ISensorListener::SensorPacketPayloadType::PPGFrame:
+			policy= config.ppgOverflowPolicy;
+			break;
+		case ISensorListener::SensorPacketPayloadType::PPIFrame:
+			policy= config.ppiOverflowPolicy;
+			break;
+		case ISensorListener::SensorPacketPayloadType::ACCFrame:
+			policy= config.accOverflowPolicy;
+			break;
+		case ISensorListener::SensorPacketPayloadType::EDAFrame:
+			policy= config.edaOverflowPolicy;
+			break;
+		}
+
+		m_sensorPacketChannels[payload_index].overflowPolicy.store((int)policy);
+	}
 }
 
 void ServerSensorView::close()
 {
 	ServerDeviceView::close();
+
+	// The next device opened in this slot starts new stream clocks
+	ClockDomainManager* clock_domains= DeviceManager::getInstance()->getSensorManager()->getClockDomainManager();
+	if (clock_domains != nullptr)
+	{
+		clock_domains->resetSensor(getDeviceID());
+	}
 }
 
 bool ServerSensorView::setActiveSensorDataStreams(t_hsl_caps_bitmask data_stream_flags)
@@ -257,85 +943,368 @@ bool ServerSensorView::getCapabilityBitResolution(HSLSensorCapabilityType cap_ty
 	return false;
 }
 
-void ServerSensorView::notifySensorDataReceived(const ISensorListener::SensorPacket *sensor_packet)
+void ServerSensorView::notifySensorDataReceived(const ISensorListener::SensorPacketBatch *sensor_batch)
 {
-	// Compute the time in seconds since the last update
-	const t_high_resolution_timepoint now = std::chrono::high_resolution_clock::now();
-	t_high_resolution_duration durationSinceLastUpdate= t_high_resolution_duration::zero();
+	// Called from BLE callback threads.
+	// Only the one characteristic callback that produces this payload type writes to its channel.
+	SensorPacketChannel& channel= m_sensorPacketChannels[(int)sensor_batch->payloadType];
 
-	if (m_bIsLastSensorDataTimestampValid)
+	const uint16_t frame_size= (uint16_t)get_payload_frame_size(sensor_batch->payloadType);
+	const uint16_t frame_count= (uint16_t)sensor_batch->frameCount;
+
+	// Stamp the record with when it arrived so the main thread can align the stream with the others
+	const double arrival_time= ClockDomainManager::getHostTime();
+
+	// Only copy the frames actually used into the arena and pass the record along by handle
+	t_packet_handle handle=
+		channel.packetArena->writeRecord(
+			(int32_t)sensor_batch->payloadType, &sensor_batch->payload, frame_size, frame_count, arrival_time);
+
+	// The main thread has fallen behind and every record is in flight.
+	// Either make room by throwing out the oldest queued packets or drop this one.
+	if (handle == k_invalid_packet_handle &&
+		channel.overflowPolicy.load(std::memory_order_relaxed) == (int)SensorPacketOverflowPolicy::DropOldest)
 	{
-		durationSinceLastUpdate = now - m_lastSensorDataTimestamp;
+		t_packet_handle evicted_handle;
+		while (handle == k_invalid_packet_handle && channel.packetQueue->tryEvictOldest(evicted_handle))
+		{
+			channel.packetArena->reclaimRecord(evicted_handle);
+			channel.droppedPacketCount.fetch_add(1, std::memory_order_relaxed);
+
+			handle=
+				channel.packetArena->writeRecord(
+					(int32_t)sensor_batch->payloadType, &sensor_batch->payload, frame_size, frame_count, arrival_time);
+		}
 	}
-	m_lastSensorDataTimestamp= now;
-	m_bIsLastSensorDataTimestampValid= true;
 
+	if (handle != k_invalid_packet_handle)
 	{
-		std::lock_guard<std::mutex> write_lock(m_sensorPacketWriteMutex);
-
-		m_sensorPacketQueue.enqueue(*sensor_packet);
+		channel.packetQueue->tryPush(handle);
+	}
+	else
+	{
+		channel.droppedPacketCount.fetch_add(1, std::memory_order_relaxed);
 	}
 }
 
 // Update Pose Filter using update packets from the tracker and IMU threads
 void ServerSensorView::processDevicePacketQueues()
 {
+	ClockDomainManager* clock_domains= DeviceManager::getInstance()->getSensorManager()->getClockDomainManager();
+	const t_hsl_caps_bitmask active_streams= getActiveSensorDataStreams();
+	// Beats are found in the raw PPG when the device isn't sending its own pulse intervals
+	const bool bSynthesizePulseIntervals=
+		DeviceManager::getInstance()->getSensorManager()->getConfig().ppgBeatDetection &&
+		HSL_BITMASK_GET_FLAG(active_streams, HSLCapability_Photoplethysmography) &&
+		!HSL_BITMASK_GET_FLAG(active_streams, HSLCapability_PulseInterval);
+
 	// Drain the packet queues filled by the threads
-	ISensorListener::SensorPacket packet;
-	while (m_sensorPacketQueue.try_dequeue(packet))
+	for (int payload_index = 0; payload_index < k_sensor_packet_payload_type_count; ++payload_index)
 	{
-		switch (packet.payloadType)
+		SensorPacketChannel& channel= m_sensorPacketChannels[payload_index];
+
+		t_packet_handle handle;
+		while (channel.packetQueue->tryPop(handle))
 		{
-		case ISensorListener::SensorPacketPayloadType::ACCFrame:
-			heartAccBuffer->writeItem(packet.payload.accFrame);
-			break;
-		case ISensorListener::SensorPacketPayloadType::ECGFrame:
-			heartECGBuffer->writeItem(packet.payload.ecgFrame);
-			break;
-		case ISensorListener::SensorPacketPayloadType::HRFrame:
-			heartRateBuffer->writeItem(packet.payload.hrFrame);
-			break;
-		case ISensorListener::SensorPacketPayloadType::PPGFrame:
-			heartPPGBuffer->writeItem(packet.payload.ppgFrame);
-			break;
-		case ISensorListener::SensorPacketPayloadType::PPIFrame:
-			heartPPIBuffer->writeItem(packet.payload.ppiFrame);
-			break;
-		case ISensorListener::SensorPacketPayloadType::EDAFrame:
-			skinEDABuffer->writeItem(packet.payload.edaFrame);
-			break;
+			const PacketRecordHeader* header= channel.packetArena->getRecordHeader(handle);
+			const void* payload= channel.packetArena->getRecordPayload(handle);
+
+			switch ((ISensorListener::SensorPacketPayloadType)header->tag)
+			{
+			case ISensorListener::SensorPacketPayloadType::ACCFrame:
+				heartAccBuffer->writeItems((const HSLAccelerometerFrame*)payload, header->itemCount);
+				append_acc_frames_to_pyramid(heartAccPyramid, (const HSLAccelerometerFrame*)payload, header->itemCount);
+				break;
+			case ISensorListener::SensorPacketPayloadType::ECGFrame:
+				heartECGBuffer->writeItems((const HSLHeartECGFrame*)payload, header->itemCount);
+				heartECGHistory->appendFrom(*heartECGBuffer);
+				append_ecg_frames_to_history(
+					heartECGCompressedHistory, heartECGBuffer->getHeadSequence() - header->itemCount,
+					(const HSLHeartECGFrame*)payload, header->itemCount);
+				append_ecg_frames_to_pyramid(heartECGPyramid, (const HSLHeartECGFrame*)payload, header->itemCount);
+				appendECGFramesToHRV((const HSLHeartECGFrame*)payload, header->itemCount);
+				if (m_bFilterECG)
+				{
+					write_filtered_ecg_frames(
+						heartECGFilterBank, (const HSLHeartECGFrame*)payload, header->itemCount, heartFilteredECGBuffer);
+				}
+				break;
+			case ISensorListener::SensorPacketPayloadType::HRFrame:
+				heartRateBuffer->writeItems((const HSLHeartRateFrame*)payload, header->itemCount);
+				// ECG R peaks and then the PPI stream measure the same beats more precisely, so only one source feeds HRV
+				if (!HSL_BITMASK_GET_FLAG(active_streams, HSLCapability_Electrocardiography) &&
+					!HSL_BITMASK_GET_FLAG(active_streams, HSLCapability_PulseInterval) &&
+					!bSynthesizePulseIntervals)
+				{
+					appendHeartRateFramesToHRV((const HSLHeartRateFrame*)payload, header->itemCount);
+				}
+				break;
+			case ISensorListener::SensorPacketPayloadType::PPGFrame:
+				heartPPGBuffer->writeItems((const HSLHeartPPGFrame*)payload, header->itemCount);
+				heartPPGHistory->appendFrom(*heartPPGBuffer);
+				append_ppg_frames_to_history(
+					heartPPGCompressedHistory, heartPPGBuffer->getHeadSequence() - header->itemCount,
+					(const HSLHeartPPGFrame*)payload, header->itemCount);
+				append_ppg_frames_to_pyramid(heartPPGPyramid, (const HSLHeartPPGFrame*)payload, header->itemCount);
+				if (m_bFilterPPG)
+				{
+					write_filtered_ppg_frames(
+						heartPPGFilterBank, (const HSLHeartPPGFrame*)payload, header->itemCount, heartFilteredPPGBuffer);
+				}
+				if (bSynthesizePulseIntervals)
+				{
+					appendPPGFramesToPulseIntervals(
+						(const HSLHeartPPGFrame*)payload, header->itemCount,
+						!HSL_BITMASK_GET_FLAG(active_streams, HSLCapability_Electrocardiography));
+				}
+				break;
+			case ISensorListener::SensorPacketPayloadType::PPIFrame:
+				heartPPIBuffer->writeItems((const HSLHeartPPIFrame*)payload, header->itemCount);
+				if (!HSL_BITMASK_GET_FLAG(active_streams, HSLCapability_Electrocardiography))
+				{
+					appendPulseIntervalFramesToHRV((const HSLHeartPPIFrame*)payload, header->itemCount);
+				}
+				break;
+			case ISensorListener::SensorPacketPayloadType::EDAFrame:
+				skinEDABuffer->writeItems((const HSLElectrodermalActivityFrame*)payload, header->itemCount);
+				break;
+			}
+
+			// Refine this stream's mapping onto the shared timeline
+			HSLSensorCapabilityType cap_type;
+			double newest_sample_time;
+			if (clock_domains != nullptr &&
+				get_newest_sample_time(
+					(ISensorListener::SensorPacketPayloadType)header->tag, payload, header->itemCount,
+					cap_type, newest_sample_time))
+			{
+				clock_domains->addObservation(getDeviceID(), cap_type, newest_sample_time, header->timestamp);
+			}
+
+			channel.packetArena->releaseRecord(handle);
 		}
 	}
 
 	// Find the latest valid heart rate valid from either the PPI buffer or the HR buffer
 	recomputeHeartRateBPM();
 
+	// Post the HRV filters that changed with this batch of beats
+	publishHeartRateVariability();
+}
+
+void ServerSensorView::addHeartRateVariabilityInterval(double interval_ms, double time_in_seconds)
+{
+	// Artifacts rejected by the sliding window filter are kept out of the segment means as well
+	if (heartHRVFilter->addInterval(interval_ms))
+	{
+		if (heartNNSegments->addInterval(interval_ms, time_in_seconds))
+		{
+			m_bHasNewNNSegment= true;
+		}
+
+		if (heartHRVSpectrum->addInterval(interval_ms, time_in_seconds))
+		{
+			m_bHasNewHRVSpectrum= true;
+		}
+
+		m_newestHRVIntervalTime= time_in_seconds;
+		m_bHasNewHRVIntervals= true;
+	}
+}
+
+// RR intervals from the HR characteristic are in 1/1024 second units
+void ServerSensorView::appendHeartRateFramesToHRV(const HSLHeartRateFrame* frames, size_t frame_count)
+{
+	const size_t max_intervals_per_frame= sizeof(HSLHeartRateFrame::RRIntervals) / sizeof(HSLHeartRateFrame::RRIntervals[0]);
+
+	for (size_t frame_index = 0; frame_index < frame_count; ++frame_index)
+	{
+		const HSLHeartRateFrame& frame= frames[frame_index];
+		const size_t interval_count= std::min((size_t)frame.RRIntervalCount, max_intervals_per_frame);
+
+		// Beats measured without skin contact are noise
+		if (frame.contactStatus == HSLContactStatus_NoContact)
+		{
+			heartHRVFilter->markDiscontinuity();
+			continue;
+		}
+
+		for (size_t interval_index = 0; interval_index < interval_count; ++interval_index)
+		{
+			addHeartRateVariabilityInterval(
+				(double)frame.RRIntervals[interval_index] * 1000.0 / 1024.0, frame.timeInSeconds);
+		}
+	}
+}
+
+// RR intervals measured between R peaks found in the raw ECG
+void ServerSensorView::appendECGFramesToHRV(const HSLHeartECGFrame* frames, size_t frame_count)
+{
+	for (size_t frame_index = 0; frame_index < frame_count; ++frame_index)
+	{
+		const HSLHeartECGFrame& frame= frames[frame_index];
+		const size_t sample_count= std::min((size_t)frame.ecgValueCount, k_ecg_samples_per_frame);
+		float values[k_ecg_samples_per_frame];
+
+		unpack_int24_samples(frame.ecgValues, values, sample_count);
+
+		for (size_t sample_index = 0; sample_index < sample_count; ++sample_index)
+		{
+			const double sample_time= frame.timeInSeconds + (double)sample_index * frame.timeDeltaInSeconds;
+
+			if (heartQRSDetector->addSample(values[sample_index], sample_time))
+			{
+				double rr_interval_ms;
+
+				if (heartQRSDetector->getLastRRInterval(rr_interval_ms))
+				{
+					addHeartRateVariabilityInterval(rr_interval_ms, heartQRSDetector->getLastRPeakTime());
+				}
+				else
+				{
+					// First beat after a gap in the ECG
+					heartHRVFilter->markDiscontinuity();
+				}
+			}
+		}
+	}
+}
+
+// Find beats in the raw PPG and publish them as pulse interval frames, the same as the device's PPI stream
+void ServerSensorView::appendPPGFramesToPulseIntervals(const HSLHeartPPGFrame* frames, size_t frame_count, bool bFeedHRV)
+{
+	const size_t lane_count= BiquadFilterBank::k_lane_count;
+
+	for (size_t frame_index = 0; frame_index < frame_count; ++frame_index)
+	{
+		const HSLHeartPPGFrame& frame= frames[frame_index];
+		double samples[k_ppg_samples_per_frame * lane_count];
+		PPGBeatDetector::Beat beats[k_ppg_samples_per_frame];
+
+		const size_t sample_count= gather_ambient_subtracted_ppg_samples(frame, samples);
+		const size_t beat_count=
+			heartPPGBeatDetector->addSamples(
+				samples, sample_count, frame.timeInSeconds, frame.timeDeltaInSeconds,
+				beats, k_ppg_samples_per_frame);
+
+		for (size_t beat_index = 0; beat_index < beat_count; ++beat_index)
+		{
+			const PPGBeatDetector::Beat& beat= beats[beat_index];
+
+			// The first beat after a gap has nothing to measure from
+			if (beat.intervalMilliseconds <= 0.0)
+			{
+				if (bFeedHRV)
+				{
+					heartHRVFilter->markDiscontinuity();
+				}
+				continue;
+			}
+
+			HSLHeartPPIFrame ppi_frame;
+			memset(&ppi_frame, 0, sizeof(HSLHeartPPIFrame));
+
+			// Intervals the detector doesn't trust (missed or extra beats) are flagged like the device flags them
+			HSLHeartPPISample& sample= ppi_frame.ppiSamples[0];
+			const double interval_ms= std::min(beat.intervalMilliseconds, 65535.0);
+			sample.pulseDuration= (uint16_t)lround(interval_ms);
+			sample.pulseDurationErrorEst= (uint16_t)std::max(lround(500.0 * frame.timeDeltaInSeconds), 1L);
+			sample.beatsPerMinute= beat.bHasInterval ? (uint8_t)std::min(lround(60000.0 / interval_ms), 255L) : 0;
+			sample.blockerBit= beat.bHasInterval ? 0 : 1;
+			ppi_frame.ppiSampleCount= 1;
+			ppi_frame.timeInSeconds= beat.timeInSeconds;
+
+			heartPPIBuffer->writeItem(ppi_frame);
+
+			if (bFeedHRV)
+			{
+				if (beat.bHasInterval)
+				{
+					// Use the unrounded interval, it's finer than a millisecond
+					addHeartRateVariabilityInterval(beat.intervalMilliseconds, beat.timeInSeconds);
+				}
+				else
+				{
+					heartHRVFilter->markDiscontinuity();
+				}
+			}
+		}
+	}
+}
+
+// Pulse durations from the PMD PPI stream are in milliseconds
+void ServerSensorView::appendPulseIntervalFramesToHRV(const HSLHeartPPIFrame* frames, size_t frame_count)
+{
+	const size_t max_samples_per_frame= sizeof(HSLHeartPPIFrame::ppiSamples) / sizeof(HSLHeartPPIFrame::ppiSamples[0]);
+
+	for (size_t frame_index = 0; frame_index < frame_count; ++frame_index)
+	{
+		const HSLHeartPPIFrame& frame= frames[frame_index];
+		const size_t sample_count= std::min((size_t)frame.ppiSampleCount, max_samples_per_frame);
+
+		for (size_t sample_index = 0; sample_index < sample_count; ++sample_index)
+		{
+			const HSLHeartPPISample& sample= frame.ppiSamples[sample_index];
+
+			// The sensor flags pulses it couldn't trust (movement, or no skin contact)
+			if (sample.blockerBit || (sample.supportsSkinContactBit && !sample.skinContactBit))
+			{
+				heartHRVFilter->markDiscontinuity();
+				continue;
+			}
+
+			addHeartRateVariabilityInterval((double)sample.pulseDuration, frame.timeInSeconds);
+		}
+	}
+}
+
+void ServerSensorView::publishHeartRateVariability()
+{
+	if (!m_bHasNewHRVIntervals)
+		return;
+
 	for (int filter_index = 0; filter_index < HRVFilter_COUNT; ++filter_index)
 	{
-		CircularBuffer<HSLHeartVariabilityFrame> *hrvBuffer= hrvFilters[filter_index].hrvBuffer;
+		SequencedRingBuffer<HSLHeartVariabilityFrame> *hrvBuffer= hrvFilters[filter_index].hrvBuffer;
 
 		if (hrvBuffer != nullptr && HSL_BITMASK_GET_FLAG(m_activeFilterBitmask, filter_index))
 		{
-			// TODO: Update hrvBuffer
+			HSLHeartVariabilityFrame frame;
+			bool bHasValue= false;
+
 			switch (filter_index)
-			{				
+			{
 			case HRVFilter_SDANN:
+				// Only changes when a segment closes
+				bHasValue= m_bHasNewNNSegment && heartNNSegments->getSDANN(frame.hrvValue);
 				break;
 			case HRVFilter_RMSSD:
-				break;
 			case HRVFilter_SDSD:
-				break;
 			case HRVFilter_NN50:
-				break;
 			case HRVFilter_pNN50:
-				break;
 			case HRVFilter_NN20:
-				break;
 			case HRVFilter_pNN20:
+				bHasValue= heartHRVFilter->getFilterValue((HSLHeartRateVariabityFilterType)filter_index, frame.hrvValue);
+				break;
+			case HRVFilter_LFPower:
+			case HRVFilter_HFPower:
+			case HRVFilter_LFHFRatio:
+				// Only re-evaluated every few beats
+				bHasValue= m_bHasNewHRVSpectrum && heartHRVSpectrum->getFilterValue((HSLHeartRateVariabityFilterType)filter_index, frame.hrvValue);
 				break;
 			}
+
+			if (bHasValue)
+			{
+				frame.timeInSeconds= m_newestHRVIntervalTime;
+				hrvBuffer->writeItem(frame);
+			}
 		}
 	}
+
+	m_bHasNewHRVIntervals= false;
+	m_bHasNewNNSegment= false;
+	m_bHasNewHRVSpectrum= false;
 }
 
 // Returns the full device path for the sensor
@@ -372,12 +1341,11 @@ void ServerSensorView::recomputeHeartRateBPM()
 	{
 		const t_hsl_caps_bitmask data_stream_bitmask = m_device->getActiveSensorDataStreams();
 
-		// First try to find the most recent Pulse-to-Pulse-Interval derived HeartRate (only Polar sensors)
-		if (!heartPPIBuffer->isEmpty())
+		// First try to find the most recent Pulse-to-Pulse-Interval derived HeartRate
+		// (the Polar PPI stream, or beats found in the raw PPG stream)
+		const HSLHeartPPIFrame* PPIFrame = heartPPIBuffer->getNewestItem();
+		if (PPIFrame != nullptr)
 		{
-			const size_t newestIndex = heartPPIBuffer->getWriteIndex();
-			const HSLHeartPPIFrame* PPIFrame = &heartPPIBuffer->getBuffer()[newestIndex];
-
 			for (int sampleIndex = 0; sampleIndex < PPIFrame->ppiSampleCount; ++sampleIndex)
 			{
 				const HSLHeartPPISample& PPISample = PPIFrame->ppiSamples[sampleIndex];
@@ -390,11 +1358,9 @@ void ServerSensorView::recomputeHeartRateBPM()
 		}
 
 		// Fall back to most recent generic HeartRate packet (all HR sensors)
-		if (newHeartRate == 0 && !heartRateBuffer->isEmpty())
+		const HSLHeartRateFrame* HRFrame = heartRateBuffer->getNewestItem();
+		if (newHeartRate == 0 && HRFrame != nullptr)
 		{
-			const size_t newestIndex = heartRateBuffer->getWriteIndex();
-			const HSLHeartRateFrame* HRFrame = &heartRateBuffer->getBuffer()[newestIndex];
-
 			if (HRFrame->beatsPerMinute > 0)
 			{
 				newHeartRate = HRFrame->beatsPerMinute;
@@ -428,6 +1394,54 @@ uint16_t ServerSensorView::getHeartRateBPM() const
 	return m_lastValidHR;
 }
 
+bool ServerSensorView::getCapabilityDroppedPacketCount(HSLSensorCapabilityType cap_type, uint64_t& out_dropped_count) const
+{
+	ISensorListener::SensorPacketPayloadType payload_type;
+
+	switch (cap_type)
+	{
+	case HSLCapability_HeartRate:
+		payload_type= ISensorListener::SensorPacketPayloadType::HRFrame;
+		break;
+	case HSLCapability_Electrocardiography:
+		payload_type= ISensorListener::SensorPacketPayloadType::ECGFrame;
+		break;
+	case HSLCapability_Photoplethysmography:
+		payload_type= ISensorListener::SensorPacketPayloadType::PPGFrame;
+		break;
+	case HSLCapability_PulseInterval:
+		payload_type= ISensorListener::SensorPacketPayloadType::PPIFrame;
+		break;
+	case HSLCapability_Accelerometer:
+		payload_type= ISensorListener::SensorPacketPayloadType::ACCFrame;
+		break;
+	case HSLCapability_ElectrodermalActivity:
+		payload_type= ISensorListener::SensorPacketPayloadType::EDAFrame;
+		break;
+	default:
+		return false;
+	}
+
+	out_dropped_count= m_sensorPacketChannels[(int)payload_type].droppedPacketCount.load(std::memory_order_relaxed);
+
+	return true;
+}
+
+const SamplePyramid *ServerSensorView::getCapabilitySamplePyramid(HSLSensorCapabilityType cap_type) const
+{
+	switch (cap_type)
+	{
+	case HSLCapability_Electrocardiography:
+		return heartECGPyramid;
+	case HSLCapability_Photoplethysmography:
+		return heartPPGPyramid;
+	case HSLCapability_Accelerometer:
+		return heartAccPyramid;
+	default:
+		return nullptr;
+	}
+}
+
 // Fill out the HSLDeviceInformation info struct
 bool ServerSensorView::fetchDeviceInformation(HSLDeviceInformation* out_device_info) const
 {
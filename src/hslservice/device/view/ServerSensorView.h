@@ -5,12 +5,22 @@
 #include "ServerDeviceView.h"
 #include "HSLClient_CAPI.h"
 #include "HSLServiceInterface.h"
-#include "CircularBuffer.h"
-
-#include "readerwriterqueue.h" // lockfree queue
+#include "PacketArena.h"
+#include "PacketHandleQueue.h"
+#include "BiquadFilterBank.h"
+#include "PPGBeatDetector.h"
+#include "QRSDetector.h"
+#include "CompressedSampleHistory.h"
+#include "HeartRateVariabilityFilter.h"
+#include "SampleHistoryFile.h"
+#include "SamplePyramid.h"
+#include "SequencedRingBuffer.h"
 
 #include <array>
-#include <mutex>
+#include <atomic>
+
+// -- constants -----
+static const int k_sensor_packet_payload_type_count = (int)ISensorListener::SensorPacketPayloadType::EDAFrame + 1;
 
 // -- declarations -----
 class ServerSensorView : public ServerDeviceView, public ISensorListener
@@ -59,27 +69,53 @@ public:
 	// Get the current heart rate value in beats per minute. All sensors support this feature.
 	uint16_t getHeartRateBPM() const;
 
+	// Get the number of sensor packets dropped for the given capability because the main thread fell behind
+	bool getCapabilityDroppedPacketCount(HSLSensorCapabilityType cap_type, uint64_t& out_dropped_count) const;
+
 	// Accessors for the various history buffers for heart data and filter streams
-	inline CircularBuffer<HSLHeartRateFrame> *getHeartRateBuffer() const { return heartRateBuffer; }
-	inline CircularBuffer<HSLHeartECGFrame> *getHeartECGBuffer() const { return heartECGBuffer; }
-	inline CircularBuffer<HSLHeartPPGFrame> *getHeartPPGBuffer() const { return heartPPGBuffer; }
-	inline CircularBuffer<HSLHeartPPIFrame> *getHeartPPIBuffer() const { return heartPPIBuffer; }
-	inline CircularBuffer<HSLAccelerometerFrame> *getHeartAccBuffer() const { return heartAccBuffer; }
-	inline CircularBuffer<HSLElectrodermalActivityFrame>* getSkinEDABuffer() const { return skinEDABuffer; }
-	inline CircularBuffer<HSLHeartVariabilityFrame> *getHeartHrvBuffer(HSLHeartRateVariabityFilterType filter) const
+	// Bumped every time the sample rings are given new storage
+	inline uint32_t getSampleBufferLayoutGeneration() const { return m_sampleBufferLayoutGeneration; }
+
+	inline SequencedRingBuffer<HSLHeartRateFrame> *getHeartRateBuffer() const { return heartRateBuffer; }
+	inline SequencedRingBuffer<HSLHeartECGFrame> *getHeartECGBuffer() const { return heartECGBuffer; }
+	inline SequencedRingBuffer<HSLHeartPPGFrame> *getHeartPPGBuffer() const { return heartPPGBuffer; }
+	inline SequencedRingBuffer<HSLHeartPPIFrame> *getHeartPPIBuffer() const { return heartPPIBuffer; }
+	inline SequencedRingBuffer<HSLAccelerometerFrame> *getHeartAccBuffer() const { return heartAccBuffer; }
+	inline SequencedRingBuffer<HSLElectrodermalActivityFrame>* getSkinEDABuffer() const { return skinEDABuffer; }
+	// Waveforms after the sensor's filter bank (left empty when the stream's filter is disabled)
+	inline SequencedRingBuffer<HSLFilteredECGFrame> *getHeartFilteredECGBuffer() const { return heartFilteredECGBuffer; }
+	inline SequencedRingBuffer<HSLFilteredPPGFrame> *getHeartFilteredPPGBuffer() const { return heartFilteredPPGBuffer; }
+	// On-disk history behind the ECG and PPG rings (null when disabled in the SensorManagerConfig)
+	inline SequencedRingBuffer<HSLHeartECGFrame> *getHeartECGHistoryBuffer() const { return heartECGHistory->getBuffer(); }
+	inline SequencedRingBuffer<HSLHeartPPGFrame> *getHeartPPGHistoryBuffer() const { return heartPPGHistory->getBuffer(); }
+	// Compressed alternative to the above (null when disabled in the SensorManagerConfig)
+	inline const CompressedSampleHistory *getHeartECGCompressedHistory() const { return heartECGCompressedHistory->getIsOpen() ? heartECGCompressedHistory : nullptr; }
+	inline const CompressedSampleHistory *getHeartPPGCompressedHistory() const { return heartPPGCompressedHistory->getIsOpen() ? heartPPGCompressedHistory : nullptr; }
+	// Min/max/mean plotting pyramid for a waveform stream (null if the capability doesn't have one)
+	const SamplePyramid *getCapabilitySamplePyramid(HSLSensorCapabilityType cap_type) const;
+	inline SequencedRingBuffer<HSLHeartVariabilityFrame> *getHeartHrvBuffer(HSLHeartRateVariabityFilterType filter) const
 	{
 		return hrvFilters[filter].hrvBuffer;
 	}
 
 	// Incoming device data callbacks
-	void notifySensorDataReceived(const ISensorListener::SensorPacket *sensorPacket) override;
+	void notifySensorDataReceived(const ISensorListener::SensorPacketBatch *sensorBatch) override;
 
 protected:
 	bool allocateDeviceInterface(const class DeviceEnumerator *enumerator) override;
 	void freeDeviceInterface() override;
 
 	void adjustSampleBufferCapacities();
+	void adjustSampleHistoryFiles();
+	void adjustSamplePyramids();
+	void applyPacketOverflowPolicies();
 	void recomputeHeartRateBPM();
+	void addHeartRateVariabilityInterval(double interval_ms, double time_in_seconds);
+	void appendHeartRateFramesToHRV(const HSLHeartRateFrame* frames, size_t frame_count);
+	void appendECGFramesToHRV(const HSLHeartECGFrame* frames, size_t frame_count);
+	void appendPulseIntervalFramesToHRV(const HSLHeartPPIFrame* frames, size_t frame_count);
+	void appendPPGFramesToPulseIntervals(const HSLHeartPPGFrame* frames, size_t frame_count, bool bFeedHRV);
+	void publishHeartRateVariability();
 
 private:
 	// Device State
@@ -87,28 +123,56 @@ private:
 	std::string m_friendlyName;
 	std::string m_devicePath;
 	 
-	// Filter State (IMU Thread)
-	std::chrono::time_point<std::chrono::high_resolution_clock> m_lastSensorDataTimestamp;
-	bool m_bIsLastSensorDataTimestampValid;
-
-	// Filter State (Shared)
-	mutable std::mutex m_sensorPacketWriteMutex;
-	moodycamel::ReaderWriterQueue<ISensorListener::SensorPacket> m_sensorPacketQueue;
+	// Packet Channels (Shared)
+	// One single-producer/single-consumer channel per payload type.
+	// Each payload type only ever comes from one BLE characteristic callback,
+	// so producers never contend with each other and never need a lock.
+	struct SensorPacketChannel
+	{
+		PacketArena *packetArena;
+		PacketHandleQueue *packetQueue;
+		std::atomic<int> overflowPolicy; // SensorPacketOverflowPolicy
+		std::atomic<uint64_t> droppedPacketCount;
+	};
+	std::array<SensorPacketChannel, k_sensor_packet_payload_type_count> m_sensorPacketChannels;
 
 	// Filter State (Main Thread)
-	CircularBuffer<HSLHeartRateFrame> *heartRateBuffer;
-	CircularBuffer<HSLHeartECGFrame> *heartECGBuffer;
-	CircularBuffer<HSLHeartPPGFrame> *heartPPGBuffer;
-	CircularBuffer<HSLHeartPPIFrame> *heartPPIBuffer;
-	CircularBuffer<HSLAccelerometerFrame> *heartAccBuffer;
-	CircularBuffer<HSLElectrodermalActivityFrame>* skinEDABuffer;
+	SequencedRingBuffer<HSLHeartRateFrame> *heartRateBuffer;
+	SequencedRingBuffer<HSLHeartECGFrame> *heartECGBuffer;
+	SequencedRingBuffer<HSLHeartPPGFrame> *heartPPGBuffer;
+	SequencedRingBuffer<HSLFilteredECGFrame> *heartFilteredECGBuffer;
+	SequencedRingBuffer<HSLFilteredPPGFrame> *heartFilteredPPGBuffer;
+	SequencedRingBuffer<HSLHeartPPIFrame> *heartPPIBuffer;
+	SequencedRingBuffer<HSLAccelerometerFrame> *heartAccBuffer;
+	SequencedRingBuffer<HSLElectrodermalActivityFrame>* skinEDABuffer;
+	SampleHistoryFile<HSLHeartECGFrame> *heartECGHistory;
+	SampleHistoryFile<HSLHeartPPGFrame> *heartPPGHistory;
+	CompressedSampleHistory *heartECGCompressedHistory;
+	CompressedSampleHistory *heartPPGCompressedHistory;
+	SamplePyramid *heartECGPyramid;
+	SamplePyramid *heartPPGPyramid;
+	SamplePyramid *heartAccPyramid;
 
 	struct HRVFilterState
 	{
-		CircularBuffer<HSLHeartVariabilityFrame> *hrvBuffer;
+		SequencedRingBuffer<HSLHeartVariabilityFrame> *hrvBuffer;
 	};
 	std::array<HRVFilterState, HRVFilter_COUNT> hrvFilters;
+	HeartRateVariabilityFilter *heartHRVFilter;
+	NNSegmentAggregator *heartNNSegments;
+	HRVSpectrumFilter *heartHRVSpectrum;
+	PPGBeatDetector *heartPPGBeatDetector;
+	QRSDetector *heartQRSDetector;
+	BiquadFilterBank *heartECGFilterBank;
+	BiquadFilterBank *heartPPGFilterBank;
+	bool m_bFilterECG;
+	bool m_bFilterPPG;
+	double m_newestHRVIntervalTime; // Stream time of the newest interval added to the HRV filter
+	bool m_bHasNewHRVIntervals;
+	bool m_bHasNewNNSegment;
+	bool m_bHasNewHRVSpectrum;
 	t_hrv_filter_bitmask m_activeFilterBitmask;
+	uint32_t m_sampleBufferLayoutGeneration;
 
 	std::chrono::time_point<std::chrono::high_resolution_clock> m_lastValidHRTimestamp;
 	uint16_t m_lastValidHR;
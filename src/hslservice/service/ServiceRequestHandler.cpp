@@ -1,5 +1,6 @@
 //-- includes -----
 #include "ServiceRequestHandler.h"
+#include "ClockDomainManager.h"
 
 #include "DeviceManager.h"
 #include "SensorManager.h"
@@ -66,6 +67,11 @@ ServerSensorView *ServiceRequestHandler::getServerSensorView(HSLSensorID sensor_
     return sensor_view;
 }
 
+SampleBufferArena *ServiceRequestHandler::getSampleBufferArena() const
+{
+	return m_deviceManager->getSensorManager()->getSampleBufferArena();
+}
+
 bool ServiceRequestHandler::getSensorList(HSLSensorList *out_sensor_list) const
 {
 	strncpy(out_sensor_list->hostSerial,
@@ -178,6 +184,66 @@ bool ServiceRequestHandler::getCapabilityBitResolution(
 	return false;
 }
 
+bool ServiceRequestHandler::getCapabilityDroppedPacketCount(
+	HSLSensorID sensor_id,
+	HSLSensorCapabilityType cap_type,
+	uint64_t& out_dropped_count)
+{
+	ServerSensorViewPtr sensor_view = m_deviceManager->getSensorViewPtr(sensor_id);
+
+	if (sensor_view && sensor_view->getIsOpen())
+	{
+		return sensor_view->getCapabilityDroppedPacketCount(cap_type, out_dropped_count);
+	}
+
+	return false;
+}
+
+bool ServiceRequestHandler::getSharedTimelineTime(double& out_timeline_time) const
+{
+	const ClockDomainManager* clock_domains = m_deviceManager->getSensorManager()->getClockDomainManager();
+
+	if (clock_domains != nullptr)
+	{
+		out_timeline_time = clock_domains->getTimelineTime();
+		return true;
+	}
+
+	return false;
+}
+
+bool ServiceRequestHandler::getCapabilityTimelineTime(
+	HSLSensorID sensor_id,
+	HSLSensorCapabilityType cap_type,
+	double stream_time,
+	double& out_timeline_time) const
+{
+	const ClockDomainManager* clock_domains = m_deviceManager->getSensorManager()->getClockDomainManager();
+
+	if (clock_domains != nullptr)
+	{
+		return clock_domains->streamTimeToTimeline(sensor_id, cap_type, stream_time, out_timeline_time);
+	}
+
+	return false;
+}
+
+bool ServiceRequestHandler::getCapabilityStreamTime(
+	HSLSensorID sensor_id,
+	HSLSensorCapabilityType cap_type,
+	double timeline_time,
+	double& out_stream_time) const
+{
+	const ClockDomainManager* clock_domains = m_deviceManager->getSensorManager()->getClockDomainManager();
+
+	if (clock_domains != nullptr)
+	{
+		return clock_domains->timelineToStreamTime(sensor_id, cap_type, timeline_time, out_stream_time);
+	}
+
+	return false;
+}
+
 bool ServiceRequestHandler::getServiceVersion(
     char *out_version_string, 
 	size_t max_version_string) const
@@ -28,6 +28,7 @@ public:
 
 	// -- sensor requests -----
 	class ServerSensorView *getServerSensorView(HSLSensorID sensor_id);
+	class SampleBufferArena *getSampleBufferArena() const;
 	bool getSensorList(HSLSensorList *out_sensor_list) const;
 	bool setActiveSensorDataStreams(HSLSensorID sensor_id, t_hsl_caps_bitmask data_stream_flags);
 	t_hsl_caps_bitmask getActiveSensorDataStreams(HSLSensorID sensor_id) const;
@@ -36,6 +37,10 @@ public:
 	bool stopAllActiveSensorStreams(HSLSensorID sensor_id);
 	bool getCapabilitySamplingRate(HSLSensorID sensor_id, HSLSensorCapabilityType cap_type, int& out_sampling_rate);
 	bool getCapabilityBitResolution(HSLSensorID sensor_id, HSLSensorCapabilityType cap_type, int& out_resolution);
+	bool getCapabilityDroppedPacketCount(HSLSensorID sensor_id, HSLSensorCapabilityType cap_type, uint64_t& out_dropped_count);
+	bool getSharedTimelineTime(double& out_timeline_time) const;
+	bool getCapabilityTimelineTime(HSLSensorID sensor_id, HSLSensorCapabilityType cap_type, double stream_time, double& out_timeline_time) const;
+	bool getCapabilityStreamTime(HSLSensorID sensor_id, HSLSensorCapabilityType cap_type, double timeline_time, double& out_stream_time) const;
 
 	// -- general requests -----
 	bool getServiceVersion(char *out_version_string, size_t max_version_string) const;		
@@ -0,0 +1,289 @@
+//-- includes -----
+#include "BiquadFilterBank.h"
+#include "PackedSampleDecoding.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__)
+	#define HSL_HAS_X86_BIQUAD_KERNELS 1
+	#include <immintrin.h>
+
+	#ifdef _MSC_VER
+		#define HSL_TARGET_AVX
+	#else
+		#define HSL_TARGET_AVX __attribute__((target("avx")))
+	#endif
+#else
+	#define HSL_HAS_X86_BIQUAD_KERNELS 0
+#endif
+
+//-- constants -----
+static const double k_pi = 3.14159265358979323846;
+
+enum BiquadCoefficientIndex
+{
+	k_b0 = 0,
+	k_b1,
+	k_b2,
+	k_a1,
+	k_a2
+};
+
+//-- designs -----
+BiquadCoefficients make_biquad_low_pass(double cutoff_hz, double sample_rate, double q)
+{
+	const double w0= 2.0 * k_pi * cutoff_hz / sample_rate;
+	const double cos_w0= cos(w0);
+	const double alpha= sin(w0) / (2.0 * q);
+	const double a0= 1.0 + alpha;
+
+	BiquadCoefficients c;
+	c.b0= ((1.0 - cos_w0) / 2.0) / a0;
+	c.b1= (1.0 - cos_w0) / a0;
+	c.b2= c.b0;
+	c.a1= (-2.0 * cos_w0) / a0;
+	c.a2= (1.0 - alpha) / a0;
+
+	return c;
+}
+
+BiquadCoefficients make_biquad_high_pass(double cutoff_hz, double sample_rate, double q)
+{
+	const double w0= 2.0 * k_pi * cutoff_hz / sample_rate;
+	const double cos_w0= cos(w0);
+	const double alpha= sin(w0) / (2.0 * q);
+	const double a0= 1.0 + alpha;
+
+	BiquadCoefficients c;
+	c.b0= ((1.0 + cos_w0) / 2.0) / a0;
+	c.b1= -(1.0 + cos_w0) / a0;
+	c.b2= c.b0;
+	c.a1= (-2.0 * cos_w0) / a0;
+	c.a2= (1.0 - alpha) / a0;
+
+	return c;
+}
+
+BiquadCoefficients make_biquad_notch(double center_hz, double sample_rate, double q)
+{
+	const double w0= 2.0 * k_pi * center_hz / sample_rate;
+	const double cos_w0= cos(w0);
+	const double alpha= sin(w0) / (2.0 * q);
+	const double a0= 1.0 + alpha;
+
+	BiquadCoefficients c;
+	c.b0= 1.0 / a0;
+	c.b1= (-2.0 * cos_w0) / a0;
+	c.b2= c.b0;
+	c.a1= c.b1;
+	c.a2= (1.0 - alpha) / a0;
+
+	return c;
+}
+
+//-- kernels -----
+// Transposed direct form II, the lanes of one section:
+//   y = b0*x + z1
+//   z1 = b1*x - a1*y + z2
+//   z2 = b2*x - a2*y
+#if !HSL_HAS_X86_BIQUAD_KERNELS
+static void process_section_scalar(
+	const double coefficients[5][BiquadFilterBank::k_lane_count],
+	double state[2][BiquadFilterBank::k_lane_count],
+	double* samples, size_t sample_count)
+{
+	for (int lane = 0; lane < BiquadFilterBank::k_lane_count; ++lane)
+	{
+		const double b0= coefficients[k_b0][lane], b1= coefficients[k_b1][lane], b2= coefficients[k_b2][lane];
+		const double a1= coefficients[k_a1][lane], a2= coefficients[k_a2][lane];
+		double z1= state[0][lane], z2= state[1][lane];
+
+		for (size_t index = 0; index < sample_count; ++index)
+		{
+			double& sample= samples[index * BiquadFilterBank::k_lane_count + lane];
+			const double x= sample;
+			const double y= b0 * x + z1;
+
+			z1= b1 * x - a1 * y + z2;
+			z2= b2 * x - a2 * y;
+			sample= y;
+		}
+
+		state[0][lane]= z1;
+		state[1][lane]= z2;
+	}
+}
+#else
+// SSE2 is part of x86-64, so this is the baseline kernel
+static void process_section_sse2(
+	const double coefficients[5][BiquadFilterBank::k_lane_count],
+	double state[2][BiquadFilterBank::k_lane_count],
+	double* samples, size_t sample_count)
+{
+	// Lanes 0-1 and 2-3 are independent, run them as two interleaved chains
+	const __m128d b0_lo= _mm_loadu_pd(&coefficients[k_b0][0]), b0_hi= _mm_loadu_pd(&coefficients[k_b0][2]);
+	const __m128d b1_lo= _mm_loadu_pd(&coefficients[k_b1][0]), b1_hi= _mm_loadu_pd(&coefficients[k_b1][2]);
+	const __m128d b2_lo= _mm_loadu_pd(&coefficients[k_b2][0]), b2_hi= _mm_loadu_pd(&coefficients[k_b2][2]);
+	const __m128d a1_lo= _mm_loadu_pd(&coefficients[k_a1][0]), a1_hi= _mm_loadu_pd(&coefficients[k_a1][2]);
+	const __m128d a2_lo= _mm_loadu_pd(&coefficients[k_a2][0]), a2_hi= _mm_loadu_pd(&coefficients[k_a2][2]);
+	__m128d z1_lo= _mm_loadu_pd(&state[0][0]), z1_hi= _mm_loadu_pd(&state[0][2]);
+	__m128d z2_lo= _mm_loadu_pd(&state[1][0]), z2_hi= _mm_loadu_pd(&state[1][2]);
+
+	for (size_t index = 0; index < sample_count; ++index)
+	{
+		double* sample= samples + index * BiquadFilterBank::k_lane_count;
+		const __m128d x_lo= _mm_loadu_pd(sample);
+		const __m128d x_hi= _mm_loadu_pd(sample + 2);
+		const __m128d y_lo= _mm_add_pd(_mm_mul_pd(b0_lo, x_lo), z1_lo);
+		const __m128d y_hi= _mm_add_pd(_mm_mul_pd(b0_hi, x_hi), z1_hi);
+
+		z1_lo= _mm_add_pd(_mm_sub_pd(_mm_mul_pd(b1_lo, x_lo), _mm_mul_pd(a1_lo, y_lo)), z2_lo);
+		z1_hi= _mm_add_pd(_mm_sub_pd(_mm_mul_pd(b1_hi, x_hi), _mm_mul_pd(a1_hi, y_hi)), z2_hi);
+		z2_lo= _mm_sub_pd(_mm_mul_pd(b2_lo, x_lo), _mm_mul_pd(a2_lo, y_lo));
+		z2_hi= _mm_sub_pd(_mm_mul_pd(b2_hi, x_hi), _mm_mul_pd(a2_hi, y_hi));
+
+		_mm_storeu_pd(sample, y_lo);
+		_mm_storeu_pd(sample + 2, y_hi);
+	}
+
+	_mm_storeu_pd(&state[0][0], z1_lo);
+	_mm_storeu_pd(&state[0][2], z1_hi);
+	_mm_storeu_pd(&state[1][0], z2_lo);
+	_mm_storeu_pd(&state[1][2], z2_hi);
+}
+
+HSL_TARGET_AVX
+static void process_section_avx(
+	const double coefficients[5][BiquadFilterBank::k_lane_count],
+	double state[2][BiquadFilterBank::k_lane_count],
+	double* samples, size_t sample_count)
+{
+	const __m256d b0= _mm256_loadu_pd(coefficients[k_b0]);
+	const __m256d b1= _mm256_loadu_pd(coefficients[k_b1]);
+	const __m256d b2= _mm256_loadu_pd(coefficients[k_b2]);
+	const __m256d a1= _mm256_loadu_pd(coefficients[k_a1]);
+	const __m256d a2= _mm256_loadu_pd(coefficients[k_a2]);
+	__m256d z1= _mm256_loadu_pd(state[0]);
+	__m256d z2= _mm256_loadu_pd(state[1]);
+
+	for (size_t index = 0; index < sample_count; ++index)
+	{
+		double* sample= samples + index * BiquadFilterBank::k_lane_count;
+		const __m256d x= _mm256_loadu_pd(sample);
+		const __m256d y= _mm256_add_pd(_mm256_mul_pd(b0, x), z1);
+
+		z1= _mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(b1, x), _mm256_mul_pd(a1, y)), z2);
+		z2= _mm256_sub_pd(_mm256_mul_pd(b2, x), _mm256_mul_pd(a2, y));
+
+		_mm256_storeu_pd(sample, y);
+	}
+
+	_mm256_storeu_pd(state[0], z1);
+	_mm256_storeu_pd(state[1], z2);
+
+	// Avoid the AVX to SSE transition penalty in whatever runs next
+	_mm256_zeroupper();
+}
+#endif // HSL_HAS_X86_BIQUAD_KERNELS
+
+typedef void (*t_biquad_section_kernel)(
+	const double coefficients[5][BiquadFilterBank::k_lane_count],
+	double state[2][BiquadFilterBank::k_lane_count],
+	double* samples, size_t sample_count);
+
+static t_biquad_section_kernel get_biquad_section_kernel()
+{
+#if HSL_HAS_X86_BIQUAD_KERNELS
+	// AVX support is already probed (along with the OS saving the YMM registers) for the sample decoders
+	static const t_biquad_section_kernel kernel=
+		(get_packed_sample_decoder() == PackedSampleDecoder::AVX2)
+		? process_section_avx
+		: process_section_sse2;
+
+	return kernel;
+#else
+	return process_section_scalar;
+#endif
+}
+
+//-- public implementation -----
+BiquadFilterBank::BiquadFilterBank()
+	: m_sectionCount(0)
+	, m_bPrimed(false)
+{
+	memset(m_coefficients, 0, sizeof(m_coefficients));
+	memset(m_state, 0, sizeof(m_state));
+}
+
+void BiquadFilterBank::setSections(const BiquadCoefficients* sections, int section_count)
+{
+	m_sectionCount= std::min(std::max(section_count, 0), (int)k_max_sections);
+
+	for (int section_index = 0; section_index < m_sectionCount; ++section_index)
+	{
+		const BiquadCoefficients& section= sections[section_index];
+
+		for (int lane = 0; lane < k_lane_count; ++lane)
+		{
+			m_coefficients[section_index][k_b0][lane]= section.b0;
+			m_coefficients[section_index][k_b1][lane]= section.b1;
+			m_coefficients[section_index][k_b2][lane]= section.b2;
+			m_coefficients[section_index][k_a1][lane]= section.a1;
+			m_coefficients[section_index][k_a2][lane]= section.a2;
+		}
+	}
+
+	reset();
+}
+
+void BiquadFilterBank::reset()
+{
+	memset(m_state, 0, sizeof(m_state));
+	m_bPrimed= false;
+}
+
+void BiquadFilterBank::process(double* samples, size_t sample_count)
+{
+	if (sample_count == 0 || m_sectionCount == 0)
+		return;
+
+	if (!m_bPrimed)
+	{
+		primeState(samples);
+	}
+
+	const t_biquad_section_kernel kernel= get_biquad_section_kernel();
+
+	// A section at a time over the whole block keeps each section's coefficients and state in registers
+	for (int section_index = 0; section_index < m_sectionCount; ++section_index)
+	{
+		kernel(m_coefficients[section_index], m_state[section_index], samples, sample_count);
+	}
+}
+
+//-- private methods -----
+void BiquadFilterBank::primeState(const double* first_sample)
+{
+	for (int lane = 0; lane < k_lane_count; ++lane)
+	{
+		double x= first_sample[lane];
+
+		// State each section would settle into with x held on its input forever
+		for (int section_index = 0; section_index < m_sectionCount; ++section_index)
+		{
+			const double (&c)[5][k_lane_count]= m_coefficients[section_index];
+			const double dc_gain=
+				(c[k_b0][lane] + c[k_b1][lane] + c[k_b2][lane]) / (1.0 + c[k_a1][lane] + c[k_a2][lane]);
+			const double y= dc_gain * x;
+
+			m_state[section_index][0][lane]= y - c[k_b0][lane] * x;
+			m_state[section_index][1][lane]= c[k_b2][lane] * x - c[k_a2][lane] * y;
+
+			x= y;
+		}
+	}
+
+	m_bPrimed= true;
+}
@@ -0,0 +1,56 @@
+#ifndef BIQUAD_FILTER_BANK_H
+#define BIQUAD_FILTER_BANK_H
+
+//-- includes -----
+#include <cstddef>
+
+//-- definitions -----
+// Normalized (a0 = 1) biquad section coefficients
+struct BiquadCoefficients
+{
+	double b0, b1, b2;
+	double a1, a2;
+};
+
+// RBJ cookbook designs (bilinear transform with frequency prewarping)
+BiquadCoefficients make_biquad_low_pass(double cutoff_hz, double sample_rate, double q);
+BiquadCoefficients make_biquad_high_pass(double cutoff_hz, double sample_rate, double q);
+BiquadCoefficients make_biquad_notch(double center_hz, double sample_rate, double q);
+
+// A cascade of biquad sections run over up to k_lane_count channels in lock step,
+// i.e. one ECG lead or the three PPG channels, each channel with its own filter state.
+// Samples are filtered a whole block (one notification batch) at a time and a section at a time,
+// with every channel lane in one AVX register of doubles (or a pair of SSE2 registers).
+// Doubles keep the low corner high-pass sections stable on the large DC offset of the raw PPG counts.
+// The first sample after a reset primes every section to its steady state for that input,
+// so there's no multi-second settling transient from a step onto the DC level.
+class BiquadFilterBank
+{
+public:
+	static const int k_lane_count = 4;
+	static const int k_max_sections = 8;
+
+	BiquadFilterBank();
+
+	// Replace the cascade (extra sections past k_max_sections are ignored), resetting the filter state
+	void setSections(const BiquadCoefficients* sections, int section_count);
+	inline int getSectionCount() const { return m_sectionCount; }
+
+	// Forget the filter state, the next block primes it again
+	void reset();
+
+	// Filter sample_count samples of k_lane_count interleaved lanes in place.
+	// Unused lanes are filtered too and can be left at zero.
+	void process(double* samples, size_t sample_count);
+
+private:
+	void primeState(const double* first_sample);
+
+	// Each coefficient and state value is stored once per lane so the kernels can load them as vectors
+	double m_coefficients[k_max_sections][5][k_lane_count];
+	double m_state[k_max_sections][2][k_lane_count];
+	int m_sectionCount;
+	bool m_bPrimed;
+};
+
+#endif // BIQUAD_FILTER_BANK_H
@@ -0,0 +1,151 @@
+#ifndef BYTE_SPAN_READER_H
+#define BYTE_SPAN_READER_H
+
+//-- includes -----
+#include "PackedSampleDecoding.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+//-- definitions -----
+// Reads little-endian values straight out of a buffer owned by someone else (i.e. a BLE notification payload)
+// without copying it first the way StackBuffer does.
+// Every read is bounds checked: reading past the end returns 0, moves the read position to the end
+// and sets the overrun flag, so a truncated packet can't read into memory it doesn't own.
+// Like StackBuffer this assumes a little-endian host.
+class ByteSpanReader
+{
+public:
+	ByteSpanReader(const uint8_t* data, size_t size)
+		: m_data(data)
+		, m_size(data != nullptr ? size : 0)
+		, m_readPosition(0)
+		, m_bOverrun(false)
+	{
+	}
+
+	inline bool canRead() const { return m_readPosition < m_size; }
+	inline bool canRead(size_t byte_count) const { return getBytesRemaining() >= byte_count; }
+	inline size_t getBytesRemaining() const { return m_size - m_readPosition; }
+	inline size_t getReadPos() const { return m_readPosition; }
+	inline size_t getSize() const { return m_size; }
+	inline const uint8_t* getData() const { return m_data; }
+	inline bool getHasOverrun() const { return m_bOverrun; }
+
+	void skip(size_t byte_count)
+	{
+		consume(byte_count);
+	}
+
+	// Single value reads
+	uint8_t readByte()
+	{
+		return read<uint8_t>();
+	}
+
+	uint16_t readShort()
+	{
+		return read<uint16_t>();
+	}
+
+	int32_t read24BitInt()
+	{
+		const uint8_t* bytes = consume(3);
+		if (bytes == nullptr)
+			return 0;
+
+		const uint32_t raw = (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16);
+
+		return (int32_t)(raw << 8) >> 8;
+	}
+
+	uint32_t readInt()
+	{
+		return read<uint32_t>();
+	}
+
+	uint64_t readLong()
+	{
+		return read<uint64_t>();
+	}
+
+	// Bulk reads.
+	// These read as many whole values as are left (up to max_count) and return how many that was,
+	// a partial value at the end of the span is left unread.
+	size_t readBytes(uint8_t* out_bytes, size_t max_count)
+	{
+		return readArray(out_bytes, max_count);
+	}
+
+	size_t readShorts(uint16_t* out_values, size_t max_count)
+	{
+		return readArray(out_values, max_count);
+	}
+
+	size_t read24BitInts(int32_t* out_values, size_t max_count)
+	{
+		const size_t count = std::min(getBytesRemaining() / 3, max_count);
+
+		unpack_packed_int24_samples(m_data + m_readPosition, out_values, count);
+		m_readPosition += count * 3;
+
+		return count;
+	}
+
+	size_t readLongs(uint64_t* out_values, size_t max_count)
+	{
+		return readArray(out_values, max_count);
+	}
+
+private:
+	const uint8_t* m_data;
+	size_t m_size;
+	size_t m_readPosition;
+	bool m_bOverrun;
+
+	// Returns the bytes to read and advances past them, or nullptr if there aren't enough left
+	const uint8_t* consume(size_t byte_count)
+	{
+		if (byte_count > getBytesRemaining())
+		{
+			m_readPosition = m_size;
+			m_bOverrun = true;
+			return nullptr;
+		}
+
+		const uint8_t* bytes = m_data + m_readPosition;
+		m_readPosition += byte_count;
+
+		return bytes;
+	}
+
+	template<typename T> T read()
+	{
+		T value = 0;
+		const uint8_t* bytes = consume(sizeof(T));
+
+		if (bytes != nullptr)
+		{
+			memcpy(&value, bytes, sizeof(T));
+		}
+
+		return value;
+	}
+
+	template<typename T> size_t readArray(T* out_values, size_t max_count)
+	{
+		const size_t count = std::min(getBytesRemaining() / sizeof(T), max_count);
+
+		if (count > 0)
+		{
+			memcpy(out_values, m_data + m_readPosition, count * sizeof(T));
+			m_readPosition += count * sizeof(T);
+		}
+
+		return count;
+	}
+};
+
+#endif // BYTE_SPAN_READER_H
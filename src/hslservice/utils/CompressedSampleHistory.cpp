@@ -0,0 +1,375 @@
+//-- includes -----
+#include "CompressedSampleHistory.h"
+#include "SampleBlockCodec.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+#include <cstring>
+
+//-- constants -----
+// Full blocks of waveform data are a few hundred bytes, so this is plenty of index entries for the log
+static const size_t k_log_bytes_per_index_entry = 256;
+static const size_t k_max_log_size = 0xffffffff - k_sample_block_read_slack;
+static const size_t k_record_alignment = 8;
+
+//-- private methods -----
+static inline size_t align_record_size(size_t size)
+{
+	return (size + k_record_alignment - 1) & ~(k_record_alignment - 1);
+}
+
+static inline int32_t compute_time_residual_us(double time, double predicted_time)
+{
+	const double residual = std::round((time - predicted_time) * 1000000.0);
+
+	return (int32_t)std::max(std::min(residual, (double)INT32_MAX), (double)INT32_MIN);
+}
+
+//-- public implementation -----
+CompressedSampleHistory::CompressedSampleHistory(size_t channel_count, size_t max_samples_per_frame)
+	: m_channelCount(channel_count)
+	, m_maxSamplesPerFrame(max_samples_per_frame)
+	, m_logSize(0)
+	, m_writeOffset(0)
+	, m_blockIndexStart(0)
+	, m_blockCount(0)
+	, m_pendingFirstSequence(0)
+	, m_pendingFrameCount(0)
+	, m_pendingSampleCount(0)
+	, m_pendingSampleDelta(0.0)
+{
+	const size_t max_block_samples = k_frames_per_block * max_samples_per_frame;
+
+	m_pendingSamples.resize(max_block_samples * channel_count);
+	m_pendingFrameTimes.resize(k_frames_per_block);
+	m_pendingFrameSampleCounts.resize(k_frames_per_block);
+
+	m_encodeBuffer.resize(
+		sizeof(BlockHeader) + k_frames_per_block + 
+		get_max_encoded_sample_block_size(k_frames_per_block) +
+		get_max_encoded_sample_block_size(max_block_samples) * channel_count + 
+		k_record_alignment);
+	m_decodeBuffer.resize(std::max(max_block_samples, (size_t)k_frames_per_block));
+}
+
+CompressedSampleHistory::~CompressedSampleHistory()
+{
+	close();
+}
+
+bool CompressedSampleHistory::open(const std::string &path, size_t size)
+{
+	size = std::min(size, k_max_log_size);
+
+	if (m_file.getIsOpen() && m_file.getPath() == path && m_logSize == size)
+		return true;
+
+	close();
+
+	// Leave room past the end of the log for the decoder's word sized reads
+	if (size < m_encodeBuffer.size() || !m_file.open(path, size + k_sample_block_read_slack))
+		return false;
+
+	m_logSize = size;
+	m_writeOffset = 0;
+	m_blockIndex.resize(std::max(size / k_log_bytes_per_index_entry, (size_t)1));
+	m_blockIndexStart = 0;
+	m_blockCount = 0;
+	m_pendingFrameCount = 0;
+	m_pendingSampleCount = 0;
+
+	return true;
+}
+
+void CompressedSampleHistory::close()
+{
+	m_file.close();
+	m_logSize = 0;
+	m_writeOffset = 0;
+	m_blockIndex.clear();
+	m_blockIndexStart = 0;
+	m_blockCount = 0;
+	m_pendingFrameCount = 0;
+	m_pendingSampleCount = 0;
+}
+
+uint64_t CompressedSampleHistory::getTailSequence() const
+{
+	return (m_blockCount > 0) ? m_blockIndex[m_blockIndexStart].firstSequence : getHeadSequence();
+}
+
+uint64_t CompressedSampleHistory::getHeadSequence() const
+{
+	if (m_blockCount == 0)
+		return 0;
+
+	const BlockIndexEntry& newest = m_blockIndex[(m_blockIndexStart + m_blockCount - 1) % m_blockIndex.size()];
+
+	return newest.firstSequence + newest.frameCount;
+}
+
+void CompressedSampleHistory::appendFrame(
+	uint64_t sequence, 
+	double time, 
+	double time_delta, 
+	const int32_t* samples, 
+	size_t sample_count)
+{
+	if (!m_file.getIsOpen())
+		return;
+
+	sample_count = std::min(sample_count, m_maxSamplesPerFrame);
+
+	// Blocks only hold runs of consecutive frames at a single rate
+	if (m_pendingFrameCount > 0 && 
+		(sequence != m_pendingFirstSequence + m_pendingFrameCount || time_delta != m_pendingSampleDelta))
+	{
+		flushPendingFrames();
+	}
+
+	if (m_pendingFrameCount == 0)
+	{
+		m_pendingFirstSequence = sequence;
+		m_pendingSampleDelta = time_delta;
+	}
+
+	memcpy(
+		&m_pendingSamples[m_pendingSampleCount * m_channelCount], 
+		samples, 
+		sizeof(int32_t) * sample_count * m_channelCount);
+	m_pendingFrameTimes[m_pendingFrameCount] = time;
+	m_pendingFrameSampleCounts[m_pendingFrameCount] = (uint8_t)sample_count;
+	m_pendingSampleCount += sample_count;
+	++m_pendingFrameCount;
+
+	if (m_pendingFrameCount >= k_frames_per_block)
+	{
+		flushPendingFrames();
+	}
+}
+
+size_t CompressedSampleHistory::readSamples(
+	int channel, 
+	uint64_t cursor,
+	float* out_values, 
+	double* out_times, 
+	size_t max_samples,
+	uint64_t& out_next_cursor,
+	uint64_t& out_lost_count) const
+{
+	out_next_cursor = cursor;
+	out_lost_count = 0;
+
+	if (channel < 0 || channel >= (int)m_channelCount || m_blockCount == 0)
+		return 0;
+
+	const uint8_t* log = reinterpret_cast<const uint8_t*>(m_file.getData());
+	size_t block_index = findBlockIndex(cursor);
+	size_t total_sample_count = 0;
+
+	for (; block_index < m_blockCount; ++block_index)
+	{
+		const BlockIndexEntry& entry = m_blockIndex[(m_blockIndexStart + block_index) % m_blockIndex.size()];
+
+		// Skip forward over any gap between blocks
+		if (cursor < entry.firstSequence)
+		{
+			out_lost_count += entry.firstSequence - cursor;
+			cursor = entry.firstSequence;
+		}
+
+		const uint8_t* record = log + entry.offset;
+		BlockHeader header;
+		memcpy(&header, record, sizeof(BlockHeader));
+
+		const uint8_t* frame_sample_counts = record + sizeof(BlockHeader);
+		const uint8_t* encoded = frame_sample_counts + header.frameCount;
+
+		// Frame time residuals come first, then each channel in turn
+		int32_t frame_residuals[k_frames_per_block];
+		encoded += decode_sample_block(encoded, header.frameCount, frame_residuals);
+		for (int channel_index = 0; channel_index < channel; ++channel_index)
+		{
+			encoded += get_encoded_sample_block_size(encoded, header.sampleCount);
+		}
+
+		// Work out where the first wanted frame starts before decoding anything we don't need
+		const size_t first_frame = (size_t)(cursor - header.firstSequence);
+		size_t sample_offset = 0;
+		for (size_t frame_index = 0; frame_index < first_frame; ++frame_index)
+		{
+			sample_offset += frame_sample_counts[frame_index];
+		}
+
+		if (total_sample_count + frame_sample_counts[first_frame] > max_samples)
+			break;
+
+		int32_t* channel_samples = m_decodeBuffer.data();
+		decode_sample_block(encoded, header.sampleCount, channel_samples);
+
+		bool bOutOfRoom = false;
+		for (size_t frame_index = first_frame; frame_index < header.frameCount; ++frame_index)
+		{
+			const size_t frame_sample_count = frame_sample_counts[frame_index];
+
+			if (total_sample_count + frame_sample_count > max_samples)
+			{
+				bOutOfRoom = true;
+				break;
+			}
+
+			for (size_t sample_index = 0; sample_index < frame_sample_count; ++sample_index)
+			{
+				out_values[total_sample_count + sample_index] = (float)channel_samples[sample_offset + sample_index];
+			}
+
+			if (out_times != nullptr)
+			{
+				const double frame_time = 
+					header.firstTime + (double)sample_offset * header.sampleDelta + 
+					(double)frame_residuals[frame_index] * 0.000001;
+
+				for (size_t sample_index = 0; sample_index < frame_sample_count; ++sample_index)
+				{
+					out_times[total_sample_count + sample_index] = frame_time + (double)sample_index * header.sampleDelta;
+				}
+			}
+
+			sample_offset += frame_sample_count;
+			total_sample_count += frame_sample_count;
+			++cursor;
+		}
+
+		if (bOutOfRoom)
+			break;
+	}
+
+	out_next_cursor = cursor;
+
+	return total_sample_count;
+}
+
+//-- private methods -----
+void CompressedSampleHistory::flushPendingFrames()
+{
+	if (m_pendingFrameCount == 0)
+		return;
+
+	uint8_t* record = m_encodeBuffer.data();
+	uint8_t* write_ptr = record + sizeof(BlockHeader);
+
+	// Per frame sample counts
+	memcpy(write_ptr, m_pendingFrameSampleCounts.data(), m_pendingFrameCount);
+	write_ptr += m_pendingFrameCount;
+
+	// Frame times relative to where a steady sample rate would put them
+	int32_t frame_residuals[k_frames_per_block];
+	size_t sample_offset = 0;
+	for (size_t frame_index = 0; frame_index < m_pendingFrameCount; ++frame_index)
+	{
+		const double predicted_time = m_pendingFrameTimes[0] + (double)sample_offset * m_pendingSampleDelta;
+
+		frame_residuals[frame_index] = compute_time_residual_us(m_pendingFrameTimes[frame_index], predicted_time);
+		sample_offset += m_pendingFrameSampleCounts[frame_index];
+	}
+	write_ptr += encode_sample_block(frame_residuals, 1, m_pendingFrameCount, write_ptr);
+
+	// Each channel is encoded on its own so neighboring values are from the same signal
+	for (size_t channel_index = 0; channel_index < m_channelCount; ++channel_index)
+	{
+		write_ptr += encode_sample_block(&m_pendingSamples[channel_index], m_channelCount, m_pendingSampleCount, write_ptr);
+	}
+
+	BlockHeader header;
+	header.firstSequence = m_pendingFirstSequence;
+	header.firstTime = m_pendingFrameTimes[0];
+	header.sampleDelta = m_pendingSampleDelta;
+	header.recordSize = (uint32_t)align_record_size((size_t)(write_ptr - record));
+	header.frameCount = (uint16_t)m_pendingFrameCount;
+	header.sampleCount = (uint16_t)m_pendingSampleCount;
+	memcpy(record, &header, sizeof(BlockHeader));
+
+	writeBlock(record, header.recordSize);
+
+	m_pendingFrameCount = 0;
+	m_pendingSampleCount = 0;
+}
+
+void CompressedSampleHistory::writeBlock(const uint8_t* record, size_t record_size)
+{
+	assert(record_size <= m_logSize);
+
+	// Wrap around to the start of the log, the blocks left past the write offset are the oldest ones
+	if (m_writeOffset + record_size > m_logSize)
+	{
+		while (m_blockCount > 0 && m_blockIndex[m_blockIndexStart].offset >= m_writeOffset)
+		{
+			evictOldestBlock();
+		}
+
+		m_writeOffset = 0;
+	}
+
+	// Drop the blocks about to be overwritten
+	while (m_blockCount > 0)
+	{
+		const BlockIndexEntry& oldest = m_blockIndex[m_blockIndexStart];
+
+		if (oldest.offset >= m_writeOffset + record_size || oldest.offset + oldest.recordSize <= m_writeOffset)
+			break;
+
+		evictOldestBlock();
+	}
+
+	if (m_blockCount == m_blockIndex.size())
+	{
+		evictOldestBlock();
+	}
+
+	memcpy(reinterpret_cast<uint8_t*>(m_file.getData()) + m_writeOffset, record, record_size);
+
+	BlockHeader header;
+	memcpy(&header, record, sizeof(BlockHeader));
+
+	BlockIndexEntry& entry = m_blockIndex[(m_blockIndexStart + m_blockCount) % m_blockIndex.size()];
+	entry.firstSequence = header.firstSequence;
+	entry.frameCount = header.frameCount;
+	entry.offset = (uint32_t)m_writeOffset;
+	entry.recordSize = (uint32_t)record_size;
+	++m_blockCount;
+
+	m_writeOffset += record_size;
+}
+
+void CompressedSampleHistory::evictOldestBlock()
+{
+	assert(m_blockCount > 0);
+
+	m_blockIndexStart = (m_blockIndexStart + 1) % m_blockIndex.size();
+	--m_blockCount;
+}
+
+// Position (from the oldest block) of the block holding the sequence or the first block after it
+size_t CompressedSampleHistory::findBlockIndex(uint64_t sequence) const
+{
+	size_t low = 0;
+	size_t high = m_blockCount;
+
+	while (low < high)
+	{
+		const size_t mid = low + (high - low) / 2;
+		const BlockIndexEntry& entry = m_blockIndex[(m_blockIndexStart + mid) % m_blockIndex.size()];
+
+		if (entry.firstSequence + entry.frameCount <= sequence)
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+
+	return low;
+}
@@ -0,0 +1,104 @@
+#ifndef COMPRESSED_SAMPLE_HISTORY_H
+#define COMPRESSED_SAMPLE_HISTORY_H
+
+//-- includes -----
+#include "MemoryMappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//-- definitions -----
+// Long term history of a multi-channel waveform stream (i.e. ECG or PPG) kept as compressed blocks.
+// Frames are gathered into blocks of k_frames_per_block and each channel of a block is stored
+// with the delta + bit-packing codec in SampleBlockCodec.h. Blocks are written into a circular log
+// in a memory mapped file, oldest blocks are dropped as the log wraps around.
+// Frames keep the sequence numbers of the in-memory ring they came from, so readers can move
+// between the history and the ring with the same stream cursor.
+// Frame times are kept to the microsecond and every frame in a block shares the block's sample delta.
+// Appending and reading must happen on the same thread.
+class CompressedSampleHistory
+{
+public:
+	static const size_t k_frames_per_block = 32;
+
+	CompressedSampleHistory(size_t channel_count, size_t max_samples_per_frame);
+	virtual ~CompressedSampleHistory();
+
+	// Map a history file of the given size, dropping any history collected so far.
+	// Reopening the same file at the same size keeps the history instead.
+	bool open(const std::string &path, size_t size);
+	void close();
+
+	inline bool getIsOpen() const { return m_file.getIsOpen(); }
+	inline size_t getChannelCount() const { return m_channelCount; }
+
+	// Sequence number of the oldest frame still in the history
+	uint64_t getTailSequence() const;
+	// Sequence number after the newest frame that has been compressed into a block
+	uint64_t getHeadSequence() const;
+
+	// Add a frame of sample_count samples, interleaved channel_count values per sample.
+	// Frames are buffered until a full block can be compressed.
+	void appendFrame(uint64_t sequence, double time, double time_delta, const int32_t* samples, size_t sample_count);
+
+	// Decode whole frames of one channel starting at the cursor, until max_samples would be exceeded
+	// or the compressed frames run out. Returns the number of samples written.
+	size_t readSamples(
+		int channel, uint64_t cursor, 
+		float* out_values, double* out_times, size_t max_samples, 
+		uint64_t& out_next_cursor, uint64_t& out_lost_count) const;
+
+protected:
+	struct BlockHeader
+	{
+		uint64_t firstSequence;
+		double firstTime;
+		double sampleDelta;
+		uint32_t recordSize;	// Including this header
+		uint16_t frameCount;
+		uint16_t sampleCount;
+	};
+
+	struct BlockIndexEntry
+	{
+		uint64_t firstSequence;
+		uint32_t frameCount;
+		uint32_t offset;
+		uint32_t recordSize;
+	};
+
+	void flushPendingFrames();
+	void writeBlock(const uint8_t* record, size_t record_size);
+	void evictOldestBlock();
+	size_t findBlockIndex(uint64_t sequence) const;
+
+	size_t m_channelCount;
+	size_t m_maxSamplesPerFrame;
+
+	// Log storage
+	MemoryMappedFile m_file;
+	size_t m_logSize;
+	size_t m_writeOffset;
+
+	// Fixed capacity ring of the blocks currently in the log, oldest first
+	std::vector<BlockIndexEntry> m_blockIndex;
+	size_t m_blockIndexStart;
+	size_t m_blockCount;
+
+	// Frames waiting to be compressed into the next block
+	uint64_t m_pendingFirstSequence;
+	size_t m_pendingFrameCount;
+	size_t m_pendingSampleCount;
+	std::vector<int32_t> m_pendingSamples;	// Interleaved channel values
+	std::vector<double> m_pendingFrameTimes;
+	std::vector<uint8_t> m_pendingFrameSampleCounts;
+	double m_pendingSampleDelta;
+
+	// Scratch space for encoding and decoding a block
+	std::vector<uint8_t> m_encodeBuffer;
+	mutable std::vector<int32_t> m_decodeBuffer;
+};
+
+#endif // COMPRESSED_SAMPLE_HISTORY_H
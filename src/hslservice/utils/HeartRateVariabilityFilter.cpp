@@ -0,0 +1,536 @@
+//-- includes -----
+#include "HeartRateVariabilityFilter.h"
+
+#include <algorithm>
+#include <cmath>
+
+//-- constants -----
+// Intervals outside of 30-200 BPM are artifacts (missed or extra beats) rather than NN intervals
+static const int64_t k_min_nn_interval_microseconds = 300000;
+static const int64_t k_max_nn_interval_microseconds = 2000000;
+
+static const int64_t k_nn50_threshold_microseconds = 50000;
+static const int64_t k_nn20_threshold_microseconds = 20000;
+
+// Longest window supported, bounds the ring size (and keeps the squared sums far from overflowing)
+static const double k_max_window_seconds = 3600.0;
+
+// Fewest successive differences a standard deviation is reported from
+static const size_t k_min_difference_count = 2;
+
+// Fraction of a segment that has to be covered by accepted beats for its mean to count towards SDANN
+static const double k_min_segment_coverage = 0.5;
+
+static const double k_pi = 3.14159265358979323846;
+
+// Center of the first spectrum bin and the bin width, the bins tile 0.04-0.4Hz with the LF/HF split at 0.15Hz
+static const double k_spectrum_bin_width_hz = 0.0025;
+static const double k_spectrum_first_bin_hz = 0.04 + 0.5 * k_spectrum_bin_width_hz;
+
+// Beats between re-evaluations of the band powers
+static const int k_spectrum_update_beats = 4;
+
+// Beats added between rebuilds of the running spectrum sums
+static const size_t k_spectrum_rebuild_sample_count = 1024;
+
+// The window has to hold this many beats spanning this fraction of its duration before the band powers are reported
+static const size_t k_min_spectrum_sample_count = 32;
+static const double k_min_spectrum_coverage = 0.5;
+
+// Furthest the running sum of intervals can wander from the stream time before the beat times are resynced
+static const double k_max_beat_time_drift_seconds = 3.0;
+
+//-- public implementation -----
+HeartRateVariabilityFilter::HeartRateVariabilityFilter()
+	: m_oldestIndex(0)
+	, m_intervalCount(0)
+	, m_windowMicroseconds(0)
+	, m_intervalSum(0)
+	, m_differenceSum(0)
+	, m_differenceSquaredSum(0)
+	, m_differenceCount(0)
+	, m_nn50Count(0)
+	, m_nn20Count(0)
+	, m_bNextIntervalContinues(false)
+{
+	setWindowDuration(60.0);
+}
+
+void HeartRateVariabilityFilter::setWindowDuration(double window_seconds)
+{
+	window_seconds= std::min(std::max(window_seconds, 1.0), k_max_window_seconds);
+	m_windowMicroseconds= (int64_t)(window_seconds * 1000000.0);
+
+	// Every interval in the window is at least the minimum NN interval long
+	const size_t capacity= (size_t)(m_windowMicroseconds / k_min_nn_interval_microseconds) + 2;
+	m_intervals.resize(capacity);
+
+	reset();
+}
+
+void HeartRateVariabilityFilter::reset()
+{
+	m_oldestIndex= 0;
+	m_intervalCount= 0;
+	m_intervalSum= 0;
+	m_differenceSum= 0;
+	m_differenceSquaredSum= 0;
+	m_differenceCount= 0;
+	m_nn50Count= 0;
+	m_nn20Count= 0;
+	m_bNextIntervalContinues= false;
+}
+
+bool HeartRateVariabilityFilter::addInterval(double interval_milliseconds)
+{
+	const int64_t interval= (int64_t)llround(interval_milliseconds * 1000.0);
+
+	if (interval < k_min_nn_interval_microseconds || interval > k_max_nn_interval_microseconds)
+	{
+		markDiscontinuity();
+		return false;
+	}
+
+	if (m_intervalCount >= m_intervals.size())
+	{
+		evictOldestInterval();
+	}
+
+	const size_t capacity= m_intervals.size();
+	const size_t newest_index= (m_oldestIndex + m_intervalCount + capacity - 1) % capacity;
+	NNInterval& nn_interval= m_intervals[(m_oldestIndex + m_intervalCount) % capacity];
+
+	nn_interval.intervalMicroseconds= interval;
+	nn_interval.differenceMicroseconds= 0;
+	nn_interval.bHasDifference= m_bNextIntervalContinues && m_intervalCount > 0;
+
+	if (nn_interval.bHasDifference)
+	{
+		nn_interval.differenceMicroseconds= interval - m_intervals[newest_index].intervalMicroseconds;
+		addDifference(nn_interval.differenceMicroseconds);
+	}
+
+	m_intervalCount++;
+	m_intervalSum+= interval;
+	m_bNextIntervalContinues= true;
+
+	// Slide the window forward to the newest window duration worth of beats
+	while (m_intervalCount > 1 && m_intervalSum > m_windowMicroseconds)
+	{
+		evictOldestInterval();
+	}
+
+	return true;
+}
+
+void HeartRateVariabilityFilter::markDiscontinuity()
+{
+	m_bNextIntervalContinues= false;
+}
+
+bool HeartRateVariabilityFilter::getFilterValue(HSLHeartRateVariabityFilterType filter, float& out_value) const
+{
+	if (m_differenceCount < k_min_difference_count)
+		return false;
+
+	const double difference_count= (double)m_differenceCount;
+
+	switch (filter)
+	{
+	case HRVFilter_RMSSD:
+		{
+			const double mean_squared= (double)m_differenceSquaredSum / difference_count;
+
+			out_value= (float)(sqrt(mean_squared) / 1000.0);
+		}
+		return true;
+	case HRVFilter_SDSD:
+		{
+			const double sum= (double)m_differenceSum;
+			const double variance=
+				std::max(((double)m_differenceSquaredSum - sum * sum / difference_count) / (difference_count - 1.0), 0.0);
+
+			out_value= (float)(sqrt(variance) / 1000.0);
+		}
+		return true;
+	case HRVFilter_NN50:
+		out_value= (float)m_nn50Count;
+		return true;
+	case HRVFilter_pNN50:
+		out_value= (float)(100.0 * (double)m_nn50Count / difference_count);
+		return true;
+	case HRVFilter_NN20:
+		out_value= (float)m_nn20Count;
+		return true;
+	case HRVFilter_pNN20:
+		out_value= (float)(100.0 * (double)m_nn20Count / difference_count);
+		return true;
+	default:
+		return false;
+	}
+}
+
+//-- private methods -----
+void HeartRateVariabilityFilter::addDifference(int64_t difference)
+{
+	const int64_t magnitude= difference < 0 ? -difference : difference;
+
+	m_differenceSum+= difference;
+	m_differenceSquaredSum+= difference * difference;
+	m_differenceCount++;
+	if (magnitude > k_nn50_threshold_microseconds) m_nn50Count++;
+	if (magnitude > k_nn20_threshold_microseconds) m_nn20Count++;
+}
+
+void HeartRateVariabilityFilter::removeDifference(int64_t difference)
+{
+	const int64_t magnitude= difference < 0 ? -difference : difference;
+
+	m_differenceSum-= difference;
+	m_differenceSquaredSum-= difference * difference;
+	m_differenceCount--;
+	if (magnitude > k_nn50_threshold_microseconds) m_nn50Count--;
+	if (magnitude > k_nn20_threshold_microseconds) m_nn20Count--;
+}
+
+void HeartRateVariabilityFilter::evictOldestInterval()
+{
+	const size_t capacity= m_intervals.size();
+	const NNInterval& oldest= m_intervals[m_oldestIndex];
+
+	m_intervalSum-= oldest.intervalMicroseconds;
+	m_oldestIndex= (m_oldestIndex + 1) % capacity;
+	m_intervalCount--;
+
+	// The oldest interval never has a difference in the window,
+	// so the one after it loses the difference it formed with the evicted interval
+	if (m_intervalCount > 0)
+	{
+		NNInterval& next= m_intervals[m_oldestIndex];
+
+		if (next.bHasDifference)
+		{
+			removeDifference(next.differenceMicroseconds);
+			next.bHasDifference= false;
+		}
+	}
+	else
+	{
+		m_bNextIntervalContinues= false;
+	}
+}
+
+//-- NNSegmentAggregator -----
+NNSegmentAggregator::NNSegmentAggregator()
+	: m_segmentDuration(300.0)
+{
+	reset();
+}
+
+void NNSegmentAggregator::setSegmentDuration(double segment_seconds)
+{
+	m_segmentDuration= std::max(segment_seconds, 1.0);
+	reset();
+}
+
+void NNSegmentAggregator::reset()
+{
+	m_segmentStartTime= 0.0;
+	m_bHasSegment= false;
+	m_segmentIntervalSum= 0;
+	m_segmentIntervalCount= 0;
+	m_segmentCount= 0;
+	m_segmentMeanAverage= 0.0;
+	m_segmentMeanM2= 0.0;
+}
+
+bool NNSegmentAggregator::addInterval(double interval_milliseconds, double time_in_seconds)
+{
+	bool bClosedSegment= false;
+
+	if (!m_bHasSegment || time_in_seconds < m_segmentStartTime)
+	{
+		// First beat or the stream restarted: the partial segment can't be trusted
+		m_segmentStartTime= time_in_seconds;
+		m_segmentIntervalSum= 0;
+		m_segmentIntervalCount= 0;
+		m_bHasSegment= true;
+	}
+	else if (time_in_seconds >= m_segmentStartTime + m_segmentDuration)
+	{
+		bClosedSegment= closeSegment();
+
+		// Skip over any whole segments without beats (i.e. the sensor lost contact for a while)
+		const double elapsed_segments= floor((time_in_seconds - m_segmentStartTime) / m_segmentDuration);
+		m_segmentStartTime+= elapsed_segments * m_segmentDuration;
+	}
+
+	m_segmentIntervalSum+= (int64_t)llround(interval_milliseconds * 1000.0);
+	m_segmentIntervalCount++;
+
+	return bClosedSegment;
+}
+
+bool NNSegmentAggregator::getSDANN(float& out_value) const
+{
+	if (m_segmentCount < 2)
+		return false;
+
+	out_value= (float)sqrt(m_segmentMeanM2 / (double)(m_segmentCount - 1));
+	return true;
+}
+
+bool NNSegmentAggregator::closeSegment()
+{
+	const int64_t segment_sum= m_segmentIntervalSum;
+	const size_t segment_count= m_segmentIntervalCount;
+
+	m_segmentIntervalSum= 0;
+	m_segmentIntervalCount= 0;
+
+	if (segment_count == 0 ||
+		(double)segment_sum < k_min_segment_coverage * m_segmentDuration * 1000000.0)
+	{
+		return false;
+	}
+
+	const double segment_mean= (double)segment_sum / (double)segment_count / 1000.0;
+
+	m_segmentCount++;
+	const double delta= segment_mean - m_segmentMeanAverage;
+	m_segmentMeanAverage+= delta / (double)m_segmentCount;
+	m_segmentMeanM2+= delta * (segment_mean - m_segmentMeanAverage);
+
+	return true;
+}
+
+//-- HRVSpectrumFilter -----
+HRVSpectrumFilter::HRVSpectrumFilter()
+{
+	setWindowDuration(300.0);
+}
+
+void HRVSpectrumFilter::setWindowDuration(double window_seconds)
+{
+	m_windowDuration= std::min(std::max(window_seconds, 1.0), k_max_window_seconds);
+
+	// Every interval in the window is at least the minimum NN interval long
+	const size_t capacity= (size_t)(m_windowDuration * 1000000.0 / (double)k_min_nn_interval_microseconds) + 2;
+	m_samples.resize(capacity);
+
+	reset();
+}
+
+void HRVSpectrumFilter::reset()
+{
+	m_oldestIndex= 0;
+	m_sampleCount= 0;
+	m_frequencySums.fill(FrequencySums());
+	m_intervalSum= 0.0;
+	m_referenceTime= 0.0;
+	m_samplesSinceRebuild= 0;
+	m_lastBeatTime= 0.0;
+	m_bHasLastBeat= false;
+	m_beatsSinceEvaluation= 0;
+	m_lfPower= 0.f;
+	m_hfPower= 0.f;
+	m_bHasBandPowers= false;
+}
+
+bool HRVSpectrumFilter::addInterval(double interval_milliseconds, double time_in_seconds)
+{
+	// Intervals from the same notification share a timestamp,
+	// so place each beat an interval after the last one while that stays close to the stream time
+	double beat_time= time_in_seconds;
+
+	if (m_bHasLastBeat)
+	{
+		const double predicted_time= m_lastBeatTime + interval_milliseconds / 1000.0;
+
+		if (time_in_seconds < m_lastBeatTime - k_max_beat_time_drift_seconds)
+		{
+			// The stream restarted, the window can't be trusted
+			reset();
+		}
+		else if (fabs(predicted_time - time_in_seconds) <= k_max_beat_time_drift_seconds)
+		{
+			beat_time= predicted_time;
+		}
+		else if (time_in_seconds <= m_lastBeatTime)
+		{
+			return false;
+		}
+	}
+
+	// Slide the window forward to the newest window duration worth of beats
+	while (m_sampleCount > 0 &&
+		   (m_sampleCount >= m_samples.size() ||
+			m_samples[m_oldestIndex].timeInSeconds <= beat_time - m_windowDuration))
+	{
+		evictOldestSample();
+	}
+
+	if (m_sampleCount == 0)
+	{
+		// Start the sums over clean, phased from this beat
+		rebuildSums();
+		m_referenceTime= beat_time;
+	}
+
+	NNSample& sample= m_samples[(m_oldestIndex + m_sampleCount) % m_samples.size()];
+	sample.timeInSeconds= beat_time;
+	sample.intervalMilliseconds= interval_milliseconds;
+	m_sampleCount++;
+	m_lastBeatTime= beat_time;
+	m_bHasLastBeat= true;
+
+	accumulateSample(sample, 1.0);
+
+	if (++m_samplesSinceRebuild >= k_spectrum_rebuild_sample_count)
+	{
+		rebuildSums();
+	}
+
+	if (++m_beatsSinceEvaluation >= k_spectrum_update_beats)
+	{
+		m_beatsSinceEvaluation= 0;
+		evaluateBandPowers();
+
+		return true;
+	}
+
+	return false;
+}
+
+bool HRVSpectrumFilter::getFilterValue(HSLHeartRateVariabityFilterType filter, float& out_value) const
+{
+	if (!m_bHasBandPowers)
+		return false;
+
+	switch (filter)
+	{
+	case HRVFilter_LFPower:
+		out_value= m_lfPower;
+		return true;
+	case HRVFilter_HFPower:
+		out_value= m_hfPower;
+		return true;
+	case HRVFilter_LFHFRatio:
+		if (m_hfPower <= 0.f)
+			return false;
+		out_value= m_lfPower / m_hfPower;
+		return true;
+	default:
+		return false;
+	}
+}
+
+void HRVSpectrumFilter::accumulateSample(const NNSample& sample, double weight)
+{
+	const double t= sample.timeInSeconds - m_referenceTime;
+	const double y= sample.intervalMilliseconds;
+
+	// Step the phase from one bin to the next with a rotation instead of evaluating sin/cos per bin
+	double c= cos(2.0 * k_pi * k_spectrum_first_bin_hz * t);
+	double s= sin(2.0 * k_pi * k_spectrum_first_bin_hz * t);
+	const double step_c= cos(2.0 * k_pi * k_spectrum_bin_width_hz * t);
+	const double step_s= sin(2.0 * k_pi * k_spectrum_bin_width_hz * t);
+
+	for (int bin_index = 0; bin_index < k_frequency_bin_count; ++bin_index)
+	{
+		FrequencySums& sums= m_frequencySums[bin_index];
+
+		sums.yCos+= weight * y * c;
+		sums.ySin+= weight * y * s;
+		sums.cos+= weight * c;
+		sums.sin+= weight * s;
+		sums.cos2+= weight * (2.0 * c * c - 1.0);
+		sums.sin2+= weight * (2.0 * s * c);
+
+		const double next_c= c * step_c - s * step_s;
+		s= s * step_c + c * step_s;
+		c= next_c;
+	}
+
+	m_intervalSum+= weight * y;
+}
+
+void HRVSpectrumFilter::evictOldestSample()
+{
+	accumulateSample(m_samples[m_oldestIndex], -1.0);
+
+	m_oldestIndex= (m_oldestIndex + 1) % m_samples.size();
+	m_sampleCount--;
+}
+
+void HRVSpectrumFilter::rebuildSums()
+{
+	m_frequencySums.fill(FrequencySums());
+	m_intervalSum= 0.0;
+	m_samplesSinceRebuild= 0;
+
+	if (m_sampleCount == 0)
+		return;
+
+	m_referenceTime= m_samples[m_oldestIndex].timeInSeconds;
+
+	for (size_t offset = 0; offset < m_sampleCount; ++offset)
+	{
+		accumulateSample(m_samples[(m_oldestIndex + offset) % m_samples.size()], 1.0);
+	}
+}
+
+void HRVSpectrumFilter::evaluateBandPowers()
+{
+	const NNSample& oldest= m_samples[m_oldestIndex];
+	const double covered_seconds= m_lastBeatTime - oldest.timeInSeconds + oldest.intervalMilliseconds / 1000.0;
+
+	m_bHasBandPowers=
+		m_sampleCount >= k_min_spectrum_sample_count &&
+		covered_seconds >= k_min_spectrum_coverage * m_windowDuration;
+	if (!m_bHasBandPowers)
+		return;
+
+	const double n= (double)m_sampleCount;
+	const double mean= m_intervalSum / n;
+
+	// Lomb-Scargle power P(w) = 1/2 [ (sum y cos w(t-tau))^2 / sum cos^2 w(t-tau) + (sum y sin w(t-tau))^2 / sum sin^2 w(t-tau) ]
+	// with the mean removed from y and tau chosen so tan(2 w tau) = sum sin(2wt) / sum cos(2wt).
+	// Everything expands into the running sums, without needing tau itself.
+	// 2 * P * (mean sample period) is the one sided PSD in ms^2/Hz (it matches the periodogram for even sampling).
+	const double psd_scale= 2.0 * mean / 1000.0;
+	double lf_power= 0.0;
+	double hf_power= 0.0;
+
+	for (int bin_index = 0; bin_index < k_frequency_bin_count; ++bin_index)
+	{
+		const FrequencySums& sums= m_frequencySums[bin_index];
+		const double a= sums.yCos - mean * sums.cos;
+		const double b= sums.ySin - mean * sums.sin;
+		const double r= sqrt(sums.cos2 * sums.cos2 + sums.sin2 * sums.sin2);
+		const double cos_2tau= r > 0.0 ? sums.cos2 / r : 1.0;
+		const double sin_2tau= r > 0.0 ? sums.sin2 / r : 0.0;
+
+		const double ab_squared= a * a + b * b;
+		const double yc_squared= std::max(0.5 * (ab_squared + (a * a - b * b) * cos_2tau) + a * b * sin_2tau, 0.0);
+		const double ys_squared= std::max(ab_squared - yc_squared, 0.0);
+		const double cc= 0.5 * (n + r);
+		const double ss= 0.5 * (n - r);
+
+		double power= yc_squared / cc;
+		if (ss > 1e-9 * n)
+		{
+			power+= ys_squared / ss;
+		}
+		power*= 0.5;
+
+		const double band_power= power * psd_scale * k_spectrum_bin_width_hz;
+		if (bin_index < k_lf_bin_count)
+			lf_power+= band_power;
+		else
+			hf_power+= band_power;
+	}
+
+	m_lfPower= (float)lf_power;
+	m_hfPower= (float)hf_power;
+}
@@ -0,0 +1,188 @@
+#ifndef HEART_RATE_VARIABILITY_FILTER_H
+#define HEART_RATE_VARIABILITY_FILTER_H
+
+//-- includes -----
+#include "HSLClient_CAPI.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//-- definitions -----
+// Sliding window time domain HRV statistics (RMSSD, SDSD, NN50, pNN50, NN20, pNN20)
+// over a stream of NN (normal to normal beat) intervals.
+// Every statistic is kept as running sums and counters over the successive differences in the window,
+// so adding an interval (and evicting the ones that slid out of the window) is O(1) however long the window is.
+// Intervals are kept in integer microseconds so adding and later subtracting the same
+// difference cancels exactly and the sums don't drift over long sessions.
+// Intervals outside a plausible heart rate range are treated as artifacts and dropped,
+// and the intervals on either side of a dropped one don't form a successive difference.
+class HeartRateVariabilityFilter
+{
+public:
+	HeartRateVariabilityFilter();
+
+	// Size the window in seconds of beats, dropping every interval in it
+	void setWindowDuration(double window_seconds);
+	void reset();
+
+	// Add the next beat to beat interval.
+	// Returns false if it was rejected as an artifact.
+	bool addInterval(double interval_milliseconds);
+
+	// The next interval doesn't directly follow the last one (i.e. a beat was missed)
+	void markDiscontinuity();
+
+	inline size_t getIntervalCount() const { return m_intervalCount; }
+	inline size_t getDifferenceCount() const { return m_differenceCount; }
+
+	// Current value of a filter over the window:
+	//   RMSSD, SDSD - milliseconds
+	//   NN50, NN20 - count of successive differences over the threshold
+	//   pNN50, pNN20 - percent of successive differences over the threshold
+	// Returns false for filters not computed here or until the window holds enough successive differences.
+	bool getFilterValue(HSLHeartRateVariabityFilterType filter, float& out_value) const;
+
+private:
+	struct NNInterval
+	{
+		int64_t intervalMicroseconds;
+		int64_t differenceMicroseconds; // From the previous interval in the window
+		bool bHasDifference;
+	};
+
+	void addDifference(int64_t difference);
+	void removeDifference(int64_t difference);
+	void evictOldestInterval();
+
+	std::vector<NNInterval> m_intervals; // Ring of the intervals in the window
+	size_t m_oldestIndex;
+	size_t m_intervalCount;
+	int64_t m_windowMicroseconds;
+	int64_t m_intervalSum;
+
+	int64_t m_differenceSum;
+	int64_t m_differenceSquaredSum;
+	size_t m_differenceCount;
+	size_t m_nn50Count;
+	size_t m_nn20Count;
+
+	// Whether the next interval forms a successive difference with the newest one
+	bool m_bNextIntervalContinues;
+};
+
+// SDANN (standard deviation of the mean NN interval of each segment, usually 5 minutes) over a whole session.
+// Only the segment being filled (a sum and a count) and a running Welford mean/variance over
+// the closed segment means are kept, so memory stays constant and each beat is O(1) over 24 hour recordings.
+// Segments are laid end to end on the stream's time line starting from the first beat,
+// and a segment with too little of its duration covered by accepted beats is left out of the statistic.
+class NNSegmentAggregator
+{
+public:
+	NNSegmentAggregator();
+
+	// Set the segment length, dropping every segment so far
+	void setSegmentDuration(double segment_seconds);
+	void reset();
+
+	// Add an accepted NN interval ending at the given stream time.
+	// Returns true if it closed a segment that went into the statistic.
+	bool addInterval(double interval_milliseconds, double time_in_seconds);
+
+	inline size_t getSegmentCount() const { return m_segmentCount; }
+
+	// Standard deviation of the segment means in milliseconds, false until two segments have closed
+	bool getSDANN(float& out_value) const;
+
+private:
+	bool closeSegment();
+
+	double m_segmentDuration;
+	double m_segmentStartTime;
+	bool m_bHasSegment;
+
+	// Segment being filled
+	int64_t m_segmentIntervalSum; // microseconds
+	size_t m_segmentIntervalCount;
+
+	// Welford running mean/variance of the closed segment means (milliseconds)
+	size_t m_segmentCount;
+	double m_segmentMeanAverage;
+	double m_segmentMeanM2;
+};
+
+// Frequency domain HRV (LF and HF power and their ratio) of the NN interval series over a sliding window.
+// The series is unevenly sampled (one value per beat), so the spectrum is a Lomb-Scargle periodogram
+// rather than an FFT of a resampled series. The periodogram at each frequency only depends on a handful of
+// sums of sines and cosines over the samples, which are updated as beats enter and leave the window,
+// so a beat costs O(frequencies) and the band powers are re-evaluated from the sums every few beats
+// without ever revisiting the window. The sums are rebuilt from the window now and then to wash out
+// rounding drift and to keep the phases relative to a recent reference time.
+// Beat times are the running sum of the intervals, resynced to the stream time after a gap.
+class HRVSpectrumFilter
+{
+public:
+	// Evaluation grid of 0.0025Hz bins tiling the LF (0.04-0.15Hz) and HF (0.15-0.4Hz) bands
+	static const int k_lf_bin_count = 44;
+	static const int k_hf_bin_count = 100;
+	static const int k_frequency_bin_count = k_lf_bin_count + k_hf_bin_count;
+
+	HRVSpectrumFilter();
+
+	// Size the window in seconds of beats, dropping every interval in it
+	void setWindowDuration(double window_seconds);
+	void reset();
+
+	// Add an accepted NN interval ending at (about) the given stream time.
+	// Returns true if the band powers were re-evaluated.
+	bool addInterval(double interval_milliseconds, double time_in_seconds);
+
+	inline size_t getIntervalCount() const { return m_sampleCount; }
+
+	// Current value of a filter over the window:
+	//   LFPower, HFPower - ms^2
+	//   LFHFRatio - unitless
+	// Returns false for filters not computed here or until the window spans enough of its duration.
+	bool getFilterValue(HSLHeartRateVariabityFilterType filter, float& out_value) const;
+
+private:
+	struct NNSample
+	{
+		double timeInSeconds;
+		double intervalMilliseconds;
+	};
+
+	// Per frequency sums over the window, with t relative to the reference time
+	struct FrequencySums
+	{
+		double yCos, ySin;	// sum(y cos(wt)), sum(y sin(wt))
+		double cos, sin;	// sum(cos(wt)), sum(sin(wt))
+		double cos2, sin2;	// sum(cos(2wt)), sum(sin(2wt))
+	};
+
+	void accumulateSample(const NNSample& sample, double weight);
+	void evictOldestSample();
+	void rebuildSums();
+	void evaluateBandPowers();
+
+	std::vector<NNSample> m_samples; // Ring of the intervals in the window
+	size_t m_oldestIndex;
+	size_t m_sampleCount;
+	double m_windowDuration;
+
+	std::array<FrequencySums, k_frequency_bin_count> m_frequencySums;
+	double m_intervalSum;
+	double m_referenceTime;
+	size_t m_samplesSinceRebuild;
+
+	double m_lastBeatTime;
+	bool m_bHasLastBeat;
+	int m_beatsSinceEvaluation;
+
+	float m_lfPower;
+	float m_hfPower;
+	bool m_bHasBandPowers;
+};
+
+#endif // HEART_RATE_VARIABILITY_FILTER_H
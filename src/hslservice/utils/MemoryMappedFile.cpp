@@ -0,0 +1,172 @@
+//-- includes -----
+#include "MemoryMappedFile.h"
+#include "Logger.h"
+
+#include <cstdint>
+
+#if defined WIN32 || defined _WIN32 || defined WINCE
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+//-- public implementation -----
+MemoryMappedFile::MemoryMappedFile()
+	: m_data(nullptr)
+	, m_size(0)
+#if defined WIN32 || defined _WIN32 || defined WINCE
+	, m_fileHandle(INVALID_HANDLE_VALUE)
+	, m_mappingHandle(nullptr)
+#else
+	, m_fileDescriptor(-1)
+#endif
+{
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+	close();
+}
+
+#if defined WIN32 || defined _WIN32 || defined WINCE
+bool MemoryMappedFile::open(const std::string &path, size_t size)
+{
+	close();
+
+	if (size == 0)
+		return false;
+
+	HANDLE file_handle= 
+		CreateFileA(
+			path.c_str(), 
+			GENERIC_READ | GENERIC_WRITE, 
+			FILE_SHARE_READ, 
+			nullptr, 
+			CREATE_ALWAYS, 
+			FILE_ATTRIBUTE_NORMAL, 
+			nullptr);
+	if (file_handle == INVALID_HANDLE_VALUE)
+	{
+		HSL_LOG_ERROR("MemoryMappedFile::open") << "Failed to create " << path << " (error " << GetLastError() << ")";
+		return false;
+	}
+
+	// Creating the mapping grows the file to the mapped size
+	const DWORD size_high= (DWORD)((uint64_t)size >> 32);
+	const DWORD size_low= (DWORD)((uint64_t)size & 0xffffffff);
+	HANDLE mapping_handle= 
+		CreateFileMappingA(
+			file_handle, 
+			nullptr, 
+			PAGE_READWRITE, 
+			size_high, 
+			size_low, 
+			nullptr);
+	if (mapping_handle == nullptr)
+	{
+		HSL_LOG_ERROR("MemoryMappedFile::open") << "Failed to map " << path << " (error " << GetLastError() << ")";
+		CloseHandle(file_handle);
+		return false;
+	}
+
+	void* data= MapViewOfFile(mapping_handle, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (data == nullptr)
+	{
+		HSL_LOG_ERROR("MemoryMappedFile::open") << "Failed to map a view of " << path << " (error " << GetLastError() << ")";
+		CloseHandle(mapping_handle);
+		CloseHandle(file_handle);
+		return false;
+	}
+
+	m_fileHandle= file_handle;
+	m_mappingHandle= mapping_handle;
+	m_data= data;
+	m_size= size;
+	m_path= path;
+
+	return true;
+}
+
+void MemoryMappedFile::close()
+{
+	if (m_data != nullptr)
+	{
+		UnmapViewOfFile(m_data);
+		m_data= nullptr;
+	}
+
+	if (m_mappingHandle != nullptr)
+	{
+		CloseHandle(m_mappingHandle);
+		m_mappingHandle= nullptr;
+	}
+
+	if (m_fileHandle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_fileHandle);
+		m_fileHandle= INVALID_HANDLE_VALUE;
+	}
+
+	m_size= 0;
+	m_path.clear();
+}
+#else
+bool MemoryMappedFile::open(const std::string &path, size_t size)
+{
+	close();
+
+	if (size == 0)
+		return false;
+
+	int file_descriptor= ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+	if (file_descriptor < 0)
+	{
+		HSL_LOG_ERROR("MemoryMappedFile::open") << "Failed to create " << path;
+		return false;
+	}
+
+	// Grow the file sparsely, disk blocks are only allocated as pages get written
+	if (ftruncate(file_descriptor, (off_t)size) != 0)
+	{
+		HSL_LOG_ERROR("MemoryMappedFile::open") << "Failed to grow " << path << " to " << size << " bytes";
+		::close(file_descriptor);
+		return false;
+	}
+
+	void* data= mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file_descriptor, 0);
+	if (data == MAP_FAILED)
+	{
+		HSL_LOG_ERROR("MemoryMappedFile::open") << "Failed to map " << path;
+		::close(file_descriptor);
+		return false;
+	}
+
+	m_fileDescriptor= file_descriptor;
+	m_data= data;
+	m_size= size;
+	m_path= path;
+
+	return true;
+}
+
+void MemoryMappedFile::close()
+{
+	if (m_data != nullptr)
+	{
+		munmap(m_data, m_size);
+		m_data= nullptr;
+	}
+
+	if (m_fileDescriptor >= 0)
+	{
+		::close(m_fileDescriptor);
+		m_fileDescriptor= -1;
+	}
+
+	m_size= 0;
+	m_path.clear();
+}
+#endif
@@ -0,0 +1,41 @@
+#ifndef MEMORY_MAPPED_FILE_H
+#define MEMORY_MAPPED_FILE_H
+
+//-- includes -----
+#include <cstddef>
+#include <string>
+
+//-- definitions -----
+// A fixed size file mapped read/write into the address space.
+// Pages are backed by the file rather than the page file/swap, so the OS is free to
+// write them out and drop them from RAM once they haven't been touched in a while.
+class MemoryMappedFile
+{
+public:
+	MemoryMappedFile();
+	virtual ~MemoryMappedFile();
+
+	// Create (or truncate) the file at the given path, grow it to the given size and map it.
+	// A freshly opened file always reads back as zeros.
+	bool open(const std::string &path, size_t size);
+	void close();
+
+	inline bool getIsOpen() const { return m_data != nullptr; }
+	inline void* getData() const { return m_data; }
+	inline size_t getSize() const { return m_size; }
+	inline const std::string& getPath() const { return m_path; }
+
+private:
+	void* m_data;
+	size_t m_size;
+	std::string m_path;
+
+#if defined WIN32 || defined _WIN32 || defined WINCE
+	void* m_fileHandle;
+	void* m_mappingHandle;
+#else
+	int m_fileDescriptor;
+#endif
+};
+
+#endif // MEMORY_MAPPED_FILE_H
@@ -0,0 +1,324 @@
+//-- includes -----
+#include "PPGBeatDetector.h"
+
+#include <algorithm>
+#include <cmath>
+
+//-- constants -----
+static const double k_butterworth_q = 0.70710678118654752440;
+
+// Pulse band, wide enough on top to keep the upstroke sharp
+static const double k_band_pass_low_hz = 0.5;
+static const double k_band_pass_high_hz = 8.0;
+
+static const double k_channel_power_seconds = 2.0;
+static const double k_slope_skew_seconds = 10.0;
+static const double k_slope_sum_window_seconds = 0.128;
+static const double k_learning_seconds = 2.0;
+static const double k_refractory_seconds = 0.300;
+static const double k_max_pulse_seconds = 0.400;
+
+// A pulse starts when the slope sum crosses this fraction of the recent pulse peaks,
+// and ends when it falls back under this fraction of its own peak
+static const double k_threshold_fraction = 0.5;
+static const double k_pulse_end_fraction = 0.5;
+// Pulses with a slope sum this many times the recent ones are motion artifacts
+static const double k_max_pulse_peak_ratio = 3.0;
+// Weight of each new pulse peak in the running average (clamped so one artifact can't run away with it)
+static const double k_peak_average_weight = 0.125;
+// With no pulse for this long the threshold decays so a weaker signal is picked up again
+static const double k_threshold_decay_seconds = 2.0;
+
+// Intervals outside of 30-200 BPM, or this far off the recent median, are missed or extra beats
+static const double k_min_interval_milliseconds = 300.0;
+static const double k_max_interval_milliseconds = 2000.0;
+static const double k_min_interval_median_ratio = 0.6;
+static const double k_max_interval_median_ratio = 1.5;
+static const size_t k_recent_interval_count = 5;
+
+// A sample gap longer than this many sample periods restarts the filters
+static const double k_max_gap_periods = 2.5;
+
+//-- public implementation -----
+PPGBeatDetector::PPGBeatDetector()
+	: m_sampleRate(0)
+{
+	setSampleRate(130);
+}
+
+void PPGBeatDetector::setSampleRate(int sample_rate)
+{
+	m_sampleRate= std::max(sample_rate, 20);
+	m_samplePeriod= 1.0 / (double)m_sampleRate;
+
+	const BiquadCoefficients sections[2]= {
+		make_biquad_high_pass(k_band_pass_low_hz, (double)m_sampleRate, k_butterworth_q),
+		make_biquad_low_pass(std::min(k_band_pass_high_hz, 0.4 * (double)m_sampleRate), (double)m_sampleRate, k_butterworth_q)
+	};
+	m_bandPass.setSections(sections, 2);
+
+	m_powerAlpha= 1.0 / (k_channel_power_seconds * (double)m_sampleRate);
+	m_skewAlpha= 1.0 / (k_slope_skew_seconds * (double)m_sampleRate);
+
+	const size_t window_length= std::max((size_t)lround(k_slope_sum_window_seconds * m_sampleRate), (size_t)1);
+	m_upSlopes.assign(window_length, 0.0);
+
+	m_recentIntervals.assign(k_recent_interval_count, 0.0);
+
+	reset();
+}
+
+void PPGBeatDetector::reset()
+{
+	m_sampleIndex= 0;
+	m_lastSampleTime= 0.0;
+
+	std::fill(m_channelPower, m_channelPower + k_channel_count, 0.0);
+	m_powerSampleCount= 0;
+	m_slopeSkew= 0.0;
+
+	m_peakAverage= 0.0;
+	m_bThresholdReady= false;
+	m_lastPulseTime= 0.0;
+
+	m_bHasLastBeat= false;
+	m_lastBeatTime= 0.0;
+
+	m_recentIntervalIndex= 0;
+	m_recentIntervalCount= 0;
+
+	restartAfterGap();
+
+	m_learningEndIndex= (uint64_t)(k_learning_seconds * m_sampleRate);
+}
+
+size_t PPGBeatDetector::addSamples(
+	double* samples, size_t sample_count, double first_sample_time, double sample_period,
+	Beat* out_beats, size_t max_beats)
+{
+	if (sample_count == 0)
+		return 0;
+
+	// Dropped packets (or a restarted stream) break the filter history
+	if (m_sampleIndex > 0)
+	{
+		const double time_delta= first_sample_time - m_lastSampleTime;
+
+		if (time_delta < 0.0 || time_delta > k_max_gap_periods * m_samplePeriod)
+		{
+			restartAfterGap();
+		}
+	}
+
+	m_bandPass.process(samples, sample_count);
+
+	size_t beat_count= 0;
+
+	for (size_t sample_index = 0; sample_index < sample_count; ++sample_index)
+	{
+		const double* channels= &samples[sample_index * BiquadFilterBank::k_lane_count];
+		const double sample_time= first_sample_time + (double)sample_index * sample_period;
+
+		// Running mean square of each channel, a plain average until there's a time constant's worth
+		m_powerSampleCount++;
+		const double power_alpha= std::max(m_powerAlpha, 1.0 / (double)m_powerSampleCount);
+
+		double fused= 0.0;
+		for (int channel_index = 0; channel_index < k_channel_count; ++channel_index)
+		{
+			const double value= channels[channel_index];
+			double& power= m_channelPower[channel_index];
+
+			power+= power_alpha * (value * value - power);
+			if (power > 0.0)
+			{
+				fused+= value / sqrt(power);
+			}
+		}
+		fused/= (double)k_channel_count;
+
+		Beat beat;
+		if (processFusedSample(fused, sample_time, beat) && beat_count < max_beats)
+		{
+			out_beats[beat_count++]= beat;
+		}
+	}
+
+	m_lastSampleTime= first_sample_time + (double)(sample_count - 1) * sample_period;
+
+	return beat_count;
+}
+
+//-- private methods -----
+void PPGBeatDetector::restartAfterGap()
+{
+	m_bandPass.reset();
+	std::fill(m_upSlopes.begin(), m_upSlopes.end(), 0.0);
+	m_slopeSum= 0.0;
+	m_lastFused= 0.0;
+	m_lastSlope= 0.0;
+	m_segmentStartIndex= m_sampleIndex;
+
+	m_bInPulse= false;
+	m_bNeedMaxSlopeNext= false;
+
+	// The interval across the gap is unknown
+	m_bHasLastBeat= false;
+}
+
+bool PPGBeatDetector::processFusedSample(double fused, double sample_time, Beat& out_beat)
+{
+	const uint64_t index= m_sampleIndex++;
+
+	if (index == m_segmentStartIndex)
+	{
+		m_lastFused= fused;
+		return false;
+	}
+
+	// Orient the waveform so the steep systolic edge is rising
+	const double raw_slope= fused - m_lastFused;
+	m_lastFused= fused;
+	const double skew_alpha= std::max(m_skewAlpha, 1.0 / (double)(index - m_segmentStartIndex));
+	m_slopeSkew+= skew_alpha * (raw_slope * raw_slope * raw_slope - m_slopeSkew);
+	const double slope= m_slopeSkew < 0.0 ? -raw_slope : raw_slope;
+
+	// Slope sum function, re-summed from the (short) window each sample so it never drifts
+	m_upSlopes[index % m_upSlopes.size()]= std::max(slope, 0.0);
+	m_slopeSum= 0.0;
+	for (double up_slope : m_upSlopes)
+	{
+		m_slopeSum+= up_slope;
+	}
+
+	bool bConfirmed= false;
+
+	if (m_bInPulse)
+	{
+		if (m_bNeedMaxSlopeNext)
+		{
+			m_maxSlopeNext= slope;
+			m_bNeedMaxSlopeNext= false;
+		}
+
+		if (slope > m_maxSlope)
+		{
+			m_maxSlopePrev= m_lastSlope;
+			m_maxSlope= slope;
+			m_maxSlopeTime= sample_time;
+			m_bNeedMaxSlopeNext= true;
+		}
+		m_pulsePeak= std::max(m_pulsePeak, m_slopeSum);
+
+		if ((m_slopeSum < k_pulse_end_fraction * m_pulsePeak && !m_bNeedMaxSlopeNext) ||
+			sample_time - m_pulseStartTime > k_max_pulse_seconds)
+		{
+			m_bInPulse= false;
+			bConfirmed= confirmPulse(out_beat);
+		}
+	}
+	else if (index < m_learningEndIndex)
+	{
+		// Learn the size of a pulse before detecting any
+		m_peakAverage= std::max(m_peakAverage, m_slopeSum);
+		m_lastPulseTime= sample_time;
+	}
+	else
+	{
+		m_bThresholdReady= m_peakAverage > 0.0;
+
+		// Lower the bar when pulses stop being found (i.e. the sensor moved to a weaker spot)
+		if (m_bThresholdReady && sample_time - m_lastPulseTime > k_threshold_decay_seconds)
+		{
+			m_peakAverage*= 1.0 - m_samplePeriod;
+		}
+
+		const bool bRefractory= sample_time - m_lastPulseTime < k_refractory_seconds;
+
+		if (m_bThresholdReady && !bRefractory && m_slopeSum > k_threshold_fraction * m_peakAverage)
+		{
+			m_bInPulse= true;
+			m_pulseStartTime= sample_time;
+			m_pulsePeak= m_slopeSum;
+			m_maxSlopePrev= m_lastSlope;
+			m_maxSlope= slope;
+			m_maxSlopeTime= sample_time;
+			m_bNeedMaxSlopeNext= true;
+		}
+	}
+
+	m_lastSlope= slope;
+
+	return bConfirmed;
+}
+
+bool PPGBeatDetector::confirmPulse(Beat& out_beat)
+{
+	const double pulse_peak= m_pulsePeak;
+	const bool bArtifact= pulse_peak > k_max_pulse_peak_ratio * m_peakAverage;
+
+	m_lastPulseTime= m_maxSlopeTime;
+	m_peakAverage+= k_peak_average_weight * (std::min(pulse_peak, 2.0 * m_peakAverage) - m_peakAverage);
+
+	if (bArtifact)
+	{
+		m_bHasLastBeat= false;
+		return false;
+	}
+
+	// Parabola through the slopes around the steepest one.
+	// The slope between two samples belongs half a sample before the newer one.
+	double offset= 0.0;
+	if (!m_bNeedMaxSlopeNext)
+	{
+		const double denominator= m_maxSlopePrev - 2.0 * m_maxSlope + m_maxSlopeNext;
+
+		if (denominator < 0.0)
+		{
+			offset= std::min(std::max(0.5 * (m_maxSlopePrev - m_maxSlopeNext) / denominator, -0.5), 0.5);
+		}
+	}
+	const double beat_time= m_maxSlopeTime + (offset - 0.5) * m_samplePeriod;
+
+	out_beat.timeInSeconds= beat_time;
+	out_beat.intervalMilliseconds= 0.0;
+	out_beat.bHasInterval= false;
+
+	if (m_bHasLastBeat)
+	{
+		const double interval_milliseconds= (beat_time - m_lastBeatTime) * 1000.0;
+
+		out_beat.bHasInterval= isPlausibleInterval(interval_milliseconds);
+		out_beat.intervalMilliseconds= interval_milliseconds;
+
+		// Every interval goes into the median so a real change in rate is followed within a few beats
+		m_recentIntervals[m_recentIntervalIndex]= interval_milliseconds;
+		m_recentIntervalIndex= (m_recentIntervalIndex + 1) % m_recentIntervals.size();
+		m_recentIntervalCount= std::min(m_recentIntervalCount + 1, m_recentIntervals.size());
+	}
+
+	m_bHasLastBeat= true;
+	m_lastBeatTime= beat_time;
+
+	return true;
+}
+
+bool PPGBeatDetector::isPlausibleInterval(double interval_milliseconds) const
+{
+	if (interval_milliseconds < k_min_interval_milliseconds || interval_milliseconds > k_max_interval_milliseconds)
+		return false;
+
+	// Not enough history to judge against yet
+	if (m_recentIntervalCount < 3)
+		return true;
+
+	double sorted[k_recent_interval_count];
+	std::copy(m_recentIntervals.begin(), m_recentIntervals.begin() + m_recentIntervalCount, sorted);
+	std::sort(sorted, sorted + m_recentIntervalCount);
+
+	const double median= sorted[m_recentIntervalCount / 2];
+
+	return
+		interval_milliseconds >= k_min_interval_median_ratio * median &&
+		interval_milliseconds <= k_max_interval_median_ratio * median;
+}
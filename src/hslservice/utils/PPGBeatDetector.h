@@ -0,0 +1,103 @@
+#ifndef PPG_BEAT_DETECTOR_H
+#define PPG_BEAT_DETECTOR_H
+
+//-- includes -----
+#include "BiquadFilterBank.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//-- definitions -----
+// Streaming pulse detector for multi-channel raw PPG (i.e. the three LED channels of a Polar optical sensor).
+// Ambient subtracted channels are band-passed (0.5-8Hz) side by side in a BiquadFilterBank, normalized by their
+// running RMS so each contributes equally, and averaged into one pulse waveform. The waveform's polarity
+// is picked from the skew of its slope (the systolic upstroke is the steep edge), and pulses are found on
+// a slope sum function (the sum of upward slopes over a 128ms window) against an adaptive threshold.
+// Each pulse is timed at the steepest point of its upstroke with sub-sample precision, which is a far more
+// stable fiducial than the rounded pulse peak. Pulses with an implausible slope sum are rejected as motion,
+// and intervals far off the median of the recent ones (missed or extra beats) aren't reported.
+// A beat is confirmed around 100-200ms after its upstroke. All storage is sized in setSampleRate().
+class PPGBeatDetector
+{
+public:
+	static const int k_channel_count = 3;
+
+	struct Beat
+	{
+		double timeInSeconds;			// Stream time of the steepest point of the upstroke
+		double intervalMilliseconds;	// From the previous beat (valid if bHasInterval)
+		bool bHasInterval;
+	};
+
+	PPGBeatDetector();
+
+	// Size the filters and windows for the stream's sample rate, dropping all detector state
+	void setSampleRate(int sample_rate);
+	void reset();
+
+	// Feed a run of evenly spaced samples.
+	// samples holds BiquadFilterBank::k_lane_count interleaved lanes per sample, the first k_channel_count
+	// being the ambient subtracted channels, and is band-passed in place.
+	// Returns the number of beats confirmed, written to out_beats (up to max_beats).
+	size_t addSamples(
+		double* samples, size_t sample_count, double first_sample_time, double sample_period,
+		Beat* out_beats, size_t max_beats);
+
+	// Stream time of the newest confirmed beat
+	inline double getLastBeatTime() const { return m_lastBeatTime; }
+
+private:
+	void restartAfterGap();
+	bool processFusedSample(double fused, double sample_time, Beat& out_beat);
+	bool confirmPulse(Beat& out_beat);
+	bool isPlausibleInterval(double interval_milliseconds) const;
+
+	int m_sampleRate;
+	double m_samplePeriod;
+
+	// Band-pass and channel fusion
+	BiquadFilterBank m_bandPass;
+	double m_channelPower[k_channel_count]; // Running mean square of each band-passed channel
+	double m_powerAlpha;
+	uint64_t m_powerSampleCount;
+	double m_slopeSkew; // Running mean of the cubed slope, negative when the pulse is inverted
+	double m_skewAlpha;
+
+	// Slope sum function
+	std::vector<double> m_upSlopes; // Ring of the last window of upward slopes
+	double m_slopeSum;
+	double m_lastFused;
+	double m_lastSlope;
+
+	uint64_t m_sampleIndex; // Samples since the last reset
+	uint64_t m_segmentStartIndex; // First sample after the last gap
+	double m_lastSampleTime;
+
+	// Adaptive threshold
+	uint64_t m_learningEndIndex;
+	double m_peakAverage; // Running average of the slope sum peaks of recent pulses
+	bool m_bThresholdReady;
+	double m_lastPulseTime;
+
+	// Pulse being tracked
+	bool m_bInPulse;
+	double m_pulseStartTime;
+	double m_pulsePeak;
+	double m_maxSlope;
+	double m_maxSlopePrev;
+	double m_maxSlopeNext;
+	double m_maxSlopeTime;
+	bool m_bNeedMaxSlopeNext;
+
+	// Last confirmed beat
+	bool m_bHasLastBeat;
+	double m_lastBeatTime;
+
+	// Recent intervals, the median is the reference the next one is checked against
+	std::vector<double> m_recentIntervals;
+	size_t m_recentIntervalIndex;
+	size_t m_recentIntervalCount;
+};
+
+#endif // PPG_BEAT_DETECTOR_H
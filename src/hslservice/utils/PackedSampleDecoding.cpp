@@ -0,0 +1,293 @@
+//-- includes -----
+#include "PackedSampleDecoding.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	#define HSL_HAS_X86_DECODERS 1
+	#include <immintrin.h>
+
+	#ifdef _MSC_VER
+		#include <intrin.h>
+		// MSVC lets any function use any instruction set's intrinsics
+		#define HSL_TARGET_SSSE3
+		#define HSL_TARGET_AVX2
+	#else
+		#include <cpuid.h>
+		// GCC and Clang need each kernel marked with the instruction set it is compiled for
+		#define HSL_TARGET_SSSE3 __attribute__((target("ssse3")))
+		#define HSL_TARGET_AVX2 __attribute__((target("avx2")))
+	#endif
+#endif
+
+//-- constants -----
+static const int k_max_pmd_delta_channels = 8;
+
+//-- private methods -----
+static void unpack_packed_int24_scalar(const uint8_t* src, int32_t* dst, size_t count)
+{
+	for (size_t index = 0; index < count; ++index)
+	{
+		const uint8_t* sample = src + index * 3;
+		const uint32_t raw = (uint32_t)sample[0] | ((uint32_t)sample[1] << 8) | ((uint32_t)sample[2] << 16);
+
+		dst[index] = (int32_t)(raw << 8) >> 8;
+	}
+}
+
+// Read the 64 bits starting at the given byte, zero filling past the end of the buffer
+static inline uint64_t read_bit_window(const uint8_t* src, size_t size, size_t byte_offset)
+{
+	uint64_t window = 0;
+
+	if (byte_offset + sizeof(uint64_t) <= size)
+	{
+		memcpy(&window, src + byte_offset, sizeof(uint64_t));
+	}
+	else if (byte_offset < size)
+	{
+		memcpy(&window, src + byte_offset, size - byte_offset);
+	}
+
+	return window;
+}
+
+#if HSL_HAS_X86_DECODERS
+// Each 32-bit lane takes the three bytes of one sample into its top three bytes,
+// so an arithmetic shift right by 8 sign extends it
+#define HSL_INT24_SHUFFLE_MASK -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11
+
+HSL_TARGET_SSSE3
+static void unpack_packed_int24_ssse3(const uint8_t* src, int32_t* dst, size_t count)
+{
+	const __m128i shuffle = _mm_setr_epi8(HSL_INT24_SHUFFLE_MASK);
+	size_t index = 0;
+
+	// 4 samples (12 bytes) per step, but each load is 16 bytes, so stop while a full load still fits
+	for (; (index + 4) * 3 + 4 <= count * 3; index += 4)
+	{
+		const __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + index * 3));
+		const __m128i widened = _mm_shuffle_epi8(packed, shuffle);
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + index), _mm_srai_epi32(widened, 8));
+	}
+
+	unpack_packed_int24_scalar(src + index * 3, dst + index, count - index);
+}
+
+HSL_TARGET_AVX2
+static void unpack_packed_int24_avx2(const uint8_t* src, int32_t* dst, size_t count)
+{
+	const __m256i shuffle = _mm256_setr_epi8(HSL_INT24_SHUFFLE_MASK, HSL_INT24_SHUFFLE_MASK);
+	size_t index = 0;
+
+	// 8 samples (24 bytes) per step, loaded as two overlapping 16 byte halves (the second ends 28 bytes in)
+	for (; (index + 8) * 3 + 4 <= count * 3; index += 8)
+	{
+		const uint8_t* block = src + index * 3;
+		const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+		const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 12));
+		const __m256i packed = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+		const __m256i widened = _mm256_shuffle_epi8(packed, shuffle);
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + index), _mm256_srai_epi32(widened, 8));
+	}
+
+	// Finish with the 128-bit form here rather than calling the SSSE3 kernel,
+	// mixing VEX and legacy SSE encodings stalls on some CPUs
+	for (; (index + 4) * 3 + 4 <= count * 3; index += 4)
+	{
+		const __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + index * 3));
+		const __m128i widened = _mm_shuffle_epi8(packed, _mm256_castsi256_si128(shuffle));
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + index), _mm_srai_epi32(widened, 8));
+	}
+
+	unpack_packed_int24_scalar(src + index * 3, dst + index, count - index);
+}
+
+static void query_cpuid(int leaf, int subleaf, unsigned int registers[4])
+{
+#ifdef _MSC_VER
+	int msvc_registers[4];
+	__cpuidex(msvc_registers, leaf, subleaf);
+	for (int index = 0; index < 4; ++index)
+	{
+		registers[index] = (unsigned int)msvc_registers[index];
+	}
+#else
+	if (!__get_cpuid_count((unsigned int)leaf, (unsigned int)subleaf, &registers[0], &registers[1], &registers[2], &registers[3]))
+	{
+		registers[0] = registers[1] = registers[2] = registers[3] = 0;
+	}
+#endif
+}
+
+static bool get_os_saves_avx_state()
+{
+#ifdef _MSC_VER
+	return (_xgetbv(0) & 0x6) == 0x6;
+#else
+	unsigned int eax, edx;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return (eax & 0x6) == 0x6;
+#endif
+}
+
+static PackedSampleDecoder detect_packed_sample_decoder()
+{
+	unsigned int features[4];
+	query_cpuid(1, 0, features);
+
+	const bool bHasSSSE3 = (features[2] & (1u << 9)) != 0;
+	const bool bHasOSXSave = (features[2] & (1u << 27)) != 0;
+	const bool bHasAVX = (features[2] & (1u << 28)) != 0;
+
+	query_cpuid(7, 0, features);
+	const bool bHasAVX2 = (features[1] & (1u << 5)) != 0;
+
+	if (bHasAVX2 && bHasAVX && bHasOSXSave && get_os_saves_avx_state())
+		return PackedSampleDecoder::AVX2;
+	else if (bHasSSSE3)
+		return PackedSampleDecoder::SSSE3;
+	else
+		return PackedSampleDecoder::Scalar;
+}
+#else
+static PackedSampleDecoder detect_packed_sample_decoder()
+{
+	return PackedSampleDecoder::Scalar;
+}
+#endif // HSL_HAS_X86_DECODERS
+
+//-- public implementation -----
+size_t decode_pmd_delta_frame(
+	const uint8_t* src, size_t size, int channel_count, int reference_bytes,
+	int32_t* out_values, size_t max_samples)
+{
+	if (channel_count <= 0 || channel_count > k_max_pmd_delta_channels ||
+		reference_bytes <= 0 || reference_bytes > 4 ||
+		max_samples == 0)
+		return 0;
+
+	const size_t reference_size = (size_t)channel_count * (size_t)reference_bytes;
+	if (size < reference_size)
+		return 0;
+
+	// The reference sample seeds every channel
+	int32_t running[k_max_pmd_delta_channels];
+	const int reference_shift = 32 - 8 * reference_bytes;
+	for (int channel = 0; channel < channel_count; ++channel)
+	{
+		uint32_t raw = 0;
+		memcpy(&raw, src + channel * reference_bytes, reference_bytes);
+
+		running[channel] = (int32_t)(raw << reference_shift) >> reference_shift;
+		out_values[channel] = running[channel];
+	}
+
+	size_t sample_count = 1;
+	size_t offset = reference_size;
+
+	while (offset + 2 <= size && sample_count < max_samples)
+	{
+		const int bit_width = src[offset];
+		const size_t block_samples = src[offset + 1];
+		const size_t block_values = block_samples * (size_t)channel_count;
+		const size_t packed_size = (block_values * (size_t)bit_width + 7) / 8;
+		const uint8_t* packed = src + offset + 2;
+
+		offset += 2;
+		if (bit_width > 32 || offset + packed_size > size)
+			break;
+
+		// Windows may overlap whatever follows the block in the payload, those bits get masked off
+		const size_t readable_size = size - offset;
+
+		const size_t samples_to_decode = std::min(block_samples, max_samples - sample_count);
+		int32_t* write_ptr = out_values + sample_count * channel_count;
+
+		if (bit_width == 0)
+		{
+			// Flat block, every delta is zero
+			for (size_t sample = 0; sample < samples_to_decode; ++sample)
+			{
+				memcpy(write_ptr, running, sizeof(int32_t) * channel_count);
+				write_ptr += channel_count;
+			}
+		}
+		else
+		{
+			// Pull each delta out of a 64-bit window starting at its first byte (bit_width + 7 <= 39 bits),
+			// then shift it to the top of the word and back down to sign extend it
+			const uint64_t mask = (bit_width >= 32) ? 0xffffffffull : ((1ull << bit_width) - 1);
+			const int sign_shift = 32 - bit_width;
+			size_t bit_offset = 0;
+
+			for (size_t sample = 0; sample < samples_to_decode; ++sample)
+			{
+				for (int channel = 0; channel < channel_count; ++channel)
+				{
+					const uint64_t window = read_bit_window(packed, readable_size, bit_offset >> 3);
+					const uint32_t raw_delta = (uint32_t)((window >> (bit_offset & 7)) & mask);
+					const int32_t delta = (int32_t)(raw_delta << sign_shift) >> sign_shift;
+
+					running[channel] = (int32_t)((uint32_t)running[channel] + (uint32_t)delta);
+					*write_ptr++ = running[channel];
+					bit_offset += bit_width;
+				}
+			}
+		}
+
+		sample_count += samples_to_decode;
+		offset += packed_size;
+	}
+
+	return sample_count;
+}
+
+PackedSampleDecoder get_packed_sample_decoder()
+{
+	// Detected once, the BLE threads can race on the first call but always agree on the answer
+	static std::atomic<int> s_decoder(-1);
+
+	int decoder = s_decoder.load(std::memory_order_relaxed);
+	if (decoder < 0)
+	{
+		decoder = (int)detect_packed_sample_decoder();
+		s_decoder.store(decoder, std::memory_order_relaxed);
+	}
+
+	return (PackedSampleDecoder)decoder;
+}
+
+void unpack_packed_int24_samples(const uint8_t* src, int32_t* dst, size_t count)
+{
+	unpack_packed_int24_samples_with(get_packed_sample_decoder(), src, dst, count);
+}
+
+void unpack_packed_int24_samples_with(PackedSampleDecoder decoder, const uint8_t* src, int32_t* dst, size_t count)
+{
+	// Never run a kernel the CPU can't execute
+	if ((int)decoder > (int)get_packed_sample_decoder())
+	{
+		decoder = PackedSampleDecoder::Scalar;
+	}
+
+	switch (decoder)
+	{
+#if HSL_HAS_X86_DECODERS
+	case PackedSampleDecoder::AVX2:
+		unpack_packed_int24_avx2(src, dst, count);
+		break;
+	case PackedSampleDecoder::SSSE3:
+		unpack_packed_int24_ssse3(src, dst, count);
+		break;
+#endif
+	default:
+		unpack_packed_int24_scalar(src, dst, count);
+		break;
+	}
+}
@@ -0,0 +1,37 @@
+#ifndef PACKED_SAMPLE_DECODING_H
+#define PACKED_SAMPLE_DECODING_H
+
+//-- includes -----
+#include <cstddef>
+#include <cstdint>
+
+//-- definitions -----
+// Which kernel unpack_packed_int24_samples() dispatches to on this CPU
+enum class PackedSampleDecoder
+{
+	Scalar,
+	SSSE3,
+	AVX2
+};
+
+PackedSampleDecoder get_packed_sample_decoder();
+
+// Sign extend count little-endian 24-bit samples packed back to back (3 bytes each) into int32s.
+// Picks the widest shuffle kernel the CPU supports the first time it is called (AVX2, then SSSE3, then scalar).
+// Only reads the count*3 bytes of input, so it can run straight over a notification payload.
+void unpack_packed_int24_samples(const uint8_t* src, int32_t* dst, size_t count);
+
+// Same as above with a specific kernel, falling back to scalar if the CPU doesn't support it
+void unpack_packed_int24_samples_with(PackedSampleDecoder decoder, const uint8_t* src, int32_t* dst, size_t count);
+
+// Decode a Polar PMD delta compressed frame (the payload after the frame type byte) into interleaved int32 samples.
+// The frame is one reference sample, channel_count signed little-endian values of reference_bytes each,
+// followed by delta blocks of:
+//   uint8 delta bit width | uint8 sample count | (sample count * channel_count) signed deltas, bit-packed LSB first
+// Each delta is added to the previous sample on the same channel, the reference sample is the first sample out.
+// Stops at max_samples samples or at a truncated block. Returns the number of samples (not values) written.
+size_t decode_pmd_delta_frame(
+	const uint8_t* src, size_t size, int channel_count, int reference_bytes,
+	int32_t* out_values, size_t max_samples);
+
+#endif // PACKED_SAMPLE_DECODING_H
@@ -0,0 +1,151 @@
+#include "PacketArena.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <cstring>
+
+//-- constants -----
+// Handles pack the size class into the top byte and the slot index into the rest
+static const int k_handle_size_class_shift = 24;
+static const uint32_t k_handle_slot_mask = (1 << k_handle_size_class_shift) - 1;
+static const size_t k_record_alignment = 16;
+
+//-- public implementation -----
+PacketArena::PacketArena(const SizeClass* size_classes, size_t size_class_count)
+	: m_storage(nullptr)
+	, m_storageSize(0)
+	, m_totalRecordCount(0)
+{
+	m_sizeClasses.reserve(size_class_count);
+
+	// Size classes are expected smallest to largest
+	for (size_t class_index = 0; class_index < size_class_count; ++class_index)
+	{
+		const SizeClass& size_class = size_classes[class_index];
+		assert(class_index == 0 || size_class.recordSize > size_classes[class_index - 1].recordSize);
+		assert(size_class.recordCount <= k_handle_slot_mask);
+
+		SizeClassState state;
+		state.recordSize =
+			((std::max(size_class.recordSize, sizeof(PacketRecordHeader)) + k_record_alignment - 1)
+			 / k_record_alignment) * k_record_alignment;
+		state.recordCount = size_class.recordCount;
+		state.storageOffset = m_storageSize;
+		state.freeRecords = new moodycamel::ReaderWriterQueue<uint32_t>(size_class.recordCount);
+
+		for (uint32_t slot_index = 0; slot_index < (uint32_t)size_class.recordCount; ++slot_index)
+		{
+			state.freeRecords->try_enqueue(slot_index);
+		}
+
+		m_sizeClasses.push_back(state);
+		m_sizeClasses.back().reclaimedRecords.reserve(size_class.recordCount);
+		m_storageSize += state.recordSize * state.recordCount;
+		m_totalRecordCount += state.recordCount;
+	}
+
+	m_storage = new uint8_t[m_storageSize];
+	memset(m_storage, 0, m_storageSize);
+}
+
+PacketArena::~PacketArena()
+{
+	for (SizeClassState& state : m_sizeClasses)
+	{
+		delete state.freeRecords;
+	}
+
+	delete[] m_storage;
+}
+
+t_packet_handle PacketArena::writeRecord(int32_t tag, const void* items, uint16_t item_size, uint16_t item_count, double timestamp)
+{
+	const size_t payload_size = (size_t)item_size * (size_t)item_count;
+	const size_t record_size = sizeof(PacketRecordHeader) + payload_size;
+
+	// Use the smallest size class that fits, spilling into larger classes when it's exhausted
+	for (size_t class_index = 0; class_index < m_sizeClasses.size(); ++class_index)
+	{
+		SizeClassState& state = m_sizeClasses[class_index];
+		uint32_t slot_index;
+
+		if (state.recordSize < record_size)
+			continue;
+
+		bool bFoundSlot= false;
+		if (!state.reclaimedRecords.empty())
+		{
+			slot_index= state.reclaimedRecords.back();
+			state.reclaimedRecords.pop_back();
+			bFoundSlot= true;
+		}
+		else
+		{
+			bFoundSlot= state.freeRecords->try_dequeue(slot_index);
+		}
+
+		if (bFoundSlot)
+		{
+			const t_packet_handle handle = ((uint32_t)class_index << k_handle_size_class_shift) | slot_index;
+			uint8_t* record = getRecord(handle);
+
+			PacketRecordHeader* header = reinterpret_cast<PacketRecordHeader*>(record);
+			header->tag = tag;
+			header->itemSize = item_size;
+			header->itemCount = item_count;
+			header->payloadSize = (uint32_t)payload_size;
+			header->reserved = 0;
+			header->timestamp = timestamp;
+
+			memcpy(record + sizeof(PacketRecordHeader), items, payload_size);
+
+			return handle;
+		}
+	}
+
+	return k_invalid_packet_handle;
+}
+
+const PacketRecordHeader* PacketArena::getRecordHeader(t_packet_handle handle) const
+{
+	return reinterpret_cast<const PacketRecordHeader*>(getRecord(handle));
+}
+
+const void* PacketArena::getRecordPayload(t_packet_handle handle) const
+{
+	return getRecord(handle) + sizeof(PacketRecordHeader);
+}
+
+void PacketArena::releaseRecord(t_packet_handle handle)
+{
+	const size_t class_index = handle >> k_handle_size_class_shift;
+
+	if (class_index < m_sizeClasses.size())
+	{
+		m_sizeClasses[class_index].freeRecords->try_enqueue(handle & k_handle_slot_mask);
+	}
+}
+
+void PacketArena::reclaimRecord(t_packet_handle handle)
+{
+	const size_t class_index = handle >> k_handle_size_class_shift;
+
+	if (class_index < m_sizeClasses.size())
+	{
+		// Never reallocates, there can't be more reclaimed records than the class holds
+		m_sizeClasses[class_index].reclaimedRecords.push_back(handle & k_handle_slot_mask);
+	}
+}
+
+//-- protected implementation -----
+uint8_t* PacketArena::getRecord(t_packet_handle handle) const
+{
+	const size_t class_index = handle >> k_handle_size_class_shift;
+	const size_t slot_index = handle & k_handle_slot_mask;
+	assert(class_index < m_sizeClasses.size());
+
+	const SizeClassState& state = m_sizeClasses[class_index];
+	assert(slot_index < state.recordCount);
+
+	return m_storage + state.storageOffset + slot_index * state.recordSize;
+}
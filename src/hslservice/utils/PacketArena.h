@@ -0,0 +1,83 @@
+#ifndef PACKET_ARENA_H
+#define PACKET_ARENA_H
+
+//-- includes -----
+#include "readerwriterqueue.h" // lockfree queue
+
+#include <cstdint>
+#include <vector>
+
+//-- constants -----
+typedef uint32_t t_packet_handle;
+const t_packet_handle k_invalid_packet_handle = 0xffffffff;
+
+//-- definitions -----
+// Prefix on every record in the arena describing the payload that follows it
+struct PacketRecordHeader
+{
+	int32_t tag;		// Caller defined payload type
+	uint16_t itemSize;	// Size of each payload item in bytes
+	uint16_t itemCount;	// Number of payload items following the header
+	uint32_t payloadSize;	// itemSize * itemCount
+	uint32_t reserved;
+	double timestamp;	// Caller defined time the record was written (i.e. packet arrival time)
+};
+
+// Preallocated pool of variable-length packet records, split into fixed size classes.
+// A record is written by a producer thread and handed to the consumer thread by handle,
+// so a small packet only costs a small slot instead of the size of the largest packet type.
+// Records are allocated by a single producer and released by a single consumer:
+// freed slots flow back to the producer through a lock-free queue per size class.
+// The producer can also reclaim a record it took back before the consumer saw it (i.e. drop-oldest overflow).
+class PacketArena
+{
+public:
+	struct SizeClass
+	{
+		size_t recordSize;	// Size of a record slot including the PacketRecordHeader
+		size_t recordCount;	// Number of slots of this size to preallocate
+	};
+
+	PacketArena(const SizeClass* size_classes, size_t size_class_count);
+	virtual ~PacketArena();
+
+	// Total number of record slots across every size class
+	inline size_t getTotalRecordCount() const { return m_totalRecordCount; }
+
+	// Total bytes of record storage
+	inline size_t getTotalStorageSize() const { return m_storageSize; }
+
+	// -- Producer -----
+	// Copy the items into the smallest free record that fits them.
+	// Returns k_invalid_packet_handle if no record large enough is free.
+	t_packet_handle writeRecord(int32_t tag, const void* items, uint16_t item_size, uint16_t item_count, double timestamp= 0.0);
+
+	// Return a record the producer evicted from its queue before the consumer could read it
+	void reclaimRecord(t_packet_handle handle);
+
+	// -- Consumer -----
+	const PacketRecordHeader* getRecordHeader(t_packet_handle handle) const;
+	const void* getRecordPayload(t_packet_handle handle) const;
+
+	// Give the record back to the producer once the consumer is done with it
+	void releaseRecord(t_packet_handle handle);
+
+protected:
+	struct SizeClassState
+	{
+		size_t recordSize;
+		size_t recordCount;
+		size_t storageOffset;
+		moodycamel::ReaderWriterQueue<uint32_t>* freeRecords;	// Released by the consumer
+		std::vector<uint32_t> reclaimedRecords;	// Reclaimed by the producer
+	};
+
+	uint8_t* getRecord(t_packet_handle handle) const;
+
+	std::vector<SizeClassState> m_sizeClasses;
+	uint8_t* m_storage;
+	size_t m_storageSize;
+	size_t m_totalRecordCount;
+};
+
+#endif // PACKET_ARENA_H
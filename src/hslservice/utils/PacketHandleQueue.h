@@ -0,0 +1,103 @@
+#ifndef PACKET_HANDLE_QUEUE_H
+#define PACKET_HANDLE_QUEUE_H
+
+//-- includes -----
+#include "PacketArena.h"
+
+#include <atomic>
+#include <cstdint>
+
+//-- definitions -----
+// Fixed capacity single producer / single consumer queue of packet handles that never allocates.
+// Unlike a plain SPSC queue the producer is also allowed to evict the oldest entry when the queue
+// backs up (drop-oldest overflow). The producer and consumer race for the oldest entry with a CAS
+// on the tail, so whichever side wins owns that handle.
+class PacketHandleQueue
+{
+public:
+	explicit PacketHandleQueue(size_t min_capacity)
+		: m_capacity(1)
+		, m_head(0)
+		, m_tail(0)
+		, m_slots(nullptr)
+	{
+		while (m_capacity < min_capacity)
+		{
+			m_capacity <<= 1;
+		}
+
+		m_slots = new std::atomic<t_packet_handle>[m_capacity];
+		for (size_t index = 0; index < m_capacity; ++index)
+		{
+			m_slots[index].store(k_invalid_packet_handle, std::memory_order_relaxed);
+		}
+	}
+
+	~PacketHandleQueue()
+	{
+		delete[] m_slots;
+	}
+
+	inline size_t getCapacity() const { return m_capacity; }
+
+	// -- Producer -----
+	// Returns false if the queue is full
+	bool tryPush(t_packet_handle handle)
+	{
+		const uint64_t head = m_head.load(std::memory_order_relaxed);
+		const uint64_t tail = m_tail.load(std::memory_order_acquire);
+
+		if (head - tail >= m_capacity)
+			return false;
+
+		m_slots[head & (m_capacity - 1)].store(handle, std::memory_order_relaxed);
+		m_head.store(head + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	// Take the oldest handle back off the queue before the consumer sees it.
+	// Returns false if the queue is empty.
+	bool tryEvictOldest(t_packet_handle& out_handle)
+	{
+		return tryTakeTail(out_handle);
+	}
+
+	// -- Consumer -----
+	// Returns false if the queue is empty
+	bool tryPop(t_packet_handle& out_handle)
+	{
+		return tryTakeTail(out_handle);
+	}
+
+protected:
+	bool tryTakeTail(t_packet_handle& out_handle)
+	{
+		uint64_t tail = m_tail.load(std::memory_order_acquire);
+
+		while (tail < m_head.load(std::memory_order_acquire))
+		{
+			// The slot can only be refilled by the producer once the tail has moved past it,
+			// in which case the CAS below fails and we retry with the new tail
+			const t_packet_handle handle = m_slots[tail & (m_capacity - 1)].load(std::memory_order_relaxed);
+
+			if (m_tail.compare_exchange_weak(tail, tail + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+			{
+				out_handle = handle;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	size_t m_capacity;
+	std::atomic<uint64_t> m_head;
+	std::atomic<uint64_t> m_tail;
+	std::atomic<t_packet_handle>* m_slots;
+
+	PacketHandleQueue(const PacketHandleQueue &copy) = delete;
+	PacketHandleQueue &operator=(const PacketHandleQueue &copy) = delete;
+};
+
+#endif // PACKET_HANDLE_QUEUE_H
@@ -0,0 +1,337 @@
+//-- includes -----
+#include "QRSDetector.h"
+
+#include <algorithm>
+#include <cmath>
+
+//-- constants -----
+static const double k_butterworth_q = 0.70710678118654752440;
+
+// Pan-Tompkins pass band, where most of the QRS energy is
+static const double k_band_pass_low_hz = 5.0;
+static const double k_band_pass_high_hz = 15.0;
+
+static const double k_integrator_window_seconds = 0.150;
+static const double k_learning_seconds = 2.0;
+// Time the filters are given to settle after a gap before peaks are trusted again
+static const double k_settle_seconds = 0.5;
+static const double k_refractory_seconds = 0.200;
+// Peaks this soon after a QRS are checked for being a T-wave
+static const double k_t_wave_window_seconds = 0.360;
+// A missing beat is searched for after this many average RR intervals
+static const double k_search_back_rr_multiple = 1.66;
+// A sample gap longer than this many sample periods restarts the filters
+static const double k_max_gap_periods = 2.5;
+
+static const size_t k_rr_average_count = 8;
+static const size_t k_integrator_resum_period = 4096;
+
+//-- public implementation -----
+QRSDetector::QRSDetector()
+	: m_sampleRate(0)
+{
+	setSampleRate(130);
+}
+
+void QRSDetector::setSampleRate(int sample_rate)
+{
+	m_sampleRate= std::max(sample_rate, 50);
+	m_samplePeriod= 1.0 / (double)m_sampleRate;
+
+	// Keep the low-pass corner safely under nyquist at low sample rates
+	const double high_hz= std::min(k_band_pass_high_hz, 0.4 * (double)m_sampleRate);
+	m_highPass.set(make_biquad_high_pass(k_band_pass_low_hz, (double)m_sampleRate, k_butterworth_q));
+	m_lowPass.set(make_biquad_low_pass(high_hz, (double)m_sampleRate, k_butterworth_q));
+
+	const size_t integrator_length= std::max((size_t)lround(k_integrator_window_seconds * m_sampleRate), (size_t)1);
+	m_squared.assign(integrator_length, 0.0);
+
+	// Enough history to reach back over the integrator window (and the derivative taps) from a peak
+	size_t history_length= 16;
+	while (history_length < integrator_length + 8)
+	{
+		history_length*= 2;
+	}
+	m_bandPassed.assign(history_length, 0.f);
+	m_sampleTimes.assign(history_length, 0.0);
+	m_historyMask= history_length - 1;
+
+	m_rrHistory.assign(k_rr_average_count, 0.0);
+
+	reset();
+}
+
+void QRSDetector::reset()
+{
+	m_sampleIndex= 0;
+	m_lastSampleTime= 0.0;
+
+	m_learningPeak= 0.0;
+	m_learningSum= 0.0;
+	m_signalLevel= 0.0;
+	m_noiseLevel= 0.0;
+	m_bThresholdsReady= false;
+
+	m_qrsCount= 0;
+	m_bHasLastQRS= false;
+	m_lastQRSIndex= 0;
+	m_lastQRSSlope= 0.0;
+	m_lastRPeakTime= 0.0;
+	m_lastRRInterval= 0.0;
+	m_bHasLastRRInterval= false;
+	m_bLastQRSBeforeGap= false;
+
+	std::fill(m_rrHistory.begin(), m_rrHistory.end(), 0.0);
+	m_rrHistoryIndex= 0;
+	m_rrHistoryCount= 0;
+	m_rrHistorySum= 0.0;
+
+	restartAfterGap();
+
+	m_learningEndIndex= (uint64_t)(k_learning_seconds * m_sampleRate);
+}
+
+bool QRSDetector::addSample(float value, double time_in_seconds)
+{
+	// Dropped packets (or a restarted stream) break the filter history
+	if (m_sampleIndex > 0)
+	{
+		const double time_delta= time_in_seconds - m_lastSampleTime;
+
+		if (time_delta < 0.0 || time_delta > k_max_gap_periods * m_samplePeriod)
+		{
+			restartAfterGap();
+		}
+	}
+	m_lastSampleTime= time_in_seconds;
+
+	const uint64_t index= m_sampleIndex;
+	const uint64_t qrs_count_before= m_qrsCount;
+	const double band_passed= m_lowPass.process(m_highPass.process((double)value));
+
+	m_bandPassed[index & m_historyMask]= (float)band_passed;
+	m_sampleTimes[index & m_historyMask]= time_in_seconds;
+	m_sampleIndex++;
+
+	// Five point derivative, needs four samples of history in this segment
+	if (index < m_segmentStartIndex + 4)
+		return false;
+
+	const double derivative=
+		(2.0 * band_passed + m_bandPassed[(index - 1) & m_historyMask]
+		 - m_bandPassed[(index - 3) & m_historyMask] - 2.0 * m_bandPassed[(index - 4) & m_historyMask])
+		* ((double)m_sampleRate / 8.0);
+	const double squared= derivative * derivative;
+
+	m_recentSlope= std::max(m_recentSlope, squared);
+
+	// Moving window integrator
+	const size_t integrator_length= m_squared.size();
+	double& oldest_squared= m_squared[index % integrator_length];
+	m_integratorSum+= squared - oldest_squared;
+	oldest_squared= squared;
+
+	// Re-sum every so often so rounding can't build up over long sessions
+	if (index % k_integrator_resum_period == 0)
+	{
+		m_integratorSum= 0.0;
+		for (double x : m_squared)
+		{
+			m_integratorSum+= x;
+		}
+	}
+
+	const double integrated= m_integratorSum / (double)integrator_length;
+	const uint64_t settled_index= m_segmentStartIndex + (uint64_t)(k_settle_seconds * m_sampleRate);
+
+	if (index >= settled_index)
+	{
+		if (!m_bThresholdsReady)
+		{
+			// Learn the initial signal and noise levels from the first couple of seconds
+			m_learningPeak= std::max(m_learningPeak, integrated);
+			m_learningSum+= integrated;
+
+			if (index >= settled_index + m_learningEndIndex)
+			{
+				m_signalLevel= m_learningPeak / 3.0;
+				m_noiseLevel= 0.5 * m_learningSum / (double)m_learningEndIndex;
+				m_bThresholdsReady= true;
+			}
+		}
+		else
+		{
+			// Search back for a beat that was missed below the threshold
+			if (m_bHasLastQRS && !m_bLastQRSBeforeGap && m_bHasSearchBackCandidate && m_rrHistoryCount > 0)
+			{
+				const double rr_average= m_rrHistorySum / (double)m_rrHistoryCount;
+
+				if ((double)(index - m_lastQRSIndex) > k_search_back_rr_multiple * rr_average)
+				{
+					const double threshold= m_noiseLevel + 0.25 * (m_signalLevel - m_noiseLevel);
+
+					if (m_searchBackPeak > 0.5 * threshold)
+					{
+						m_signalLevel= 0.25 * m_searchBackPeak + 0.75 * m_signalLevel;
+						acceptQRS(m_searchBackPeak, m_searchBackIndex, m_searchBackRPeakTime, m_searchBackSlope);
+					}
+					else
+					{
+						m_bHasSearchBackCandidate= false;
+					}
+				}
+			}
+
+			// Local maximum of the integrator output at the previous sample
+			if (m_integrated[1] > m_integrated[0] && m_integrated[1] >= integrated)
+			{
+				processIntegratorPeak(m_integrated[1], index - 1);
+			}
+		}
+	}
+
+	m_integrated[0]= m_integrated[1];
+	m_integrated[1]= integrated;
+
+	return m_qrsCount != qrs_count_before;
+}
+
+bool QRSDetector::getLastRRInterval(double& out_interval_ms) const
+{
+	if (m_bHasLastRRInterval)
+	{
+		out_interval_ms= m_lastRRInterval * 1000.0;
+		return true;
+	}
+
+	return false;
+}
+
+//-- private methods -----
+void QRSDetector::restartAfterGap()
+{
+	m_highPass.clear();
+	m_lowPass.clear();
+	std::fill(m_squared.begin(), m_squared.end(), 0.0);
+	m_integratorSum= 0.0;
+	m_integrated[0]= 0.0;
+	m_integrated[1]= 0.0;
+	m_recentSlope= 0.0;
+	m_segmentStartIndex= m_sampleIndex;
+	m_bHasSearchBackCandidate= false;
+
+	// The next beat can't form an interval with one from before the gap
+	m_bLastQRSBeforeGap= m_bHasLastQRS;
+}
+
+void QRSDetector::processIntegratorPeak(double peak, uint64_t peak_index)
+{
+	const double slope= m_recentSlope;
+	m_recentSlope= 0.0;
+
+	const uint64_t samples_since_qrs= m_bHasLastQRS ? peak_index - m_lastQRSIndex : UINT64_MAX;
+
+	// Nothing can follow a QRS complex this closely
+	if (m_bHasLastQRS && !m_bLastQRSBeforeGap &&
+		(double)samples_since_qrs < k_refractory_seconds * m_sampleRate)
+	{
+		return;
+	}
+
+	const double threshold= m_noiseLevel + 0.25 * (m_signalLevel - m_noiseLevel);
+	bool bIsQRS= peak > threshold;
+
+	// A T-wave soon after a QRS has a much gentler slope
+	if (bIsQRS && m_bHasLastQRS && !m_bLastQRSBeforeGap &&
+		(double)samples_since_qrs < k_t_wave_window_seconds * m_sampleRate &&
+		slope < 0.5 * m_lastQRSSlope)
+	{
+		bIsQRS= false;
+	}
+
+	if (bIsQRS)
+	{
+		m_signalLevel= 0.125 * peak + 0.875 * m_signalLevel;
+		acceptQRS(peak, peak_index, locateRPeakTime(peak_index), slope);
+	}
+	else
+	{
+		m_noiseLevel= 0.125 * peak + 0.875 * m_noiseLevel;
+
+		if (!m_bHasSearchBackCandidate || peak > m_searchBackPeak)
+		{
+			m_bHasSearchBackCandidate= true;
+			m_searchBackPeak= peak;
+			m_searchBackIndex= peak_index;
+			m_searchBackRPeakTime= locateRPeakTime(peak_index);
+			m_searchBackSlope= slope;
+		}
+	}
+}
+
+void QRSDetector::acceptQRS(double peak, uint64_t peak_index, double r_peak_time, double slope)
+{
+	(void)peak;
+
+	if (m_bHasLastQRS && !m_bLastQRSBeforeGap)
+	{
+		m_lastRRInterval= r_peak_time - m_lastRPeakTime;
+		m_bHasLastRRInterval= true;
+
+		// Average RR in samples, for the search back
+		const double rr_samples= (double)(peak_index - m_lastQRSIndex);
+		m_rrHistorySum+= rr_samples - m_rrHistory[m_rrHistoryIndex];
+		m_rrHistory[m_rrHistoryIndex]= rr_samples;
+		m_rrHistoryIndex= (m_rrHistoryIndex + 1) % k_rr_average_count;
+		m_rrHistoryCount= std::min(m_rrHistoryCount + 1, k_rr_average_count);
+	}
+	else
+	{
+		m_bHasLastRRInterval= false;
+	}
+
+	m_qrsCount++;
+	m_bHasLastQRS= true;
+	m_bLastQRSBeforeGap= false;
+	m_lastQRSIndex= peak_index;
+	m_lastQRSSlope= slope;
+	m_lastRPeakTime= r_peak_time;
+	m_bHasSearchBackCandidate= false;
+}
+
+double QRSDetector::locateRPeakTime(uint64_t peak_index) const
+{
+	// The R peak is the largest band-passed deflection in the integrator window leading up to the peak
+	const uint64_t window= (uint64_t)m_squared.size() + 4;
+	const uint64_t oldest_available= m_sampleIndex > m_historyMask ? m_sampleIndex - m_historyMask : 0;
+	const uint64_t first_index= std::max({peak_index > window ? peak_index - window : 0, m_segmentStartIndex, oldest_available});
+
+	uint64_t best_index= peak_index;
+	float best_value= -1.f;
+	for (uint64_t index = first_index; index <= peak_index; ++index)
+	{
+		const float value= fabsf(m_bandPassed[index & m_historyMask]);
+
+		if (value > best_value)
+		{
+			best_value= value;
+			best_index= index;
+		}
+	}
+
+	// Parabolic interpolation through the neighbors for a sub-sample peak time
+	double offset= 0.0;
+	if (best_index > first_index && best_index + 1 < m_sampleIndex)
+	{
+		const double previous= fabsf(m_bandPassed[(best_index - 1) & m_historyMask]);
+		const double next= fabsf(m_bandPassed[(best_index + 1) & m_historyMask]);
+		const double denominator= previous - 2.0 * (double)best_value + next;
+
+		if (denominator < 0.0)
+		{
+			offset= std::min(std::max(0.5 * (previous - next) / denominator, -0.5), 0.5);
+		}
+	}
+
+	return m_sampleTimes[best_index & m_historyMask] + offset * m_samplePeriod;
+}
@@ -0,0 +1,116 @@
+#ifndef QRS_DETECTOR_H
+#define QRS_DETECTOR_H
+
+//-- includes -----
+#include "BiquadFilterBank.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//-- definitions -----
+// Streaming Pan-Tompkins QRS detector for a single lead ECG.
+// Each sample goes through a 5-15Hz band-pass, a five point derivative, squaring and a 150ms moving window integrator.
+// Peaks of the integrated signal are classified as QRS complexes or noise against adaptive signal/noise levels,
+// with a refractory period, T-wave rejection by slope, and a search back for beats missed below threshold.
+// The R peak of each accepted complex is located in the band-passed signal with sub-sample precision,
+// so RR intervals are much finer than the sample period (or the 1/1024s units of the HR characteristic).
+// A beat is confirmed roughly 100-150ms after the R peak (longer only when found by the search back).
+// All storage is sized in setSampleRate(), adding a sample never allocates.
+class QRSDetector
+{
+public:
+	QRSDetector();
+
+	// Size the filters and windows for the stream's sample rate, dropping all detector state
+	void setSampleRate(int sample_rate);
+	void reset();
+
+	// Feed the next ECG sample (microvolts) at the given stream time.
+	// Returns true when it confirmed an R peak.
+	bool addSample(float value, double time_in_seconds);
+
+	// Stream time of the newest confirmed R peak.
+	// This trails the true R peak by the (constant) band-pass delay, which cancels out of RR intervals.
+	inline double getLastRPeakTime() const { return m_lastRPeakTime; }
+
+	// Interval between the two newest R peaks in milliseconds.
+	// Returns false if there is no earlier peak or a gap in the samples separates the two.
+	bool getLastRRInterval(double& out_interval_ms) const;
+
+private:
+	// Single section run a sample at a time, the detector needs every sample as it arrives
+	struct Biquad
+	{
+		BiquadCoefficients c;
+		double z1, z2;
+
+		void set(const BiquadCoefficients& coefficients) { c= coefficients; clear(); }
+		void clear() { z1= z2= 0.0; }
+		inline double process(double x)
+		{
+			const double y= c.b0 * x + z1;
+			z1= c.b1 * x - c.a1 * y + z2;
+			z2= c.b2 * x - c.a2 * y;
+			return y;
+		}
+	};
+
+	void restartAfterGap();
+	void processIntegratorPeak(double peak, uint64_t peak_index);
+	void acceptQRS(double peak, uint64_t peak_index, double r_peak_time, double slope);
+	double locateRPeakTime(uint64_t peak_index) const;
+
+	int m_sampleRate;
+	double m_samplePeriod;
+
+	// Filter chain
+	Biquad m_highPass;
+	Biquad m_lowPass;
+	std::vector<float> m_bandPassed; // Ring of recent band-passed samples (power of two)
+	std::vector<double> m_sampleTimes; // Stream time of each sample in m_bandPassed
+	size_t m_historyMask;
+	std::vector<double> m_squared; // Moving window integrator ring
+	double m_integratorSum;
+	double m_integrated[2]; // Previous two integrator outputs (for local peak detection)
+
+	uint64_t m_sampleIndex; // Samples since the last reset
+	uint64_t m_segmentStartIndex; // First sample after the last gap
+	double m_lastSampleTime;
+
+	// Adaptive thresholds
+	uint64_t m_learningEndIndex;
+	double m_learningPeak;
+	double m_learningSum;
+	double m_signalLevel;
+	double m_noiseLevel;
+	bool m_bThresholdsReady;
+
+	// Slope of the steepest part of the signal since the last integrator peak (for T-wave rejection)
+	double m_recentSlope;
+
+	// Last accepted QRS complex
+	uint64_t m_qrsCount;
+	bool m_bHasLastQRS;
+	uint64_t m_lastQRSIndex; // Integrator peak index
+	double m_lastQRSSlope;
+	double m_lastRPeakTime;
+	double m_lastRRInterval; // seconds
+	bool m_bHasLastRRInterval;
+	bool m_bLastQRSBeforeGap;
+
+	// Running average of the last k_rr_average_count RR intervals in samples
+	std::vector<double> m_rrHistory;
+	size_t m_rrHistoryIndex;
+	size_t m_rrHistoryCount;
+	double m_rrHistorySum;
+
+	// Largest below-threshold peak since the last QRS, the search back candidate
+	bool m_bHasSearchBackCandidate;
+	double m_searchBackPeak;
+	uint64_t m_searchBackIndex;
+	double m_searchBackRPeakTime;
+	double m_searchBackSlope;
+};
+
+#endif // QRS_DETECTOR_H
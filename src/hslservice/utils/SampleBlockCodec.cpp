@@ -0,0 +1,175 @@
+//-- includes -----
+#include "SampleBlockCodec.h"
+#include "SampleUnpacking.h" // HSL_HAS_SSE2
+
+#include <cstring>
+
+//-- constants -----
+static const size_t k_block_header_size = sizeof(int32_t) + sizeof(uint8_t);
+
+//-- private methods -----
+static inline uint32_t zigzag_encode(uint32_t delta)
+{
+	return (delta << 1) ^ (uint32_t)((int32_t)delta >> 31);
+}
+
+static inline uint32_t zigzag_decode(uint32_t value)
+{
+	return (value >> 1) ^ (0u - (value & 1));
+}
+
+static inline int get_bit_width(uint32_t value)
+{
+	int bit_width = 0;
+
+	while (value != 0)
+	{
+		++bit_width;
+		value >>= 1;
+	}
+
+	return bit_width;
+}
+
+static inline size_t get_packed_size(size_t value_count, int bit_width)
+{
+	return (value_count * (size_t)bit_width + 7) / 8;
+}
+
+// Turn the unpacked zigzag deltas in dst[1..count) back into sample values, with dst[0] holding the first value
+static void integrate_deltas(int32_t* dst, size_t count)
+{
+	uint32_t* values = reinterpret_cast<uint32_t*>(dst);
+	size_t index = 1;
+
+#if HSL_HAS_SSE2
+	const __m128i one = _mm_set1_epi32(1);
+	__m128i running = _mm_set1_epi32((int32_t)values[0]);
+
+	for (; index + 4 <= count; index += 4)
+	{
+		__m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + index));
+
+		// Zigzag decode all four lanes
+		__m128i delta = 
+			_mm_xor_si128(
+				_mm_srli_epi32(packed, 1), 
+				_mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(packed, one)));
+
+		// Inclusive prefix sum across the four lanes, then carry in the previous value
+		delta = _mm_add_epi32(delta, _mm_slli_si128(delta, 4));
+		delta = _mm_add_epi32(delta, _mm_slli_si128(delta, 8));
+		delta = _mm_add_epi32(delta, running);
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(values + index), delta);
+		running = _mm_shuffle_epi32(delta, _MM_SHUFFLE(3, 3, 3, 3));
+	}
+#endif
+
+	for (; index < count; ++index)
+	{
+		values[index] = values[index - 1] + zigzag_decode(values[index]);
+	}
+}
+
+//-- public implementation -----
+size_t get_max_encoded_sample_block_size(size_t count)
+{
+	return (count > 0) ? k_block_header_size + get_packed_size(count - 1, 32) : 0;
+}
+
+size_t encode_sample_block(const int32_t* src, size_t stride, size_t count, uint8_t* dst)
+{
+	if (count == 0)
+		return 0;
+
+	// Find the narrowest width that fits every delta
+	uint32_t delta_bits = 0;
+	for (size_t index = 1; index < count; ++index)
+	{
+		delta_bits |= zigzag_encode((uint32_t)src[index*stride] - (uint32_t)src[(index - 1)*stride]);
+	}
+
+	const int bit_width = get_bit_width(delta_bits);
+	const int32_t first_value = src[0];
+
+	memcpy(dst, &first_value, sizeof(int32_t));
+	dst[sizeof(int32_t)] = (uint8_t)bit_width;
+
+	uint8_t* write_ptr = dst + k_block_header_size;
+	uint64_t bit_buffer = 0;
+	int bit_count = 0;
+
+	if (bit_width > 0)
+	{
+		for (size_t index = 1; index < count; ++index)
+		{
+			const uint32_t packed = zigzag_encode((uint32_t)src[index*stride] - (uint32_t)src[(index - 1)*stride]);
+
+			bit_buffer |= (uint64_t)packed << bit_count;
+			bit_count += bit_width;
+
+			while (bit_count >= 8)
+			{
+				*write_ptr++ = (uint8_t)bit_buffer;
+				bit_buffer >>= 8;
+				bit_count -= 8;
+			}
+		}
+
+		if (bit_count > 0)
+		{
+			*write_ptr++ = (uint8_t)bit_buffer;
+		}
+	}
+
+	return (size_t)(write_ptr - dst);
+}
+
+size_t get_encoded_sample_block_size(const uint8_t* src, size_t count)
+{
+	if (count == 0)
+		return 0;
+
+	return k_block_header_size + get_packed_size(count - 1, src[sizeof(int32_t)]);
+}
+
+size_t decode_sample_block(const uint8_t* src, size_t count, int32_t* dst)
+{
+	if (count == 0)
+		return 0;
+
+	const int bit_width = src[sizeof(int32_t)];
+	const uint8_t* packed = src + k_block_header_size;
+
+	memcpy(&dst[0], src, sizeof(int32_t));
+
+	if (bit_width == 0)
+	{
+		// Flat block, every delta is zero
+		for (size_t index = 1; index < count; ++index)
+		{
+			dst[index] = dst[0];
+		}
+
+		return k_block_header_size;
+	}
+
+	// Pull each value out of a 64-bit window starting at its first byte.
+	// The window always covers the value since bit_width + 7 <= 39 bits.
+	const uint64_t mask = (bit_width >= 32) ? 0xffffffffull : ((1ull << bit_width) - 1);
+	size_t bit_offset = 0;
+
+	for (size_t index = 1; index < count; ++index)
+	{
+		uint64_t window;
+		memcpy(&window, packed + (bit_offset >> 3), sizeof(uint64_t));
+
+		dst[index] = (int32_t)(uint32_t)((window >> (bit_offset & 7)) & mask);
+		bit_offset += bit_width;
+	}
+
+	integrate_deltas(dst, count);
+
+	return k_block_header_size + get_packed_size(count - 1, bit_width);
+}
@@ -0,0 +1,33 @@
+#ifndef SAMPLE_BLOCK_CODEC_H
+#define SAMPLE_BLOCK_CODEC_H
+
+//-- includes -----
+#include <cstddef>
+#include <cstdint>
+
+//-- constants -----
+// Decoding reads whole 64-bit words, so up to this many bytes past the end of a block may be read (but never used)
+const size_t k_sample_block_read_slack = 8;
+
+//-- definitions -----
+// Lossless block codec for slowly varying integer sample streams (i.e. ECG and PPG waveforms).
+// A block is stored as its first value followed by the zigzag encoded deltas between neighboring
+// samples, bit-packed at the smallest width that holds the largest delta in the block:
+//   int32 first value | uint8 bit width | ((count-1) * bit width) bits of packed deltas
+// Neighboring waveform samples usually differ by only a few bits, so this is typically 4-8x
+// smaller than storing every sample as an int32.
+
+// Upper bound on the encoded size of a block of count samples
+size_t get_max_encoded_sample_block_size(size_t count);
+
+// Encode count samples read with the given stride (counted in int32s). Returns the number of bytes written.
+size_t encode_sample_block(const int32_t* src, size_t stride, size_t count, uint8_t* dst);
+
+// Size in bytes of an encoded block of count samples, without decoding it
+size_t get_encoded_sample_block_size(const uint8_t* src, size_t count);
+
+// Decode count samples into dst. Returns the number of bytes consumed.
+// The source must have k_sample_block_read_slack readable bytes past the end of the block.
+size_t decode_sample_block(const uint8_t* src, size_t count, int32_t* dst);
+
+#endif // SAMPLE_BLOCK_CODEC_H
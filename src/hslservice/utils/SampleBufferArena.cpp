@@ -0,0 +1,61 @@
+#include "SampleBufferArena.h"
+
+#include <assert.h>
+#include <cstring>
+
+//-- constants -----
+static const size_t k_partition_alignment = 64; // Keep partitions on separate cache lines
+
+//-- public implementation -----
+SampleBufferArena::SampleBufferArena(size_t partition_count, size_t partition_size)
+	: m_storage(nullptr)
+	, m_partitionSize(((partition_size + k_partition_alignment - 1) / k_partition_alignment) * k_partition_alignment)
+	, m_partitions(partition_count, 0)
+{
+	// Over allocate so the first partition can be aligned
+	const size_t total_size = m_partitionSize * partition_count + k_partition_alignment;
+
+	m_storage = new uint8_t[total_size];
+	memset(m_storage, 0, total_size);
+}
+
+SampleBufferArena::~SampleBufferArena()
+{
+	delete[] m_storage;
+}
+
+size_t SampleBufferArena::getPartitionBytesUsed(int partition_index) const
+{
+	assert(partition_index >= 0 && partition_index < (int)m_partitions.size());
+
+	return m_partitions[partition_index];
+}
+
+void SampleBufferArena::resetPartition(int partition_index)
+{
+	assert(partition_index >= 0 && partition_index < (int)m_partitions.size());
+
+	m_partitions[partition_index] = 0;
+}
+
+void* SampleBufferArena::allocate(int partition_index, size_t size, size_t alignment)
+{
+	if (partition_index < 0 || partition_index >= (int)m_partitions.size() || size == 0)
+		return nullptr;
+
+	const uintptr_t storage_base =
+		((uintptr_t)m_storage + k_partition_alignment - 1) & ~(uintptr_t)(k_partition_alignment - 1);
+	const uintptr_t partition_base = storage_base + (uintptr_t)partition_index * m_partitionSize;
+	const uintptr_t partition_end = partition_base + m_partitionSize;
+
+	// Bump allocate the next aligned block in the partition
+	const uintptr_t block_start =
+		(partition_base + m_partitions[partition_index] + alignment - 1) & ~(uintptr_t)(alignment - 1);
+
+	if (block_start + size > partition_end)
+		return nullptr;
+
+	m_partitions[partition_index] = (size_t)(block_start + size - partition_base);
+
+	return (void*)block_start;
+}
@@ -0,0 +1,62 @@
+#ifndef SAMPLE_BUFFER_ARENA_H
+#define SAMPLE_BUFFER_ARENA_H
+
+//-- includes -----
+#include "SequencedRingBuffer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//-- definitions -----
+// A single up-front allocation that sample ring storage is carved out of.
+// The arena is split into equal sized partitions (i.e. one per sensor slot per owner)
+// and each partition is a bump allocator that is reset as a whole whenever its owner
+// lays out its rings again (i.e. when a sensor is opened with new sample rates).
+// After startup connecting and reconnecting devices causes no heap traffic for sample storage.
+class SampleBufferArena
+{
+public:
+	SampleBufferArena(size_t partition_count, size_t partition_size);
+	virtual ~SampleBufferArena();
+
+	inline size_t getPartitionCount() const { return m_partitions.size(); }
+	inline size_t getPartitionSize() const { return m_partitionSize; }
+	size_t getPartitionBytesUsed(int partition_index) const;
+
+	// Forget every allocation made from the partition.
+	// Any ring still pointing at the partition must be given new storage before it is used again.
+	void resetPartition(int partition_index);
+
+	// Returns nullptr if the partition doesn't have room
+	void* allocate(int partition_index, size_t size, size_t alignment);
+
+	// Point the ring at a block of the partition big enough for the given capacity, dropping its current items.
+	// Falls back to giving the ring its own heap storage if the partition is full.
+	// Returns false if the fallback was used.
+	template <typename t_item>
+	bool assignRingStorage(int partition_index, SequencedRingBuffer<t_item>& ring, size_t capacity)
+	{
+		t_item* storage = (t_item*)allocate(partition_index, sizeof(t_item)*capacity, alignof(t_item));
+
+		if (storage != nullptr)
+		{
+			ring.setStorage(storage, capacity);
+			return true;
+		}
+		else
+		{
+			// The ring's old storage may already belong to someone else, don't copy anything out of it
+			ring.reset();
+			ring.setCapacity(capacity);
+			return false;
+		}
+	}
+
+protected:
+	uint8_t* m_storage;
+	size_t m_partitionSize;
+	std::vector<size_t> m_partitions; // Bytes used in each partition
+};
+
+#endif // SAMPLE_BUFFER_ARENA_H
@@ -0,0 +1,80 @@
+#ifndef SAMPLE_HISTORY_FILE_H
+#define SAMPLE_HISTORY_FILE_H
+
+//-- includes -----
+#include "MemoryMappedFile.h"
+#include "SequencedRingBuffer.h"
+
+#include <string>
+
+//-- definitions -----
+// Cold tier behind an in-memory sample ring: a sequenced ring whose storage is a memory mapped file.
+// Frames are appended as they arrive in the hot ring and keep the same sequence numbers,
+// so the usual buffer iterators can reach back into hours of history that mostly lives on disk.
+// The file is a fixed size circular log, so disk use is bounded by the configured duration.
+template <typename t_item>
+class SampleHistoryFile
+{
+public:
+	SampleHistoryFile()
+		: m_ring(1)
+	{
+	}
+
+	virtual ~SampleHistoryFile()
+	{
+		close();
+	}
+
+	// Map a history file big enough for the given number of frames.
+	// Reopening the same file at the same capacity keeps the history collected so far.
+	bool open(const std::string &path, size_t capacity)
+	{
+		if (m_file.getIsOpen() && m_file.getPath() == path && m_ring.getCapacity() == capacity)
+			return true;
+
+		close();
+
+		if (!m_file.open(path, sizeof(t_item)*capacity))
+			return false;
+
+		// The new file is zero filled already, don't fault in every page clearing it
+		m_ring.setStorage(reinterpret_cast<t_item*>(m_file.getData()), capacity, false);
+
+		return true;
+	}
+
+	void close()
+	{
+		if (m_file.getIsOpen())
+		{
+			// Move the ring off the mapping before it goes away
+			m_ring.reset();
+			m_ring.setCapacity(1);
+			m_file.close();
+		}
+	}
+
+	inline bool getIsOpen() const { return m_file.getIsOpen(); }
+
+	// Copy over any frames in the hot ring not yet in the history
+	void appendFrom(const SequencedRingBuffer<t_item> &source)
+	{
+		if (m_file.getIsOpen())
+		{
+			uint64_t lost_count= 0;
+			m_ring.copyItemsSince(source, m_ring.getHeadSequence(), lost_count);
+		}
+	}
+
+	SequencedRingBuffer<t_item> *getBuffer()
+	{
+		return m_file.getIsOpen() ? &m_ring : nullptr;
+	}
+
+private:
+	MemoryMappedFile m_file;
+	SequencedRingBuffer<t_item> m_ring;
+};
+
+#endif // SAMPLE_HISTORY_FILE_H
@@ -0,0 +1,339 @@
+//-- includes -----
+#include "SamplePyramid.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <limits>
+
+//-- constants -----
+static const size_t k_max_pyramid_levels = 16;
+
+//-- private methods -----
+// Running summary of a run of whole buckets (and/or a partial bucket) of one channel
+struct BucketMerger
+{
+	double startTime;
+	double endTime;
+	float minValue;
+	float maxValue;
+	double sum;
+	uint32_t sampleCount;
+
+	void reset()
+	{
+		startTime = 0.0;
+		endTime = 0.0;
+		minValue = std::numeric_limits<float>::max();
+		maxValue = -std::numeric_limits<float>::max();
+		sum = 0.0;
+		sampleCount = 0;
+	}
+
+	void merge(double start_time, double end_time, float min_value, float max_value, double bucket_sum, uint32_t sample_count)
+	{
+		if (sample_count == 0)
+			return;
+
+		if (sampleCount == 0)
+		{
+			startTime = start_time;
+		}
+
+		endTime = end_time;
+		minValue = std::min(minValue, min_value);
+		maxValue = std::max(maxValue, max_value);
+		sum += bucket_sum;
+		sampleCount += sample_count;
+	}
+
+	void write(HSLSampleBucket& out_bucket) const
+	{
+		out_bucket.startTime = startTime;
+		out_bucket.endTime = endTime;
+		out_bucket.minValue = minValue;
+		out_bucket.maxValue = maxValue;
+		out_bucket.meanValue = (float)(sum / (double)sampleCount);
+		out_bucket.sampleCount = sampleCount;
+	}
+};
+
+//-- public implementation -----
+SamplePyramid::SamplePyramid(size_t channel_count)
+	: m_channelCount(channel_count)
+{
+}
+
+void SamplePyramid::setCapacity(size_t sample_capacity)
+{
+	m_levels.clear();
+
+	size_t level_capacity = (sample_capacity + k_base_bucket_size - 1) / k_base_bucket_size;
+
+	// Stop once a level would only hold a couple of buckets
+	while (level_capacity >= 2 && m_levels.size() < k_max_pyramid_levels)
+	{
+		Level level;
+		level.capacity = level_capacity;
+		level.startTimes.resize(level_capacity);
+		level.endTimes.resize(level_capacity);
+		level.sampleCounts.resize(level_capacity);
+		level.minValues.resize(level_capacity * m_channelCount);
+		level.maxValues.resize(level_capacity * m_channelCount);
+		level.sums.resize(level_capacity * m_channelCount);
+		level.pending.minValues.resize(m_channelCount);
+		level.pending.maxValues.resize(m_channelCount);
+		level.pending.sums.resize(m_channelCount);
+
+		m_levels.push_back(std::move(level));
+		level_capacity = (level_capacity + k_level_fanout - 1) / k_level_fanout;
+	}
+
+	reset();
+}
+
+void SamplePyramid::reset()
+{
+	for (Level& level : m_levels)
+	{
+		level.headIndex = 0;
+		level.pendingChildCount = 0;
+		resetAccumulator(level.pending);
+	}
+}
+
+void SamplePyramid::appendSample(double time, const float* channel_values)
+{
+	if (m_levels.empty())
+		return;
+
+	Accumulator& bucket = m_levels[0].pending;
+
+	if (bucket.sampleCount == 0)
+	{
+		bucket.startTime = time;
+	}
+
+	bucket.endTime = time;
+	++bucket.sampleCount;
+
+	for (size_t channel = 0; channel < m_channelCount; ++channel)
+	{
+		const float value = channel_values[channel];
+
+		bucket.minValues[channel] = std::min(bucket.minValues[channel], value);
+		bucket.maxValues[channel] = std::max(bucket.maxValues[channel], value);
+		bucket.sums[channel] += value;
+	}
+
+	if (bucket.sampleCount >= k_base_bucket_size)
+	{
+		pushBucket(0, bucket);
+		resetAccumulator(bucket);
+	}
+}
+
+size_t SamplePyramid::getBuckets(
+	int channel,
+	double start_time,
+	double end_time,
+	HSLSampleBucket* out_buckets,
+	size_t max_buckets) const
+{
+	if (m_levels.empty() || channel < 0 || channel >= (int)m_channelCount || max_buckets == 0 || end_time < start_time)
+		return 0;
+
+	// Pick the finest level that covers the range in no more than k_level_fanout * max_buckets buckets,
+	// then merge neighbors down to max_buckets. This bounds the work by the number of buckets asked for.
+	// Each level also has a partial bucket covering the samples not yet summarized at that level.
+	size_t level_index = 0;
+	uint64_t first_bucket = 0;
+	uint64_t end_bucket = 0;
+	BucketMerger tail;
+
+	for (; level_index < m_levels.size(); ++level_index)
+	{
+		const Level& level = m_levels[level_index];
+
+		first_bucket = findFirstBucketEndingAfter(level, start_time);
+		end_bucket = std::max(findFirstBucketStartingAfter(level, end_time), first_bucket);
+
+		// The partial bucket at this level is made up of the pending buckets at every level up to it
+		tail.reset();
+		for (size_t pending_index = level_index + 1; pending_index-- > 0; )
+		{
+			const Accumulator& pending = m_levels[pending_index].pending;
+
+			tail.merge(
+				pending.startTime, pending.endTime, 
+				pending.minValues[channel], pending.maxValues[channel], pending.sums[channel], 
+				pending.sampleCount);
+		}
+
+		const bool bTailInRange = tail.sampleCount > 0 && tail.endTime >= start_time && tail.startTime <= end_time;
+		const uint64_t bucket_count = (end_bucket - first_bucket) + (bTailInRange ? 1 : 0);
+
+		if (bucket_count <= max_buckets * k_level_fanout || level_index + 1 == m_levels.size())
+		{
+			if (!bTailInRange)
+			{
+				tail.reset();
+			}
+
+			break;
+		}
+	}
+
+	const Level& level = m_levels[level_index];
+	const uint64_t bucket_count = (end_bucket - first_bucket) + (tail.sampleCount > 0 ? 1 : 0);
+
+	// Spread the buckets at the chosen level evenly over at most max_buckets output buckets
+	size_t out_count = 0;
+	size_t out_index = 0;
+	BucketMerger merger;
+	merger.reset();
+
+	for (uint64_t bucket_index = first_bucket; bucket_index < end_bucket; ++bucket_index)
+	{
+		const size_t target_index = (size_t)((bucket_index - first_bucket) * max_buckets / bucket_count);
+
+		if (target_index != out_index && merger.sampleCount > 0)
+		{
+			merger.write(out_buckets[out_count++]);
+			merger.reset();
+		}
+		out_index = target_index;
+
+		const size_t slot = (size_t)(bucket_index % level.capacity);
+		const size_t value_index = slot * m_channelCount + channel;
+
+		merger.merge(
+			level.startTimes[slot], level.endTimes[slot],
+			level.minValues[value_index], level.maxValues[value_index], level.sums[value_index],
+			level.sampleCounts[slot]);
+	}
+
+	// The partial bucket is always last
+	if (tail.sampleCount > 0)
+	{
+		const size_t target_index = (size_t)((end_bucket - first_bucket) * max_buckets / bucket_count);
+
+		if (target_index != out_index && merger.sampleCount > 0)
+		{
+			merger.write(out_buckets[out_count++]);
+			merger.reset();
+		}
+
+		merger.merge(tail.startTime, tail.endTime, tail.minValue, tail.maxValue, tail.sum, tail.sampleCount);
+	}
+
+	if (merger.sampleCount > 0)
+	{
+		merger.write(out_buckets[out_count++]);
+	}
+
+	return out_count;
+}
+
+//-- protected methods -----
+void SamplePyramid::resetAccumulator(Accumulator& accumulator) const
+{
+	accumulator.startTime = 0.0;
+	accumulator.endTime = 0.0;
+	accumulator.sampleCount = 0;
+	std::fill(accumulator.minValues.begin(), accumulator.minValues.end(), std::numeric_limits<float>::max());
+	std::fill(accumulator.maxValues.begin(), accumulator.maxValues.end(), -std::numeric_limits<float>::max());
+	std::fill(accumulator.sums.begin(), accumulator.sums.end(), 0.0);
+}
+
+void SamplePyramid::pushBucket(size_t level_index, const Accumulator& bucket)
+{
+	Level& level = m_levels[level_index];
+	const size_t slot = (size_t)(level.headIndex % level.capacity);
+
+	level.startTimes[slot] = bucket.startTime;
+	level.endTimes[slot] = bucket.endTime;
+	level.sampleCounts[slot] = bucket.sampleCount;
+
+	for (size_t channel = 0; channel < m_channelCount; ++channel)
+	{
+		level.minValues[slot * m_channelCount + channel] = bucket.minValues[channel];
+		level.maxValues[slot * m_channelCount + channel] = bucket.maxValues[channel];
+		level.sums[slot * m_channelCount + channel] = bucket.sums[channel];
+	}
+
+	++level.headIndex;
+
+	if (level_index + 1 >= m_levels.size())
+		return;
+
+	// Fold the finished bucket into the next level up
+	Level& parent = m_levels[level_index + 1];
+	Accumulator& parent_bucket = parent.pending;
+
+	if (parent_bucket.sampleCount == 0)
+	{
+		parent_bucket.startTime = bucket.startTime;
+	}
+
+	parent_bucket.endTime = bucket.endTime;
+	parent_bucket.sampleCount += bucket.sampleCount;
+
+	for (size_t channel = 0; channel < m_channelCount; ++channel)
+	{
+		parent_bucket.minValues[channel] = std::min(parent_bucket.minValues[channel], bucket.minValues[channel]);
+		parent_bucket.maxValues[channel] = std::max(parent_bucket.maxValues[channel], bucket.maxValues[channel]);
+		parent_bucket.sums[channel] += bucket.sums[channel];
+	}
+
+	if (++parent.pendingChildCount >= k_level_fanout)
+	{
+		pushBucket(level_index + 1, parent_bucket);
+		resetAccumulator(parent_bucket);
+		parent.pendingChildCount = 0;
+	}
+}
+
+// Bucket times never decrease within a level, so both ends of a range can be binary searched
+uint64_t SamplePyramid::findFirstBucketEndingAfter(const Level& level, double time) const
+{
+	uint64_t low = level.headIndex - std::min<uint64_t>(level.headIndex, level.capacity);
+	uint64_t high = level.headIndex;
+
+	while (low < high)
+	{
+		const uint64_t mid = low + (high - low) / 2;
+
+		if (level.endTimes[(size_t)(mid % level.capacity)] < time)
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+
+	return low;
+}
+
+uint64_t SamplePyramid::findFirstBucketStartingAfter(const Level& level, double time) const
+{
+	uint64_t low = level.headIndex - std::min<uint64_t>(level.headIndex, level.capacity);
+	uint64_t high = level.headIndex;
+
+	while (low < high)
+	{
+		const uint64_t mid = low + (high - low) / 2;
+
+		if (level.startTimes[(size_t)(mid % level.capacity)] <= time)
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+
+	return low;
+}
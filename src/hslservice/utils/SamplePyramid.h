@@ -0,0 +1,76 @@
+#ifndef SAMPLE_PYRAMID_H
+#define SAMPLE_PYRAMID_H
+
+//-- includes -----
+#include "HSLClient_CAPI.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//-- definitions -----
+// Incrementally maintained min/max/mean pyramid over a multi-channel sample stream, for plotting long histories.
+// Level 0 summarizes every k_base_bucket_size samples and each level above summarizes k_level_fanout
+// buckets of the level below. Every level is a ring covering (about) the same span of samples,
+// so a time range query can pick the coarsest level that still gives the caller enough buckets
+// and the cost of a query scales with the number of buckets asked for rather than the number of samples.
+// Appends and queries must happen on the same thread.
+class SamplePyramid
+{
+public:
+	static const size_t k_base_bucket_size = 8;
+	static const size_t k_level_fanout = 4;
+
+	SamplePyramid(size_t channel_count);
+
+	inline size_t getChannelCount() const { return m_channelCount; }
+	inline size_t getLevelCount() const { return m_levels.size(); }
+
+	// Size the pyramid to summarize the newest sample_capacity samples, dropping everything in it.
+	// A capacity of 0 disables the pyramid.
+	void setCapacity(size_t sample_capacity);
+	void reset();
+
+	// Add one sample with a value for every channel
+	void appendSample(double time, const float* channel_values);
+
+	// Summarize the samples of one channel in [start_time, end_time] with at most max_buckets buckets.
+	// Returns the number of buckets written.
+	size_t getBuckets(int channel, double start_time, double end_time, HSLSampleBucket* out_buckets, size_t max_buckets) const;
+
+protected:
+	// Running summary of the samples in a bucket that isn't finished yet
+	struct Accumulator
+	{
+		double startTime;
+		double endTime;
+		uint32_t sampleCount;
+		std::vector<float> minValues;
+		std::vector<float> maxValues;
+		std::vector<double> sums;
+	};
+
+	struct Level
+	{
+		size_t capacity;
+		uint64_t headIndex; // Total number of buckets ever written to this level
+		std::vector<double> startTimes;
+		std::vector<double> endTimes;
+		std::vector<uint32_t> sampleCounts;
+		std::vector<float> minValues; // [bucket * channel count + channel]
+		std::vector<float> maxValues;
+		std::vector<double> sums;
+		Accumulator pending;
+		size_t pendingChildCount;
+	};
+
+	void resetAccumulator(Accumulator& accumulator) const;
+	void pushBucket(size_t level_index, const Accumulator& bucket);
+	uint64_t findFirstBucketEndingAfter(const Level& level, double time) const;
+	uint64_t findFirstBucketStartingAfter(const Level& level, double time) const;
+
+	size_t m_channelCount;
+	std::vector<Level> m_levels;
+};
+
+#endif // SAMPLE_PYRAMID_H
@@ -0,0 +1,90 @@
+#ifndef SAMPLE_UNPACKING_H
+#define SAMPLE_UNPACKING_H
+
+//-- includes -----
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define HSL_HAS_SSE2 1
+	#include <emmintrin.h>
+#endif
+
+//-- definitions -----
+// Helpers for flattening sample frames into contiguous struct-of-arrays buffers.
+// The loops are kept branch free over contiguous data so the compiler can vectorize them.
+
+// Sign extend raw 24-bit samples (held in the low bytes of a uint32) and convert them to float
+inline void unpack_int24_samples(const uint32_t* src, float* dst, size_t count)
+{
+	size_t index = 0;
+
+#if HSL_HAS_SSE2
+	for (; index + 4 <= count; index += 4)
+	{
+		__m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + index));
+		__m128i extended = _mm_srai_epi32(_mm_slli_epi32(raw, 8), 8);
+
+		_mm_storeu_ps(dst + index, _mm_cvtepi32_ps(extended));
+	}
+#endif
+
+	for (; index < count; ++index)
+	{
+		dst[index] = (float)((int32_t)(src[index] << 8) >> 8);
+	}
+}
+
+// Pull one channel out of an array of interleaved int32 samples (stride counted in int32s)
+inline void gather_int32_samples(const int32_t* src, size_t stride, float* dst, size_t count)
+{
+	for (size_t index = 0; index < count; ++index)
+	{
+		dst[index] = (float)src[index * stride];
+	}
+}
+
+// Pull one channel out of an array of interleaved float samples (stride counted in floats)
+inline void gather_float_samples(const float* src, size_t stride, float* dst, size_t count)
+{
+	for (size_t index = 0; index < count; ++index)
+	{
+		dst[index] = src[index * stride];
+	}
+}
+
+// Per-sample timestamps for a fixed rate frame
+inline void fill_linear_times(double start_time, double time_delta, double* dst, size_t count)
+{
+	size_t index = 0;
+
+#if HSL_HAS_SSE2
+	const __m128d start = _mm_set1_pd(start_time);
+	const __m128d delta = _mm_set1_pd(time_delta);
+	const __m128d two = _mm_set1_pd(2.0);
+	__m128d indices = _mm_set_pd(1.0, 0.0);
+
+	// Same start + index*delta as the scalar tail, so the SIMD path doesn't accumulate drift
+	for (; index + 2 <= count; index += 2)
+	{
+		_mm_storeu_pd(dst + index, _mm_add_pd(start, _mm_mul_pd(indices, delta)));
+		indices = _mm_add_pd(indices, two);
+	}
+#endif
+
+	for (; index < count; ++index)
+	{
+		dst[index] = start_time + (double)index * time_delta;
+	}
+}
+
+// Same timestamp for every sample in a frame
+inline void fill_constant_times(double time, double* dst, size_t count)
+{
+	for (size_t index = 0; index < count; ++index)
+	{
+		dst[index] = time;
+	}
+}
+
+#endif // SAMPLE_UNPACKING_H
@@ -0,0 +1,351 @@
+#ifndef SEQUENCED_RING_BUFFER_H
+#define SEQUENCED_RING_BUFFER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+// Sequence bookkeeping shared by every SequencedRingBuffer<T>.
+// Kept free of the item type so that readers holding only an opaque pointer
+// (i.e. a client HSLBufferIterator) can check if the writer lapped them.
+class SequencedRingBufferState
+{
+public:
+	SequencedRingBufferState(size_t capacity)
+		: m_capacity(capacity)
+		, m_headSequence(0)
+		, m_claimSequence(0)
+		, m_tailFloorSequence(0)
+		, m_generation(0)
+	{
+	}
+
+	size_t getCapacity() const
+	{
+		return m_capacity;
+	}
+
+	// The sequence number the next written item will get (i.e. the total number of items ever written)
+	uint64_t getHeadSequence() const
+	{
+		return m_headSequence.load(std::memory_order_acquire);
+	}
+
+	// The sequence number of the oldest item still held in the buffer
+	uint64_t getTailSequence() const
+	{
+		const uint64_t head= m_headSequence.load(std::memory_order_acquire);
+		const uint64_t oldest_in_ring= head - std::min<uint64_t>(head, m_capacity);
+
+		return std::max(oldest_in_ring, m_tailFloorSequence.load(std::memory_order_acquire));
+	}
+
+	// The oldest sequence number that is guaranteed not to be mid-overwrite.
+	// Readers call this after copying to validate what they copied.
+	uint64_t getFirstStableSequence() const
+	{
+		std::atomic_thread_fence(std::memory_order_acquire);
+		const uint64_t claim= m_claimSequence.load(std::memory_order_relaxed);
+
+		return claim - std::min<uint64_t>(claim, m_capacity);
+	}
+
+	// Bumped whenever the item storage is reallocated.
+	// Any pointer into the old storage is dangling once this changes.
+	uint32_t getGeneration() const
+	{
+		return m_generation.load(std::memory_order_acquire);
+	}
+
+protected:
+	void beginWrite(uint64_t new_head)
+	{
+		m_claimSequence.store(new_head, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+	}
+
+	void endWrite(uint64_t new_head)
+	{
+		m_headSequence.store(new_head, std::memory_order_release);
+	}
+
+	size_t m_capacity;
+	std::atomic<uint64_t> m_headSequence;
+	std::atomic<uint64_t> m_claimSequence;
+	std::atomic<uint64_t> m_tailFloorSequence;
+	std::atomic<uint32_t> m_generation;
+};
+
+// Single producer / multi reader ring buffer of POD items.
+// Every item written is tagged with a monotonically increasing 64-bit sequence number
+// (the item lives at index sequence % capacity), so "everything since sequence N"
+// can be located in O(1) and copied out in at most two contiguous spans.
+// Publication is seqlock-style: the writer announces the range it is about to overwrite
+// in m_claimSequence before touching the slots and publishes it in m_headSequence after.
+// A reader snapshots the head, copies, then re-checks the claim to find out if
+// the writer lapped it during the copy.
+template <typename T>
+class SequencedRingBuffer : public SequencedRingBufferState
+{
+public:
+	explicit SequencedRingBuffer(size_t initial_capacity)
+		: SequencedRingBufferState(initial_capacity)
+		, m_buffer(new T[initial_capacity])
+		, m_bOwnsBuffer(true)
+	{
+		memset(m_buffer, 0, sizeof(T)*initial_capacity);
+	}
+
+	~SequencedRingBuffer()
+	{
+		freeBuffer();
+	}
+
+	// -- Writer -----
+	void writeItem(const T& item)
+	{
+		const uint64_t head= m_headSequence.load(std::memory_order_relaxed);
+
+		beginWrite(head + 1);
+		m_buffer[head % m_capacity]= item;
+		endWrite(head + 1);
+	}
+
+	void writeItems(const T* items, size_t item_count)
+	{
+		if (item_count == 0)
+			return;
+
+		const uint64_t head= m_headSequence.load(std::memory_order_relaxed);
+		const uint64_t new_head= head + item_count;
+
+		// Only the newest capacity items can survive the write
+		const size_t copy_count= std::min(item_count, m_capacity);
+		const T* copy_source= items + (item_count - copy_count);
+
+		beginWrite(new_head);
+		copyIntoSlots(new_head - copy_count, copy_source, copy_count);
+		endWrite(new_head);
+	}
+
+	// Drop all of the items currently in the buffer.
+	// Sequence numbers keep counting up from where they were.
+	void reset()
+	{
+		m_tailFloorSequence.store(m_headSequence.load(std::memory_order_relaxed), std::memory_order_release);
+	}
+
+	void setCapacity(size_t new_capacity)
+	{
+		// Always move off of borrowed storage, even when the capacity matches
+		if (new_capacity <= 0 || (new_capacity == m_capacity && m_bOwnsBuffer))
+			return;
+
+		T *new_buffer = new T[new_capacity];
+		memset(new_buffer, 0, sizeof(T)*new_capacity);
+
+		// Keep as many of the newest items as will fit,
+		// placed at the same sequence numbers in the new buffer
+		const uint64_t head= getHeadSequence();
+		const uint64_t tail= std::max(getTailSequence(), head - std::min<uint64_t>(head, new_capacity));
+
+		for (uint64_t sequence= tail; sequence < head; ++sequence)
+		{
+			new_buffer[sequence % new_capacity]= m_buffer[sequence % m_capacity];
+		}
+
+		freeBuffer();
+		m_buffer = new_buffer;
+		m_bOwnsBuffer = true;
+		m_capacity = new_capacity;
+		m_tailFloorSequence.store(tail, std::memory_order_release);
+		m_generation.fetch_add(1, std::memory_order_release);
+	}
+
+	// Switch over to externally owned storage (i.e. carved out of an arena), dropping the current items.
+	// The old storage may be handed out again to another ring, so nothing is copied out of it.
+	// Sequence numbers keep counting up from where they were.
+	// Storage known to already be zeroed (i.e. a freshly mapped file) can skip the clear.
+	void setStorage(T* storage, size_t capacity, bool bClearStorage= true)
+	{
+		if (storage == nullptr || capacity <= 0)
+			return;
+
+		freeBuffer();
+		if (bClearStorage)
+		{
+			memset(storage, 0, sizeof(T)*capacity);
+		}
+
+		m_buffer = storage;
+		m_bOwnsBuffer = false;
+		m_capacity = capacity;
+		m_tailFloorSequence.store(m_headSequence.load(std::memory_order_relaxed), std::memory_order_release);
+		m_generation.fetch_add(1, std::memory_order_release);
+	}
+
+	bool getOwnsStorage() const
+	{
+		return m_bOwnsBuffer;
+	}
+
+	// -- Reader -----
+	bool isEmpty() const
+	{
+		return getSize() == 0;
+	}
+
+	bool isFull() const
+	{
+		return getSize() == m_capacity;
+	}
+
+	T* getBuffer() const
+	{
+		return m_buffer;
+	}
+
+	size_t getSize() const
+	{
+		return (size_t)(getHeadSequence() - getTailSequence());
+	}
+
+	size_t getWriteIndex() const
+	{
+		return (size_t)(getHeadSequence() % m_capacity);
+	}
+
+	size_t getReadIndex() const
+	{
+		return (size_t)(getTailSequence() % m_capacity);
+	}
+
+	size_t getIndexOfSequence(uint64_t sequence) const
+	{
+		return (size_t)(sequence % m_capacity);
+	}
+
+	// Returns the most recently written item or nullptr if the buffer is empty
+	const T* getNewestItem() const
+	{
+		return isEmpty() ? nullptr : &m_buffer[(getHeadSequence() - 1) % m_capacity];
+	}
+
+	// Binary search for the first sequence in [tail, head) whose item satisfies the predicate.
+	// The predicate must be false for some prefix of the buffer and true for the rest
+	// (i.e. "timestamp >= t" over items with non-decreasing timestamps).
+	// Returns the head sequence if no item satisfies it.
+	template <typename t_predicate>
+	uint64_t findFirstSequence(t_predicate predicate) const
+	{
+		uint64_t low= getTailSequence();
+		uint64_t high= getHeadSequence();
+
+		while (low < high)
+		{
+			const uint64_t mid= low + (high - low) / 2;
+
+			if (predicate(m_buffer[mid % m_capacity]))
+			{
+				high= mid;
+			}
+			else
+			{
+				low= mid + 1;
+			}
+		}
+
+		return low;
+	}
+
+	// Mirror every item the source ring has published since the given cursor into this ring.
+	// Sequence numbers in this ring are kept in step with the source ring,
+	// so the cursor for the next call is just getHeadSequence().
+	// Returns the number of items copied.
+	// out_lost_count gets the number of items the source overwrote before we could copy them.
+	size_t copyItemsSince(const SequencedRingBuffer<T>& source, uint64_t cursor, uint64_t& out_lost_count)
+	{
+		const uint64_t source_head= source.getHeadSequence();
+		uint64_t start= std::max(cursor, source.getTailSequence());
+
+		// Don't bother copying anything that won't fit in our ring
+		if (source_head - start > m_capacity)
+		{
+			start= source_head - m_capacity;
+		}
+
+		const size_t copy_count= (size_t)(source_head - start);
+		out_lost_count= start - std::min(start, cursor);
+
+		if (copy_count == 0)
+			return 0;
+
+		// Jump over any gap so our sequence numbers line up with the source
+		if (m_headSequence.load(std::memory_order_relaxed) != start)
+		{
+			beginWrite(start);
+			m_tailFloorSequence.store(start, std::memory_order_release);
+			endWrite(start);
+		}
+
+		beginWrite(source_head);
+		for (uint64_t sequence= start; sequence < source_head; )
+		{
+			const size_t source_index= source.getIndexOfSequence(sequence);
+			const size_t target_index= getIndexOfSequence(sequence);
+			const size_t span= (size_t)std::min<uint64_t>(
+				source_head - sequence,
+				std::min(source.getCapacity() - source_index, m_capacity - target_index));
+
+			memcpy(&m_buffer[target_index], &source.getBuffer()[source_index], sizeof(T)*span);
+			sequence+= span;
+		}
+		endWrite(source_head);
+
+		// Seqlock validation: anything the source writer claimed while we were copying is torn
+		const uint64_t first_valid= source.getFirstStableSequence();
+		if (first_valid > start)
+		{
+			const uint64_t torn_count= std::min<uint64_t>(first_valid - start, copy_count);
+
+			m_tailFloorSequence.store(start + torn_count, std::memory_order_release);
+			out_lost_count+= torn_count;
+
+			return copy_count - (size_t)torn_count;
+		}
+
+		return copy_count;
+	}
+
+private:
+	void freeBuffer()
+	{
+		if (m_bOwnsBuffer)
+		{
+			delete[] m_buffer;
+		}
+
+		m_buffer= nullptr;
+	}
+
+	void copyIntoSlots(uint64_t first_sequence, const T* items, size_t item_count)
+	{
+		const size_t start_index= getIndexOfSequence(first_sequence);
+		const size_t upper_count= std::min(item_count, m_capacity - start_index);
+
+		memcpy(&m_buffer[start_index], items, sizeof(T)*upper_count);
+		if (upper_count < item_count)
+		{
+			memcpy(&m_buffer[0], items + upper_count, sizeof(T)*(item_count - upper_count));
+		}
+	}
+
+	T* m_buffer;
+	bool m_bOwnsBuffer;
+
+	SequencedRingBuffer(const SequencedRingBuffer &copy) = delete;
+	SequencedRingBuffer &operator=(const SequencedRingBuffer &copy) = delete;
+};
+
+#endif // SEQUENCED_RING_BUFFER_H
@@ -0,0 +1,138 @@
+//-- includes -----
+#include "StreamClockModel.h"
+
+#include <cmath>
+
+//-- constants -----
+// Roughly the last thousand packets (several minutes of ECG) contribute to the period fit,
+// long enough to average out BLE jitter but short enough to follow crystal drift with temperature
+static const double k_clock_fit_forgetting_factor = 0.999;
+
+// A period estimate further than this from nominal means a bad fit (i.e. a timestamp glitch), not drift
+static const double k_max_sample_period_error = 0.05;
+
+//-- WeightedLinearFit -----
+WeightedLinearFit::WeightedLinearFit(double forgetting_factor)
+	: m_forgettingFactor(forgetting_factor)
+{
+	reset();
+}
+
+void WeightedLinearFit::reset()
+{
+	m_weight = 0.0;
+	m_meanX = 0.0;
+	m_meanY = 0.0;
+	m_varianceX = 0.0;
+	m_covarianceXY = 0.0;
+	m_pointCount = 0;
+}
+
+void WeightedLinearFit::addPoint(double x, double y)
+{
+	// Decay the old points, then fold in the new one with weight 1
+	m_weight = m_forgettingFactor*m_weight + 1.0;
+	m_varianceX *= m_forgettingFactor;
+	m_covarianceXY *= m_forgettingFactor;
+
+	const double dx = x - m_meanX;
+	const double dy = y - m_meanY;
+
+	m_meanX += dx / m_weight;
+	m_meanY += dy / m_weight;
+	m_varianceX += dx * (x - m_meanX);
+	m_covarianceXY += dx * (y - m_meanY);
+	m_pointCount++;
+}
+
+double WeightedLinearFit::getSlope(double default_slope) const
+{
+	return getHasSlope() ? m_covarianceXY / m_varianceX : default_slope;
+}
+
+double WeightedLinearFit::evaluate(double x, double default_slope) const
+{
+	return m_meanY + getSlope(default_slope) * (x - m_meanX);
+}
+
+double WeightedLinearFit::evaluateInverse(double y, double default_slope) const
+{
+	const double slope = getSlope(default_slope);
+
+	return (slope != 0.0) ? m_meanX + (y - m_meanY) / slope : m_meanX;
+}
+
+//-- StreamClockModel -----
+StreamClockModel::StreamClockModel()
+	: m_periodFit(k_clock_fit_forgetting_factor)
+{
+	reset(0.0);
+}
+
+void StreamClockModel::reset(double nominal_sample_rate)
+{
+	m_nominalSampleRate = nominal_sample_rate;
+	m_bHasPackets = false;
+	m_firstTimestamp = 0;
+	m_lastTimestamp = 0;
+	m_lastSampleIndex = 0;
+	m_streamStartOffset = 0.0;
+	m_packetFirstSampleTime = 0.0;
+	m_periodFit.reset();
+}
+
+double StreamClockModel::getSamplePeriod() const
+{
+	const double nominal_period = (m_nominalSampleRate > 0.0) ? 1.0 / m_nominalSampleRate : 0.0;
+	const double fit_period = m_periodFit.getSlope(nominal_period);
+
+	if (nominal_period > 0.0 && fabs(fit_period - nominal_period) > nominal_period * k_max_sample_period_error)
+		return nominal_period;
+
+	return fit_period;
+}
+
+void StreamClockModel::addPacket(uint64_t device_timestamp_ns, size_t sample_count)
+{
+	if (sample_count == 0)
+		return;
+
+	if (m_bHasPackets && device_timestamp_ns <= m_lastTimestamp)
+	{
+		// The device clock went backwards (i.e. the sensor rebooted mid stream), start the model over
+		reset(m_nominalSampleRate);
+	}
+
+	if (!m_bHasPackets)
+	{
+		m_bHasPackets = true;
+		m_firstTimestamp = device_timestamp_ns;
+		m_lastSampleIndex = sample_count - 1;
+
+		// Put stream time zero on the first sample of the first packet
+		m_streamStartOffset = (double)(sample_count - 1) * getSamplePeriod();
+	}
+	else
+	{
+		// Any time beyond what this packet's samples account for means packets were lost
+		const double period = getSamplePeriod();
+		const double elapsed = (double)(device_timestamp_ns - m_lastTimestamp) * 1e-9;
+		const double missing_samples = (period > 0.0) ? elapsed / period - (double)sample_count : 0.0;
+
+		if (missing_samples >= 0.5)
+		{
+			m_lastSampleIndex += (uint64_t)llround(missing_samples);
+		}
+
+		m_lastSampleIndex += sample_count;
+	}
+
+	m_lastTimestamp = device_timestamp_ns;
+
+	const double last_sample_stream_time =
+		(double)(device_timestamp_ns - m_firstTimestamp) * 1e-9 + m_streamStartOffset;
+
+	m_periodFit.addPoint((double)m_lastSampleIndex, last_sample_stream_time);
+
+	m_packetFirstSampleTime = last_sample_stream_time - (double)(sample_count - 1) * getSamplePeriod();
+}
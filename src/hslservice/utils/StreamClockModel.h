@@ -0,0 +1,76 @@
+#ifndef STREAM_CLOCK_MODEL_H
+#define STREAM_CLOCK_MODEL_H
+
+//-- includes -----
+#include <cstddef>
+#include <cstdint>
+
+//-- definitions -----
+// Exponentially weighted least squares fit of y = a + b*x.
+// Uses running weighted means and co-moments rather than raw sums so it stays accurate
+// when x and y are large (i.e. hours of nanosecond timestamps).
+class WeightedLinearFit
+{
+public:
+	WeightedLinearFit(double forgetting_factor= 1.0);
+
+	void reset();
+	void addPoint(double x, double y);
+
+	inline int getPointCount() const { return m_pointCount; }
+	inline bool getHasSlope() const { return m_pointCount >= 2 && m_varianceX > 0.0; }
+	double getSlope(double default_slope) const;
+	double evaluate(double x, double default_slope) const;
+	double evaluateInverse(double y, double default_slope) const;
+
+private:
+	double m_forgettingFactor;
+	double m_weight;
+	double m_meanX;
+	double m_meanY;
+	double m_varianceX; // Weighted sum of squared deviations of x
+	double m_covarianceXY; // Weighted sum of products of x and y deviations
+	int m_pointCount;
+};
+
+// Reconstructs per-sample timing for a sensor stream whose packets carry a device timestamp
+// for the last sample in the packet (i.e. Polar PMD frames).
+// - The real sample period is estimated from a drifting fit of device timestamp against sample index,
+//   since sensor crystals are rarely exactly at their nominal rate.
+// - Samples lost between packets are detected from the timestamp gap and skipped in the sample index.
+// Stream times are seconds since the first sample of the stream, in the device clock.
+class StreamClockModel
+{
+public:
+	StreamClockModel();
+
+	// Forget everything, call when the stream is (re)started
+	void reset(double nominal_sample_rate);
+
+	// Feed one packet of sample_count samples whose last sample was taken at device_timestamp_ns
+	void addPacket(uint64_t device_timestamp_ns, size_t sample_count);
+
+	inline bool getHasPackets() const { return m_bHasPackets; }
+
+	// Stream time of the first sample in the most recent packet
+	inline double getPacketFirstSampleTime() const { return m_packetFirstSampleTime; }
+
+	// Estimated seconds between samples (falls back to the nominal rate until there is enough data)
+	double getSamplePeriod() const;
+	inline double getNominalSampleRate() const { return m_nominalSampleRate; }
+
+	// Total samples the stream should have produced so far, including any lost in transit
+	inline uint64_t getSampleIndex() const { return m_lastSampleIndex; }
+
+private:
+	double m_nominalSampleRate;
+	bool m_bHasPackets;
+	uint64_t m_firstTimestamp; // Device timestamp of the last sample in the first packet
+	uint64_t m_lastTimestamp;
+	uint64_t m_lastSampleIndex; // Index of the last sample in the most recent packet
+	double m_streamStartOffset; // Stream time of the first packet's last sample
+	double m_packetFirstSampleTime;
+	WeightedLinearFit m_periodFit; // device seconds since first packet against sample index
+};
+
+#endif // STREAM_CLOCK_MODEL_H
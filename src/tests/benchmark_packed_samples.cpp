@@ -0,0 +1,194 @@
+#include <chrono>
+#include <cassert>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+
+// StackBuffer.h relies on <cassert> and <cstring> already being included
+#include "PackedSampleDecoding.h"
+#include "StackBuffer.h"
+
+// Times unpacking a PMD notification's packed 24-bit samples with each kernel
+// against the per-sample StackBuffer reads the Polar handlers used before.
+
+//-- constants -----
+// A full PMD notification is at most 1024 bytes
+static const size_t k_notification_bytes = 1024;
+static const size_t k_max_values = k_notification_bytes / 3;
+
+// Values per notification: a 73 sample ECG packet, a 73 sample (x4 channel) PPG packet and a full packet
+static const size_t k_value_counts[] = {73, 292, k_max_values};
+
+static const int k_warmup_iterations = 1000;
+static const int k_timed_iterations = 200000;
+
+//-- definitions -----
+using t_benchmark_clock= std::chrono::steady_clock;
+
+struct BenchmarkResult
+{
+	double nanosecondsPerPacket;
+	int64_t checksum; // Keeps the optimizer from dropping the decode
+};
+
+//-- private methods -----
+static void fill_test_packet(uint8_t* packet, size_t byte_count)
+{
+	// Deterministic noise so both signs and every byte value show up
+	uint32_t state= 0x12345678;
+
+	for (size_t index = 0; index < byte_count; ++index)
+	{
+		state= state * 1664525 + 1013904223;
+		packet[index]= (uint8_t)(state >> 24);
+	}
+}
+
+static int64_t sum_values(const int32_t* values, size_t count)
+{
+	int64_t sum= 0;
+
+	for (size_t index = 0; index < count; ++index)
+	{
+		sum+= values[index];
+	}
+
+	return sum;
+}
+
+// The ECG handler's old loop: 3 bytes into a zeroed uint32, no sign extension
+static void decode_with_read_bytes(StackBuffer<k_notification_bytes>& packet_data, int32_t* values, size_t count)
+{
+	packet_data.setReadPos(0);
+
+	for (size_t index = 0; index < count; ++index)
+	{
+		uint8_t raw_microvolt_value[4] = {0x00, 0x00, 0x00, 0x00};
+		packet_data.readBytes(raw_microvolt_value, 3);
+		uint32_t* microvolt_value = (uint32_t*)raw_microvolt_value;
+
+		values[index]= (int32_t)(*microvolt_value);
+	}
+}
+
+// The PPG handler's old loop
+static void decode_with_read_24bit_int(StackBuffer<k_notification_bytes>& packet_data, int32_t* values, size_t count)
+{
+	packet_data.setReadPos(0);
+
+	for (size_t index = 0; index < count; ++index)
+	{
+		values[index]= packet_data.read24BitInt();
+	}
+}
+
+template <typename t_decode_function>
+static BenchmarkResult time_decode(t_decode_function decode, int32_t* values, size_t count)
+{
+	BenchmarkResult result= {0.0, 0};
+
+	for (int iteration = 0; iteration < k_warmup_iterations; ++iteration)
+	{
+		decode(values, count);
+		result.checksum+= values[iteration % count];
+	}
+
+	const t_benchmark_clock::time_point start_time= t_benchmark_clock::now();
+
+	for (int iteration = 0; iteration < k_timed_iterations; ++iteration)
+	{
+		decode(values, count);
+		result.checksum+= values[iteration % count];
+	}
+
+	const t_benchmark_clock::time_point end_time= t_benchmark_clock::now();
+	const std::chrono::duration<double, std::nano> elapsed= end_time - start_time;
+
+	result.nanosecondsPerPacket= elapsed.count() / (double)k_timed_iterations;
+
+	return result;
+}
+
+static const char* get_decoder_name(PackedSampleDecoder decoder)
+{
+	switch (decoder)
+	{
+	case PackedSampleDecoder::Scalar:
+		return "Scalar";
+	case PackedSampleDecoder::SSSE3:
+		return "SSSE3";
+	case PackedSampleDecoder::AVX2:
+		return "AVX2";
+	}
+
+	return "Unknown";
+}
+
+//-- entry point -----
+int main()
+{
+	static const PackedSampleDecoder k_decoders[] = {
+		PackedSampleDecoder::Scalar,
+		PackedSampleDecoder::SSSE3,
+		PackedSampleDecoder::AVX2
+	};
+
+	uint8_t packet[k_notification_bytes];
+	fill_test_packet(packet, sizeof(packet));
+
+	StackBuffer<k_notification_bytes> packet_data(packet, sizeof(packet));
+
+	int32_t reference_values[k_max_values];
+	int32_t values[k_max_values];
+	bool bAllMatched= true;
+
+	printf("Packed int24 unpack, %d iterations, best kernel on this CPU: %s\n",
+		k_timed_iterations, get_decoder_name(get_packed_sample_decoder()));
+
+	for (size_t value_count : k_value_counts)
+	{
+		printf("\n%zu values per packet (%zu bytes)\n", value_count, value_count * 3);
+
+		const BenchmarkResult read_bytes_result= time_decode(
+			[&packet_data](int32_t* out_values, size_t count) {
+				decode_with_read_bytes(packet_data, out_values, count);
+			}, values, value_count);
+		printf("  %-24s %8.1f ns/packet\n", "StackBuffer readBytes", read_bytes_result.nanosecondsPerPacket);
+
+		const BenchmarkResult read_int_result= time_decode(
+			[&packet_data](int32_t* out_values, size_t count) {
+				decode_with_read_24bit_int(packet_data, out_values, count);
+			}, reference_values, value_count);
+		printf("  %-24s %8.1f ns/packet\n", "StackBuffer read24BitInt", read_int_result.nanosecondsPerPacket);
+
+		for (PackedSampleDecoder decoder : k_decoders)
+		{
+			if ((int)decoder > (int)get_packed_sample_decoder())
+			{
+				printf("  %-24s %8s (not supported)\n", get_decoder_name(decoder), "-");
+				continue;
+			}
+
+			memset(values, 0, sizeof(values));
+
+			const BenchmarkResult result= time_decode(
+				[&packet, decoder](int32_t* out_values, size_t count) {
+					unpack_packed_int24_samples_with(decoder, packet, out_values, count);
+				}, values, value_count);
+
+			// Every kernel has to decode exactly what the old read24BitInt loop did
+			const bool bMatched= memcmp(values, reference_values, value_count * sizeof(int32_t)) == 0;
+			bAllMatched&= bMatched;
+
+			printf("  %-24s %8.1f ns/packet  %5.2fx  %s\n",
+				get_decoder_name(decoder),
+				result.nanosecondsPerPacket,
+				read_int_result.nanosecondsPerPacket / result.nanosecondsPerPacket,
+				bMatched ? "" : "MISMATCH");
+		}
+
+		printf("  (checksum %lld)\n", (long long)(sum_values(values, value_count) + read_bytes_result.checksum));
+	}
+
+	return bAllMatched ? 0 : 1;
+}